@@ -0,0 +1,94 @@
+/*
+ * Compares looking up values in the binary search tree with searchNode against the B+-tree with btreeSearch.
+ *     ./bin/bench_btree [tree_size] [lookups]
+ * Both trees hold the same even values in [0, 2 * tree_size): the binary tree is built balanced with insertBatch, the
+ * B+-tree by inserting the values in a random order. Every thread looks up the same random values in the same range,
+ * so half of the lookups miss. Prints one CSV line per thread count:
+ *     tree_size,lookups,threads,binary_ns_per_lookup,btree_ns_per_lookup
+ */
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../binary_tree.h"
+#include "../btree.h"
+
+// Runs the lookups on every thread and returns the nanoseconds per lookup of one thread. The hits keep the compiler
+// from dropping the searches.
+static double run_binary(const TreeNode* tree, const int* keys, int lookups, int threads, long* hits)
+{
+    long sum = 0;
+    double start = omp_get_wtime();
+#pragma omp parallel num_threads(threads) reduction(+:sum)
+    {
+        for (int i = 0; i < lookups; ++i)
+        {
+            sum += searchNode(tree, keys[i]);
+        }
+    }
+    *hits += sum;
+    return (omp_get_wtime() - start) * 1e9 / lookups;
+}
+
+static double run_btree(const BTree* tree, const int* keys, int lookups, int threads, long* hits)
+{
+    long sum = 0;
+    double start = omp_get_wtime();
+#pragma omp parallel num_threads(threads) reduction(+:sum)
+    {
+        for (int i = 0; i < lookups; ++i)
+        {
+            sum += btreeSearch(tree, keys[i]);
+        }
+    }
+    *hits += sum;
+    return (omp_get_wtime() - start) * 1e9 / lookups;
+}
+
+int main(int argc, char** argv)
+{
+    int tree_size = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    int lookups = argc > 2 ? atoi(argv[2]) : 1 << 22;
+
+    int* values = (int*)malloc(sizeof(int) * tree_size);
+    for (int i = 0; i < tree_size; ++i)
+    {
+        values[i] = i * 2;
+    }
+    TreeNode* binary = insertBatch(NULL, values, tree_size);
+
+    // A random order splits leaves all over the tree, like a B+-tree that grew from real traffic
+    srand(1);
+    for (int i = tree_size - 1; i > 0; --i)
+    {
+        int j = rand() % (i + 1);
+        int swap = values[i];
+        values[i] = values[j];
+        values[j] = swap;
+    }
+    BTree* btree = btreeCreate();
+    for (int i = 0; i < tree_size; ++i)
+    {
+        btreeInsert(btree, values[i]);
+    }
+
+    int* keys = (int*)malloc(sizeof(int) * lookups);
+    for (int i = 0; i < lookups; ++i)
+    {
+        keys[i] = rand() % (2 * tree_size);
+    }
+
+    long binary_hits = 0, btree_hits = 0;
+    for (int threads = 1; threads <= omp_get_max_threads(); threads *= 2)
+    {
+        double binary_ns = run_binary(binary, keys, lookups, threads, &binary_hits);
+        double btree_ns = run_btree(btree, keys, lookups, threads, &btree_hits);
+        printf("%d,%d,%d,%.3f,%.3f\n", tree_size, lookups, threads, binary_ns, btree_ns);
+    }
+
+    free(values);
+    free(keys);
+    freeTree(binary);
+    btreeFree(btree);
+    return binary_hits != btree_hits;
+}
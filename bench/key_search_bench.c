@@ -0,0 +1,65 @@
+/*
+ * Compares the plain key search with the vector one on node-sized key arrays.
+ *     ./bin/bench_key_search [nodes] [probes]
+ * Every node holds KEY_SEARCH_WIDTH sorted keys. The "sequential" probes visit the nodes in order with increasing
+ * values, the "random" probes pick a random node and value each time. Prints one CSV line per case:
+ * isa,order,bound,scalar_ns_per_search,vector_ns_per_search
+ */
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../key_search.h"
+
+typedef int (*KeySearch)(const int* keys, int count, int data);
+
+// Runs the probes and returns the nanoseconds per search. The sum keeps the compiler from dropping the searches.
+static double run(KeySearch search, const int* keys, const int* nodes, const int* values, int probes, long* sum)
+{
+    double start = omp_get_wtime();
+    for (int i = 0; i < probes; ++i)
+    {
+        *sum += search(keys + (size_t)nodes[i] * KEY_SEARCH_WIDTH, KEY_SEARCH_WIDTH, values[i]);
+    }
+    return (omp_get_wtime() - start) * 1e9 / probes;
+}
+
+int main(int argc, char** argv)
+{
+    int node_count = argc > 1 ? atoi(argv[1]) : 1 << 16;
+    int probes = argc > 2 ? atoi(argv[2]) : 1 << 24;
+
+    // Node i holds the values [i * 64, i * 64 + 64) in steps of 4
+    int* keys = (int*)malloc(sizeof(int) * (size_t)node_count * KEY_SEARCH_WIDTH);
+    for (int i = 0; i < node_count * KEY_SEARCH_WIDTH; ++i)
+    {
+        keys[i] = i * 4;
+    }
+
+    int* nodes = (int*)malloc(sizeof(int) * probes);
+    int* values = (int*)malloc(sizeof(int) * probes);
+    long sum = 0;
+
+    for (int order = 0; order < 2; ++order)
+    {
+        srand(1);
+        for (int i = 0; i < probes; ++i)
+        {
+            nodes[i] = order == 0 ? (i / KEY_SEARCH_WIDTH) % node_count : rand() % node_count;
+            values[i] = nodes[i] * KEY_SEARCH_WIDTH * 4 + (order == 0 ? i % KEY_SEARCH_WIDTH * 4 : rand() % 64);
+        }
+
+        const char* order_name = order == 0 ? "sequential" : "random";
+        printf("%s,%s,lower,%.3f,%.3f\n", keySearchIsa(), order_name,
+               run(keysLowerBoundScalar, keys, nodes, values, probes, &sum),
+               run(keysLowerBound, keys, nodes, values, probes, &sum));
+        printf("%s,%s,upper,%.3f,%.3f\n", keySearchIsa(), order_name,
+               run(keysUpperBoundScalar, keys, nodes, values, probes, &sum),
+               run(keysUpperBound, keys, nodes, values, probes, &sum));
+    }
+
+    free(keys);
+    free(nodes);
+    free(values);
+    return sum == 42;
+}
@@ -0,0 +1,150 @@
+/*
+ * Times the workloads of tests/should_be_thread_safe.c on larger inputs.
+ * Built once per latch kind by 'make bench', so the three binaries can be compared on the same machine:
+ *     ./bin/bench_latch_omp [values] [rounds]
+ * Prints one CSV line per workload: latch,workload,threads,values,best_seconds,mean_seconds,node_bytes
+ */
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../binary_tree.h"
+
+#if TREE_LATCH == TREE_LATCH_OMP
+#define LATCH_NAME "omp"
+#elif TREE_LATCH == TREE_LATCH_SPIN
+#define LATCH_NAME "spin"
+#else
+#define LATCH_NAME "rw"
+#endif
+
+// Builds the tree of the mixed workloads: 0 and every multiple of 3
+static TreeNode* multiples_of_three(int n)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 3; i < n; i += 3)
+    {
+        insertNode(tree, i);
+    }
+    return tree;
+}
+
+static double insertion(int n)
+{
+    TreeNode* tree = createNode(0);
+    double start = omp_get_wtime();
+
+#pragma omp parallel for schedule(static, 6)
+    for (int i = 1; i < n; ++i)
+    {
+        insertNode(tree, i);
+    }
+
+    double seconds = omp_get_wtime() - start;
+    freeTree(tree);
+    return seconds;
+}
+
+static double deletion(int n)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < n; ++i)
+    {
+        insertNode(tree, i);
+    }
+    double start = omp_get_wtime();
+
+#pragma omp parallel for schedule(static, 6)
+    for (int i = 1; i < n; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            deleteNode(tree, i);
+        }
+    }
+
+    double seconds = omp_get_wtime() - start;
+    freeTree(tree);
+    return seconds;
+}
+
+// The search and find_min tests: concurrent inserts, deletes, searches and (optionally) findMin calls
+static double mixed(int n, int with_find_min)
+{
+    TreeNode* tree = multiples_of_three(n);
+    double start = omp_get_wtime();
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            #pragma omp taskloop nogroup
+            for (int i = 1; i < n; i++)
+            {
+                if (i % 3 != 0)
+                {
+                    insertNode(tree, i);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int j = 1; j < n; j++)
+            {
+                deleteNode(tree, j);
+            }
+
+            #pragma omp taskloop nogroup
+            for (int k = 1; k < n; k++)
+            {
+                searchNode(tree, k);
+            }
+
+            if (with_find_min)
+            {
+                #pragma omp taskloop nogroup
+                for (int l = 1; l < n; l++)
+                {
+                    findMin(tree);
+                }
+            }
+        }
+    }
+
+    double seconds = omp_get_wtime() - start;
+    freeTree(tree);
+    return seconds;
+}
+
+static double search(int n) { return mixed(n, 0); }
+static double find_min(int n) { return mixed(n, 1); }
+
+int main(int argc, char** argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 4000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+
+    struct { const char* name; double (*run)(int); } workloads[] = {
+        { "insertion", insertion },
+        { "deletion", deletion },
+        { "search", search },
+        { "find_min", find_min },
+    };
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w)
+    {
+        double best = 0, total = 0;
+        for (int r = 0; r < rounds; ++r)
+        {
+            double seconds = workloads[w].run(n);
+            total += seconds;
+            if (r == 0 || seconds < best)
+            {
+                best = seconds;
+            }
+        }
+        printf("%s,%s,%d,%d,%.6f,%.6f,%zu\n", LATCH_NAME, workloads[w].name, omp_get_max_threads(), n, best,
+               total / rounds, sizeof(TreeNode));
+    }
+
+    return 0;
+}
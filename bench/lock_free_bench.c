@@ -0,0 +1,142 @@
+/*
+ * Times the workloads of bench/latch_bench.c on the lock-free tree, so its scaling can be compared with the latched one:
+ *     OMP_NUM_THREADS=64 ./bin/bench_lock_free [values] [rounds]
+ * Prints one CSV line per workload: tree,workload,threads,values,best_seconds,mean_seconds
+ */
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../lock_free_tree.h"
+
+// Builds the tree of the mixed workloads: 0 and every multiple of 3
+static LockFreeTree* multiples_of_three(int n)
+{
+    LockFreeTree* tree = lockFreeCreate();
+    for (int i = 0; i < n; i += 3)
+    {
+        lockFreeInsert(tree, i);
+    }
+    return tree;
+}
+
+static double insertion(int n)
+{
+    LockFreeTree* tree = lockFreeCreate();
+    lockFreeInsert(tree, 0);
+    double start = omp_get_wtime();
+
+#pragma omp parallel for schedule(static, 6)
+    for (int i = 1; i < n; ++i)
+    {
+        lockFreeInsert(tree, i);
+    }
+
+    double seconds = omp_get_wtime() - start;
+    lockFreeFree(tree);
+    return seconds;
+}
+
+static double deletion(int n)
+{
+    LockFreeTree* tree = lockFreeCreate();
+    for (int i = 0; i < n; ++i)
+    {
+        lockFreeInsert(tree, i);
+    }
+    double start = omp_get_wtime();
+
+#pragma omp parallel for schedule(static, 6)
+    for (int i = 1; i < n; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            lockFreeDelete(tree, i);
+        }
+    }
+
+    double seconds = omp_get_wtime() - start;
+    lockFreeFree(tree);
+    return seconds;
+}
+
+// The search and find_min tests: concurrent inserts, deletes, searches and (optionally) findMin calls
+static double mixed(int n, int with_find_min)
+{
+    LockFreeTree* tree = multiples_of_three(n);
+    double start = omp_get_wtime();
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            #pragma omp taskloop nogroup
+            for (int i = 1; i < n; i++)
+            {
+                if (i % 3 != 0)
+                {
+                    lockFreeInsert(tree, i);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int j = 1; j < n; j++)
+            {
+                lockFreeDelete(tree, j);
+            }
+
+            #pragma omp taskloop nogroup
+            for (int k = 1; k < n; k++)
+            {
+                lockFreeSearch(tree, k);
+            }
+
+            if (with_find_min)
+            {
+                #pragma omp taskloop nogroup
+                for (int l = 1; l < n; l++)
+                {
+                    int min;
+                    lockFreeFindMin(tree, &min);
+                }
+            }
+        }
+    }
+
+    double seconds = omp_get_wtime() - start;
+    lockFreeFree(tree);
+    return seconds;
+}
+
+static double search(int n) { return mixed(n, 0); }
+static double find_min(int n) { return mixed(n, 1); }
+
+int main(int argc, char** argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 4000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+
+    struct { const char* name; double (*run)(int); } workloads[] = {
+        { "insertion", insertion },
+        { "deletion", deletion },
+        { "search", search },
+        { "find_min", find_min },
+    };
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w)
+    {
+        double best = 0, total = 0;
+        for (int r = 0; r < rounds; ++r)
+        {
+            double seconds = workloads[w].run(n);
+            total += seconds;
+            if (r == 0 || seconds < best)
+            {
+                best = seconds;
+            }
+        }
+        printf("lock_free,%s,%d,%d,%.6f,%.6f\n", workloads[w].name, omp_get_max_threads(), n, best, total / rounds);
+    }
+
+    return 0;
+}
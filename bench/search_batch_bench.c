@@ -0,0 +1,79 @@
+/*
+ * Compares looking up values one by one with searchNode against looking them up together with searchBatch, and
+ * against frozenSearch on a frozen copy of the tree.
+ *     ./bin/bench_search_batch [tree_size] [lookups]
+ * The tree holds the even values in [0, 2 * tree_size) and is built balanced with insertBatch, the lookups are random
+ * values in the same range. Prints one CSV line:
+ *     tree_size,lookups,single_ns_per_lookup,batch_ns_per_lookup,frozen_ns_per_lookup,tree_bytes,frozen_bytes
+ */
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../binary_tree.h"
+#include "../frozen_tree.h"
+
+// Lookups are handed to searchBatch in requests of this size, like a service answering many keys per request
+#define REQUEST_SIZE 256
+
+int main(int argc, char** argv)
+{
+    int tree_size = argc > 1 ? atoi(argv[1]) : 1 << 22;
+    int lookups = argc > 2 ? atoi(argv[2]) : 1 << 22;
+
+    int* values = (int*)malloc(sizeof(int) * tree_size);
+    for (int i = 0; i < tree_size; ++i)
+    {
+        values[i] = i * 2;
+    }
+    TreeNode* tree = insertBatch(NULL, values, tree_size);
+
+    srand(1);
+    int* keys = (int*)malloc(sizeof(int) * lookups);
+    bool* found = (bool*)malloc(sizeof(bool) * lookups);
+    for (int i = 0; i < lookups; ++i)
+    {
+        keys[i] = rand() % (2 * tree_size);
+    }
+
+    long single_hits = 0;
+    double start = omp_get_wtime();
+    for (int i = 0; i < lookups; ++i)
+    {
+        single_hits += searchNode(tree, keys[i]);
+    }
+    double single_ns = (omp_get_wtime() - start) * 1e9 / lookups;
+
+    long batch_hits = 0;
+    start = omp_get_wtime();
+    for (int i = 0; i < lookups; i += REQUEST_SIZE)
+    {
+        int n = lookups - i < REQUEST_SIZE ? lookups - i : REQUEST_SIZE;
+        searchBatch(tree, keys + i, n, found + i);
+    }
+    double batch_ns = (omp_get_wtime() - start) * 1e9 / lookups;
+
+    for (int i = 0; i < lookups; ++i)
+    {
+        batch_hits += found[i];
+    }
+
+    FrozenTree* frozen = treeFreeze(tree);
+    long frozen_hits = 0;
+    start = omp_get_wtime();
+    for (int i = 0; i < lookups; ++i)
+    {
+        frozen_hits += frozenSearch(frozen, keys[i]);
+    }
+    double frozen_ns = (omp_get_wtime() - start) * 1e9 / lookups;
+
+    printf("%d,%d,%.3f,%.3f,%.3f,%zu,%zu\n", tree_size, lookups, single_ns, batch_ns, frozen_ns,
+           (size_t)tree_size * sizeof(TreeNode), frozenMemory(frozen));
+
+    frozenFree(frozen);
+    freeTree(tree);
+    free(values);
+    free(keys);
+    free(found);
+    return single_hits != batch_hits || single_hits != frozen_hits;
+}
@@ -0,0 +1,372 @@
+/*
+ * Runs a mixed workload of insertNode, searchNode, deleteNode and findMin and measures throughput and latency.
+ *     ./bin/bench_workload [-m read,insert,delete,find_min] [-d sequential|uniform|zipf] [-z theta] [-n tree_size]
+ *                          [-k key_range] [-o operations_per_thread] [-t threads[,threads...]] [-f csv|json] [-s seed]
+ *                          [-c]
+ * The mix is in percents (default 80,10,10,0). The tree starts with tree_size random values in [0, key_range) and is
+ * built balanced with insertBatch; every operation draws its key from the same range. Zipf ranks are the keys
+ * themselves, so the hot keys are the small ones. Each thread count runs on a fresh tree. With -c the operations go
+ * through combining_tree.h, so every insert and delete is applied by the combiner.
+ * Prints one line per thread count, as CSV:
+ *     distribution,read,insert,delete,find_min,threads,tree_size,operations,ops_per_sec,p50_ns,p99_ns,p999_ns
+ * or as one JSON object per line with the same fields.
+ * Built with -DTREE_STATS=1 (bin/bench_workload_stats) it also prints the counters of tree_stats.h for every run to
+ * stderr, as CSV: threads,operations,nodes_visited,latch_acquires,contended_acquires,wait_ns,allocations,max_path
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../binary_tree.h"
+#include "../combining_tree.h"
+#include "../tree_stats.h"
+
+#define MAX_THREAD_COUNTS 32
+
+// The tree always keeps this value, which no operation draws, so deleteNode never frees the root
+#define KEPT_VALUE -1
+
+typedef enum { SEQUENTIAL, UNIFORM, ZIPF } Distribution;
+
+static const char* distribution_names[] = { "sequential", "uniform", "zipf" };
+
+typedef struct
+{
+    int mix[4];
+    Distribution distribution;
+    double theta;
+    int tree_size;
+    int key_range;
+    int operations;
+    int thread_counts[MAX_THREAD_COUNTS];
+    int runs;
+    bool json;
+    bool combine;
+    uint64_t seed;
+} Config;
+
+// The constants of the Zipf generator of Gray et al. ("Quickly Generating Billion-Record Synthetic Databases")
+typedef struct
+{
+    double theta;
+    double alpha;
+    double zeta_n;
+    double eta;
+    int n;
+} Zipf;
+
+// A xorshift64* generator per thread
+static uint64_t next_random(uint64_t* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static double next_unit(uint64_t* state)
+{
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void zipf_init(Zipf* zipf, int n, double theta)
+{
+    double zeta_2 = 1 + pow(0.5, theta);
+    zipf->zeta_n = 0;
+    for (int i = 1; i <= n; ++i)
+    {
+        zipf->zeta_n += 1 / pow(i, theta);
+    }
+
+    zipf->theta = theta;
+    zipf->n = n;
+    zipf->alpha = 1 / (1 - theta);
+    zipf->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta_2 / zipf->zeta_n);
+}
+
+static int zipf_next(const Zipf* zipf, uint64_t* state)
+{
+    double u = next_unit(state);
+    double uz = u * zipf->zeta_n;
+
+    if (uz < 1)
+    {
+        return 0;
+    }
+    if (uz < 1 + pow(0.5, zipf->theta))
+    {
+        return 1;
+    }
+
+    int rank = (int)(zipf->n * pow(zipf->eta * u - zipf->eta + 1, zipf->alpha));
+    return rank < zipf->n ? rank : zipf->n - 1;
+}
+
+static int compare_latencies(const void* a, const void* b)
+{
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const float* sorted, size_t n, double fraction)
+{
+    size_t index = (size_t)(fraction * (n - 1));
+    return sorted[index];
+}
+
+static bool parse_list(const char* text, int* values, int capacity, int* count)
+{
+    char* end;
+    *count = 0;
+    while (*text && *count < capacity)
+    {
+        values[(*count)++] = (int)strtol(text, &end, 10);
+        if (end == text || (*end != ',' && *end != '\0'))
+        {
+            return false;
+        }
+        text = *end == ',' ? end + 1 : end;
+    }
+    return *count > 0;
+}
+
+static bool parse_config(int argc, char** argv, Config* config)
+{
+    int count, option;
+
+    while ((option = getopt(argc, argv, "m:d:z:n:k:o:t:f:s:c")) != -1)
+    {
+        switch (option)
+        {
+        case 'm':
+            if (!parse_list(optarg, config->mix, 4, &count) || count != 4 ||
+                config->mix[0] + config->mix[1] + config->mix[2] + config->mix[3] != 100)
+            {
+                return false;
+            }
+            break;
+        case 'd':
+            for (count = 0; count < 3 && strcmp(optarg, distribution_names[count]) != 0; ++count)
+            {
+            }
+            if (count == 3)
+            {
+                return false;
+            }
+            config->distribution = (Distribution)count;
+            break;
+        case 'z':
+            config->theta = atof(optarg);
+            break;
+        case 'n':
+            config->tree_size = atoi(optarg);
+            break;
+        case 'k':
+            config->key_range = atoi(optarg);
+            break;
+        case 'o':
+            config->operations = atoi(optarg);
+            break;
+        case 't':
+            if (!parse_list(optarg, config->thread_counts, MAX_THREAD_COUNTS, &config->runs))
+            {
+                return false;
+            }
+            break;
+        case 'f':
+            config->json = strcmp(optarg, "json") == 0;
+            break;
+        case 's':
+            config->seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'c':
+            config->combine = true;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    if (config->key_range <= 0)
+    {
+        config->key_range = 2 * config->tree_size;
+    }
+    return config->key_range > 0 && config->operations > 0 && config->theta > 0 && config->theta != 1;
+}
+
+// Runs the workload on a fresh tree and writes the latency of every operation to latencies
+static double run(const Config* config, const Zipf* zipf, int threads, float* latencies)
+{
+    uint64_t state = config->seed + 0x9E3779B97F4A7C15ULL;
+    int* values = (int*)malloc(sizeof(int) * (config->tree_size + 1));
+    for (int i = 0; i < config->tree_size; ++i)
+    {
+        values[i] = (int)(next_random(&state) % config->key_range);
+    }
+    values[config->tree_size] = KEPT_VALUE;
+    TreeNode* tree = insertBatch(NULL, values, config->tree_size + 1);
+    free(values);
+    CombiningTree* combining = config->combine ? combiningCreate(tree) : NULL;
+
+    TreeStats before;
+    treeStats(&before);
+    double start = omp_get_wtime();
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int thread = omp_get_thread_num();
+        uint64_t random = config->seed + 0x9E3779B97F4A7C15ULL * (thread + 2);
+        float* thread_latencies = latencies + (size_t)thread * config->operations;
+        int sequence = thread;
+
+        for (int i = 0; i < config->operations; ++i)
+        {
+            int key;
+            if (config->distribution == SEQUENTIAL)
+            {
+                key = sequence;
+                sequence = (int)((sequence + (long long)threads) % config->key_range);
+            }
+            else if (config->distribution == UNIFORM)
+            {
+                key = (int)(next_random(&random) % config->key_range);
+            }
+            else
+            {
+                key = zipf_next(zipf, &random);
+            }
+            int kind = (int)(next_random(&random) % 100);
+
+            double begin = omp_get_wtime();
+            if (combining)
+            {
+                int min;
+                if (kind < config->mix[0])
+                {
+                    combiningSearch(combining, key);
+                }
+                else if (kind < config->mix[0] + config->mix[1])
+                {
+                    combiningInsert(combining, key);
+                }
+                else if (kind < config->mix[0] + config->mix[1] + config->mix[2])
+                {
+                    combiningDelete(combining, key);
+                }
+                else
+                {
+                    combiningFindMin(combining, &min);
+                }
+            }
+            else if (kind < config->mix[0])
+            {
+                searchNode(tree, key);
+            }
+            else if (kind < config->mix[0] + config->mix[1])
+            {
+                insertNode(tree, key);
+            }
+            else if (kind < config->mix[0] + config->mix[1] + config->mix[2])
+            {
+                deleteNode(tree, key);
+            }
+            else
+            {
+                findMin(tree);
+            }
+            thread_latencies[i] = (float)((omp_get_wtime() - begin) * 1e9);
+        }
+    }
+
+    double seconds = omp_get_wtime() - start;
+
+#if TREE_STATS
+    TreeStats after;
+    treeStats(&after);
+    fprintf(stderr, "%d,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", threads, after.operations - before.operations,
+            after.nodesVisited - before.nodesVisited, after.latchAcquires - before.latchAcquires,
+            after.contendedAcquires - before.contendedAcquires, after.waitNanos - before.waitNanos,
+            after.allocations - before.allocations, after.maxPathLength);
+#else
+    (void)before;
+#endif
+    if (combining)
+    {
+        combiningFree(combining);
+    }
+    else
+    {
+        freeTree(tree);
+    }
+    return seconds;
+}
+
+int main(int argc, char** argv)
+{
+    Config config = {
+        .mix = { 80, 10, 10, 0 },
+        .distribution = UNIFORM,
+        .theta = 0.99,
+        .tree_size = 100000,
+        .key_range = 0,
+        .operations = 100000,
+        .runs = 1,
+        .json = false,
+        .combine = false,
+        .seed = 1,
+    };
+    config.thread_counts[0] = omp_get_max_threads();
+
+    if (!parse_config(argc, argv, &config))
+    {
+        fprintf(stderr, "usage: %s [-m read,insert,delete,find_min] [-d sequential|uniform|zipf] [-z theta] "
+                        "[-n tree_size] [-k key_range] [-o operations_per_thread] [-t threads[,threads...]] "
+                        "[-f csv|json] [-s seed] [-c]\n", argv[0]);
+        return 1;
+    }
+
+    Zipf zipf;
+    if (config.distribution == ZIPF)
+    {
+        zipf_init(&zipf, config.key_range, config.theta);
+    }
+
+    for (int r = 0; r < config.runs; ++r)
+    {
+        int threads = config.thread_counts[r];
+        size_t total = (size_t)threads * config.operations;
+        float* latencies = (float*)malloc(sizeof(float) * total);
+
+        double seconds = run(&config, &zipf, threads, latencies);
+        qsort(latencies, total, sizeof(float), compare_latencies);
+
+        double throughput = total / seconds;
+        double p50 = percentile(latencies, total, 0.5);
+        double p99 = percentile(latencies, total, 0.99);
+        double p999 = percentile(latencies, total, 0.999);
+        const char* distribution = distribution_names[config.distribution];
+
+        if (config.json)
+        {
+            printf("{\"distribution\":\"%s\",\"read\":%d,\"insert\":%d,\"delete\":%d,\"find_min\":%d,\"threads\":%d,"
+                   "\"tree_size\":%d,\"operations\":%zu,\"ops_per_sec\":%.0f,\"p50_ns\":%.0f,\"p99_ns\":%.0f,"
+                   "\"p999_ns\":%.0f}\n", distribution, config.mix[0], config.mix[1], config.mix[2], config.mix[3],
+                   threads, config.tree_size, total, throughput, p50, p99, p999);
+        }
+        else
+        {
+            printf("%s,%d,%d,%d,%d,%d,%d,%zu,%.0f,%.0f,%.0f,%.0f\n", distribution, config.mix[0], config.mix[1],
+                   config.mix[2], config.mix[3], threads, config.tree_size, total, throughput, p50, p99, p999);
+        }
+
+        free(latencies);
+    }
+
+    return 0;
+}
@@ -1,6 +1,11 @@
 #include "binary_tree.h"
+#include "node_arena.h"
+#include "epoch.h"
+#include "tree_stats.h"
 
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 // This function checks whether a TreeNode* is a leaf. Null is not a leaf.
 static inline bool isLeaf(const TreeNode* root);
@@ -9,15 +14,186 @@ static inline bool isLeaf(const TreeNode* root);
 static inline bool hasLeftChild(const TreeNode* root);
 static inline bool hasRightChild(const TreeNode* root);
 
+/*
+ * Writers wrap every change to a node that searchNode may be reading with beginWrite/endWrite, which make the
+ * version counter odd and then even again. Readers use readBegin/readValidate to detect such changes.
+ */
+static inline void beginWrite(TreeNode* node);
+static inline void endWrite(TreeNode* node);
+static inline bool readBegin(const TreeNode* node, unsigned int* version);
+static inline bool readValidate(const TreeNode* node, const unsigned int version);
+
+// This function creates a node in the arena of an existing tree
+static TreeNode* newNode(NodeArena* arena, const int data);
+
+// The body of deleteNodeChecked
+static TreeNode* deleteUnbalanced(TreeNode* root, int data, bool* isDeleted);
+
+/*
+ * This function removes the node of a value that deleteUnbalanced or deleteBatch found. The node and its parent (NULL
+ * for the root) are latched, and the sizes of both already count the removal. The node is unlatched on return, and
+ * so is the parent if releaseParent is set. Returns the root, NULL if the tree became empty.
+ */
+static TreeNode* unlinkNode(TreeNode* root, TreeNode* parent, TreeNode* node, bool releaseParent);
+
+/*
+ * Removed nodes go back to the arena of their tree once no lock-free reader can still see them, and are reused by
+ * later inserts. The node must be unlocked and already unreachable.
+ */
+static void retireNode(TreeNode* node);
+
+// The lock-free search, returns false if it ran into a concurrent writer and should be retried
+static bool searchOptimistic(const TreeNode* root, const int data, bool* found);
+
+// The hand-over-hand locking search, used when the lock-free one keeps failing
+static bool searchLocked(const TreeNode* root, const int data);
+
+// The body of searchNode, without counting an operation
+static bool searchValue(const TreeNode* root, const int data);
+
+// Number of lock-free search attempts before falling back to locking
+#define OPTIMISTIC_RETRIES 8
+
+// With the 1-byte latch a node must stay 32 bytes, and with the others 40 (see bench/latch_bench.c for the sizes)
+typedef char nodeSizeCheck[sizeof(TreeNode) == (TREE_LATCH == TREE_LATCH_SPIN ? 32 : 40) ? 1 : -1];
+
+// Number of lookups that searchBatch keeps in flight
+#define SEARCH_BATCH_GROUP 16
+
+/*
+ * The state of one lookup of searchBatch. 'node' is the next node to visit, which was prefetched in the previous
+ * step, and 'parent' is the validated node we came from (NULL before the root).
+ */
+typedef struct BatchLookup {
+    const TreeNode* parent;
+    const TreeNode* node;
+    unsigned int parentVersion;
+    size_t index;
+} BatchLookup;
+
+// This function moves a lookup one level down, returns true once its result is written to 'out'
+static bool lookupStep(const TreeNode* root, BatchLookup* lookup, const int* keys, bool* out);
+
+// Batch ranges smaller than this are built by the current task instead of a new one
+#define BUILD_TASK_CUTOFF 4096
+
+// This function compares two ints for qsort
+static int compareInts(const void* a, const void* b);
+
+// A key of deleteBatchChecked with its place in the caller's array. They are sorted by value, then by place.
+typedef struct IndexedKey {
+    int data;
+    size_t index;
+} IndexedKey;
+
+static int compareIndexedKeys(const void* a, const void* b);
+
+// This function returns the number of sorted keys that are not greater than the value
+static size_t sortedUpperBound(const int* keys, size_t n, int data);
+
+// This function builds a balanced subtree of sorted keys, in parallel when the range is large
+static TreeNode* buildSubtree(NodeArena* arena, const int* keys, size_t n);
+static TreeNode* buildRange(NodeArena* arena, const int* keys, size_t n);
+
+// This function merges sorted keys into the subtree of a locked node, and unlocks it
+static void mergeBatch(TreeNode* node, const int* keys, size_t n);
+
+// Subtrees of nodes at most this deep are reduced by tasks of their own
+#define REDUCE_TASK_DEPTH 12
+
+// This function reduces the subtree of a node, or counts its nodes when op is NULL
+static long long reduceTree(const TreeNode* root, ReduceOp op, long long identity);
+static long long reduceSubtree(TreeNode* node, ReduceOp op, long long identity, int depth);
+
+static void pathInit(NodePath* path);
+static void pathPush(NodePath* path, TreeNode* node);
+static void pathDestroy(NodePath* path);
+
+// Unlocks every node in the path above the last one, except 'keep'
+static void pathReleaseAbove(NodePath* path, const TreeNode* keep);
+
+// Latches the nodes from 'node' (already latched) down to the first value that is not smaller than lo
+static void iteratorDescend(TreeIterator* iterator, TreeNode* node, int lo);
+
+// Height helpers for the balanced functions. The height of NULL is 0.
+static inline int nodeHeight(const TreeNode* node);
+static inline int balanceFactor(const TreeNode* node);
+static inline void updateHeight(TreeNode* node);
+
+// In-place rotations: the rotated node keeps its place in the tree and swaps its data with its child
+static void rotateRight(TreeNode* node);
+static void rotateLeft(TreeNode* node);
+
+// Restores the AVL property of 'node'. If lockChildren is set, the rotated descendants are locked first.
+static void rebalance(TreeNode* node, bool lockChildren);
+
+/*
+ * Size helpers. A writer changes the size of a node only while it holds the node, before it lets go of the parent,
+ * so whoever holds a node sees the sizes of its children count every writer that passed it. Sizes are changed with
+ * atomic adds, since deleteNode undoes its changes to nodes it does not hold anymore. The size of NULL is 0.
+ */
+static inline size_t nodeSize(const TreeNode* node);
+static inline void addSize(TreeNode* node, long delta);
+static inline void updateSize(TreeNode* node);
+
+// Recomputes the sizes on the path of a value from the root, holding all of it. Used by deleteBalanced, see there.
+static void repairSizes(TreeNode* root, int data);
+
+// Counts the values of a subtree that are not smaller than lo (isLower) or not greater than hi, latching the path
+static size_t countSide(TreeNode* node, int bound, bool isLower);
+
+/*
+ * A node that deleteRange removes on one of its two cut paths, together with the subtree that goes with it (its right
+ * subtree on the lower path, its left one on the upper path). 'size' is the size of that subtree when it was cut off,
+ * and 'kept' is the number of nodes of the path that stay in the tree above it.
+ */
+typedef struct CutNode {
+    TreeNode* node;
+    TreeNode* subtree;
+    size_t size;
+    size_t kept;
+    int side;
+} CutNode;
+
+// The two cut paths of deleteRange: the nodes that stay on each one, and the nodes that are removed from both
+typedef struct RangeCut {
+    NodePath kept[2];
+    CutNode* removed;
+    size_t count;
+    size_t capacity;
+} RangeCut;
+
+// Detached subtrees with more nodes than this have their left subtrees retired by tasks of their own
+#define RETIRE_TASK_CUTOFF 4096
+
+/*
+ * A node on the sweep of deleteBatch, with the sorted keys that go into its subtree: 'count' keys from 'first'. 'low'
+ * of them are not greater than the value of the node, and 'own' is set when the last of those is the value itself.
+ * 'found' counts the keys that were found in its subtrees so far, and 'stage' tells which subtree is next.
+ */
+typedef struct SweepFrame {
+    TreeNode* node;
+    size_t first;
+    size_t count;
+    size_t low;
+    size_t found;
+    bool own;
+    int stage;
+} SweepFrame;
+
+// This function deletes one copy of each of n sorted keys, marking in found (if not NULL) which ones were in the tree
+static TreeNode* deleteSorted(TreeNode* root, const int* keys, size_t n, bool* found, size_t* deleted);
+
+// Walks one cut path from the highest node of the range, latching every node on it (the caller holds the parent)
+static void cutPath(RangeCut* cut, TreeNode* node, int bound, int side);
+
+// Retires every node of a detached subtree and returns their number, in parallel when the subtree is large
+static size_t retireSubtree(TreeNode* top);
+static size_t retireRange(TreeNode* top);
+
 // Create a new binary search tree
 TreeNode* createNode(const int data) {
-    TreeNode* node = (TreeNode*)malloc(sizeof(TreeNode));
-    node->data = data;
-    node->left = NULL;
-    node->right = NULL;
-    omp_init_lock(&node->lock);
-
-    return node;
+    return newNode(arenaCreate(), data);
 }
 
 // This function inserts a new node to the tree
@@ -31,39 +207,51 @@ TreeNode* insertNode(TreeNode* root, const int data) {
     }
 
     // First, we try to set the lock
-    omp_set_lock(&parent->lock);
-    omp_lock_t* lock_to_free = NULL;
+    statsBeginOperation();
+    latchAcquireCounted(&parent->lock);
+    Latch* lock_to_free = NULL;
     while (parent) {
+        statsVisit();
+
+        // The new node will be in the subtree of every node we pass
+        addSize(parent, 1);
 
         // First we unset the lock of the previous parent
-        if (lock_to_free) omp_unset_lock(lock_to_free);
+        if (lock_to_free) latchRelease(lock_to_free);
 
         lock_to_free = &parent->lock;
 
         // Now, we need to decide whether the new node should be in the left or right tree spanned by the root
         if (data <= parent->data && hasLeftChild(parent)) {
-            omp_set_lock(&parent->left->lock);
+            latchAcquireCounted(&parent->left->lock);
             parent = parent->left;
         }
 
         else if (data > parent->data && hasRightChild(parent)) {
-            omp_set_lock(&parent->right->lock);
+            latchAcquireCounted(&parent->right->lock);
             parent = parent->right;
         }
 
         // Here we know that we need to insert the new node as a left child of current 'root'
         else if (data <= parent->data && !hasLeftChild(parent)) {
-            parent->left = createNode(data);
+            TreeNode* node = newNode(arenaOf(parent), data);
+            beginWrite(parent);
+            parent->left = node;
+            endWrite(parent);
             break;
         }
 
         // Here we know that we need to insert the new node as a right child of current 'root'
         else if (data > parent->data && !hasRightChild(parent)) {
-            parent->right = createNode(data);
+            TreeNode* node = newNode(arenaOf(parent), data);
+            beginWrite(parent);
+            parent->right = node;
+            endWrite(parent);
             break;
         }
     }
-    if (lock_to_free) omp_unset_lock(lock_to_free);
+    if (lock_to_free) latchRelease(lock_to_free);
+    statsEndOperation();
 
     return root;
 }
@@ -75,17 +263,47 @@ TreeNode* insertNode(TreeNode* root, const int data) {
  * If the node we want to delete has two children we replace it with the minimal value in the right tree and delete
  */
 TreeNode* deleteNode(TreeNode* root, const int data) {
+    bool isDeleted;
+    return deleteNodeChecked(root, data, &isDeleted);
+}
+
+// Delete the value, counting the operation. The epoch lets a delete that did not find its value undo its changes
+// to the sizes of nodes that were removed meanwhile.
+TreeNode* deleteNodeChecked(TreeNode* root, const int data, bool* isDeleted) {
+    statsBeginOperation();
+    epochEnter();
+    root = deleteUnbalanced(root, data, isDeleted);
+    epochExit();
+    statsEndOperation();
+
+    return root;
+}
+
+// The body of deleteNode, which also tells whether the value was found
+static TreeNode* deleteUnbalanced(TreeNode* root, const int data, bool* isDeleted) {
     TreeNode* node = root, *parent = NULL;
-    bool isOnlyLeft = false, isOnlyRight = false;
 
+    *isDeleted = false;
     if (root == NULL) return NULL;
 
+    /*
+     * We take the value off the size of every node we pass, before we know whether it is in the tree, and remember
+     * the path to give it back if it is not. Nodes of this tree never move, and new ones are only added as leaves,
+     * so the nodes we passed are still exactly the ones above the place of the value, or removed.
+     */
+    NodePath path;
+    pathInit(&path);
+
     // Locking the node
-    omp_set_lock(&node->lock);
-    omp_lock_t* lock_to_free = NULL;
+    latchAcquireCounted(&node->lock);
+    Latch* lock_to_free = NULL;
 
     // Finding the place to delete from
     while (node != NULL) {
+        statsVisit();
+        addSize(node, -1);
+        pathPush(&path, node);
+
         // Optimization: If we found the node, we stop immediately.
         // We hold 'lock_to_free' (Parent) and 'node->lock' (Target).
         // By setting lock_to_free = NULL, we ensure Parent stays locked.
@@ -94,18 +312,18 @@ TreeNode* deleteNode(TreeNode* root, const int data) {
             break;
         }
 
-        if (lock_to_free) omp_unset_lock(lock_to_free);
+        if (lock_to_free) latchRelease(lock_to_free);
         lock_to_free = &node->lock;
 
         // We didn't yet found the node to delete, but we know that it is in the left subtree
         if (data <= node->data && hasLeftChild(node)) {
-            omp_set_lock(&node->left->lock);
+            latchAcquireCounted(&node->left->lock);
             parent = node;
             node = node->left;
         }
         // We didn't yet found the node to delete, but we know that it is in the right subtree
         else if (data > node->data && hasRightChild(node)) {
-            omp_set_lock(&node->right->lock);
+            latchAcquireCounted(&node->right->lock);
             parent = node;
             node = node->right;
         }
@@ -117,24 +335,40 @@ TreeNode* deleteNode(TreeNode* root, const int data) {
 
     // If the given value is not in the tree
     if (node == NULL) {
-        if (lock_to_free) omp_unset_lock(lock_to_free);
+        for (size_t i = 0; i < path.count; ++i) addSize(path.nodes[i], 1);
+        pathDestroy(&path);
+
+        if (lock_to_free) latchRelease(lock_to_free);
         return root;
     }
+    *isDeleted = true;
+    pathDestroy(&path);
+
+    return unlinkNode(root, parent, node, true);
+}
+
+// Remove the node in one of the three ways described at deleteNode
+static TreeNode* unlinkNode(TreeNode* root, TreeNode* parent, TreeNode* node, const bool releaseParent) {
+    bool isOnlyLeft = false, isOnlyRight = false;
 
     // Case 1: the deleted node is a leaf.
     if (isLeaf(node)) {
         if (!parent) {
-            omp_destroy_lock(&node->lock);
-            free(node);
+            NodeArena* arena = arenaOf(node);
+            latchRelease(&node->lock);
+            retireNode(node);
+            arenaRelease(arena);
             return NULL;
         }
 
+        beginWrite(parent);
         if (parent->left == node) parent->left = NULL;
         else parent->right = NULL;
+        endWrite(parent);
 
-        omp_unset_lock(&parent->lock);
-        omp_destroy_lock(&node->lock);
-        free(node);
+        if (releaseParent) latchRelease(&parent->lock);
+        latchRelease(&node->lock);
+        retireNode(node);
         return root;
     }
 
@@ -147,30 +381,33 @@ TreeNode* deleteNode(TreeNode* root, const int data) {
             TreeNode* child = isOnlyLeft ? node->left : node->right;
 
             // Promote child data to root
+            beginWrite(node);
             node->data = child->data;
             node->left = child->left;
             node->right = child->right;
+            endWrite(node);
 
-            omp_set_lock(&child->lock); //
-            omp_unset_lock(&child->lock); // Unlock (just to ensure no one else is holding it)
-            omp_destroy_lock(&child->lock);
-            free(child);
+            latchAcquireCounted(&child->lock); //
+            latchRelease(&child->lock); // Unlock (just to ensure no one else is holding it)
+            retireNode(child);
 
-            omp_unset_lock(&node->lock);
+            latchRelease(&node->lock);
             return root;
         }
 
         // Standard Case 2
+        beginWrite(parent);
         if (parent->left == node) {
             parent->left = isOnlyLeft ? node->left : node->right;
         }
         else {
             parent->right = isOnlyLeft ? node->left : node->right;
         }
+        endWrite(parent);
 
-        omp_unset_lock(&parent->lock);
-        omp_destroy_lock(&node->lock);
-        free(node);
+        if (releaseParent) latchRelease(&parent->lock);
+        latchRelease(&node->lock);
+        retireNode(node);
         return root;
     }
 
@@ -178,21 +415,23 @@ TreeNode* deleteNode(TreeNode* root, const int data) {
     if (hasLeftChild(node) && hasRightChild(node)) {
 
         // // We don't need the parent anymore
-        if (parent) omp_unset_lock(&parent->lock);
+        if (parent && releaseParent) latchRelease(&parent->lock);
 
         TreeNode* min_node_in_right_subtree = node->right, *parent_min_node = node;
 
         // We catch the lock of the min_node
-        omp_set_lock(&min_node_in_right_subtree->lock);
-        omp_lock_t* lock_to_free = NULL;
+        latchAcquireCounted(&min_node_in_right_subtree->lock);
+        Latch* lock_to_free = NULL;
 
         while (min_node_in_right_subtree != NULL) {
+            statsVisit();
+            addSize(min_node_in_right_subtree, -1);
 
-            if (lock_to_free) omp_unset_lock(lock_to_free);
+            if (lock_to_free) latchRelease(lock_to_free);
 
             if (min_node_in_right_subtree->left == NULL) break;
 
-            omp_set_lock(&min_node_in_right_subtree->left->lock);
+            latchAcquireCounted(&min_node_in_right_subtree->left->lock);
 
             lock_to_free = &min_node_in_right_subtree->lock;
             if (min_node_in_right_subtree->left->left == NULL) lock_to_free = NULL;
@@ -205,6 +444,7 @@ TreeNode* deleteNode(TreeNode* root, const int data) {
         const int replacement = min_node_in_right_subtree->data;
 
         // Delete the replacement node
+        beginWrite(parent_min_node);
         if (parent_min_node->left == min_node_in_right_subtree) {
             parent_min_node->left = min_node_in_right_subtree->right;
         }
@@ -212,162 +452,1578 @@ TreeNode* deleteNode(TreeNode* root, const int data) {
         else {
             parent_min_node->right = min_node_in_right_subtree->right;
         }
-        if (parent_min_node != node) omp_unset_lock(&parent_min_node->lock);
-        omp_destroy_lock(&min_node_in_right_subtree->lock);
-        free(min_node_in_right_subtree);
+        endWrite(parent_min_node);
+        if (parent_min_node != node) latchRelease(&parent_min_node->lock);
+        latchRelease(&min_node_in_right_subtree->lock);
+        retireNode(min_node_in_right_subtree);
 
         // Replace 'node' with the min node
+        beginWrite(node);
         node->data = replacement;
-        omp_unset_lock(&node->lock);
+        endWrite(node);
+        latchRelease(&node->lock);
 
     }
     return root;
 }
 
-// This function checks whether a given value is in the tree
-bool searchNode(const TreeNode* root, const int data) {
+/*
+ * This function sweeps sorted keys down the tree together. At every node they split between its two subtrees, keeping
+ * copies of the value of the node on the left, where the other copies are, except the last one, which is the node
+ * itself. So a path that many keys share is walked and latched once, and no node is visited twice.
+ * A node stays latched until both of its subtrees are done, and the node of a found key is removed on the way back
+ * up, while its parent is still latched, by the same code as deleteNode. Like deleteNode we take the keys off the size
+ * of a node when we latch it, before we know whether they are found, and give back the ones that were not before we
+ * let go of it. The frames are on a stack of our own, so a long path does not run out of call stack.
+ */
+static TreeNode* deleteSorted(TreeNode* root, const int* keys, const size_t n, bool* found, size_t* deleted) {
+    size_t capacity = 64, depth = 0, total = 0;
+    SweepFrame* stack = (SweepFrame*)malloc(capacity * sizeof(SweepFrame));
 
-    TreeNode* node = (TreeNode*)root;
+    statsBeginOperation();
+    epochEnter();
 
-    // Locking the current node
-    omp_set_lock(&node->lock);
-    omp_lock_t* lock_to_free = NULL;
-    while (node) {
+    TreeNode* next = root;
+    size_t first = 0, count = n;
+    latchAcquireCounted(&next->lock);
 
-        if (lock_to_free) omp_unset_lock(lock_to_free);
+    while (true) {
+        if (next) {
+            statsVisit();
+            addSize(next, -(long)count);
 
-        lock_to_free = &node->lock;
+            if (depth == capacity) {
+                capacity *= 2;
+                stack = (SweepFrame*)realloc(stack, capacity * sizeof(SweepFrame));
+            }
 
-        // If we found the data
-        if (node->data == data) {
-            omp_unset_lock(&node->lock);
-            return true;
+            SweepFrame* frame = &stack[depth++];
+            frame->node = next;
+            frame->first = first;
+            frame->count = count;
+            frame->low = sortedUpperBound(keys + first, count, next->data);
+            frame->own = frame->low > 0 && keys[first + frame->low - 1] == next->data;
+            frame->found = 0;
+            frame->stage = 0;
+            next = NULL;
         }
 
-        // We should go left
-        if (data <= node->data) {
+        SweepFrame* frame = &stack[depth - 1];
+        TreeNode* node = frame->node;
 
-            // If we should go left, but we cannot go left anymore -> return false
-            if (!node->left) {
-                omp_unset_lock(&node->lock);
-                return false;
+        // The keys of the left subtree go first, then the ones of the right subtree
+        if (frame->stage < 2) {
+            const int side = frame->stage++;
+            TreeNode* child = side == 0 ? node->left : node->right;
+            first = side == 0 ? frame->first : frame->first + frame->low;
+            count = side == 0 ? frame->low - frame->own : frame->count - frame->low;
+
+            if (child != NULL && count > 0) {
+                latchAcquireCounted(&child->lock);
+                next = child;
             }
+            continue;
+        }
 
-            omp_set_lock(&node->left->lock);
-            node = node->left;
+        // Both subtrees are done, so we know how many keys were found in the subtree of the node
+        const size_t subtreeFound = frame->found + frame->own;
+        addSize(node, (long)(frame->count - subtreeFound));
+        if (frame->own && found) found[frame->first + frame->low - 1] = true;
+
+        TreeNode* parent = NULL;
+        if (--depth > 0) {
+            stack[depth - 1].found += subtreeFound;
+            parent = stack[depth - 1].node;
+        }
+        else {
+            total = subtreeFound;
         }
 
-        // We should go right
-        else if (data > node->data) {
+        if (frame->own) root = unlinkNode(root, parent, node, false);
+        else latchRelease(&node->lock);
 
-            // If we should go right, but we cannot go right anymore-> return false
-            if (!node->right) {
-                omp_unset_lock(&node->lock);
-                return false;
-            }
+        if (depth == 0) break;
+    }
 
-            omp_set_lock(&node->right->lock);
-            node = node->right;
+    epochExit();
+    statsEndOperation();
+
+    free(stack);
+    if (deleted) *deleted = total;
+    return root;
+}
+
+/*
+ * This function inserts a new node to a balanced tree.
+ * Like insertNode we lock hand-over-hand, but we keep every node from the lowest node whose balance factor is not 0
+ * down to the insertion point. Above that node no height can change, so the only rotation happens inside the part
+ * of the path we hold, and the nodes it moves are all locked by us.
+ */
+TreeNode* insertBalanced(TreeNode* root, const int data) {
+
+    // If we receive a NULL root, we will create a new root and return the new tree.
+    if (root == NULL) {
+        return createNode(data);
+    }
+
+    NodePath path;
+    pathInit(&path);
+
+    statsBeginOperation();
+    TreeNode* node = root;
+    latchAcquireCounted(&node->lock);
+    pathPush(&path, node);
+
+    while (true) {
+        statsVisit();
+        addSize(node, 1);
+
+        // An unbalanced node absorbs the height change, so its ancestors are not needed anymore
+        if (balanceFactor(node) != 0) pathReleaseAbove(&path, NULL);
+
+        TreeNode** child = data <= node->data ? &node->left : &node->right;
+
+        // We found the place of the new node
+        if (*child == NULL) {
+            TreeNode* leaf = newNode(arenaOf(node), data);
+            beginWrite(node);
+            *child = leaf;
+            endWrite(node);
+            break;
         }
+
+        latchAcquireCounted(&(*child)->lock);
+        node = *child;
+        pathPush(&path, node);
     }
 
-    return false;
+    // Fix the heights bottom-up, rotating where the tree became unbalanced
+    for (size_t i = path.count; i > 0; --i) {
+        updateHeight(path.nodes[i - 1]);
+        rebalance(path.nodes[i - 1], false);
+    }
+
+    for (size_t i = 0; i < path.count; ++i) latchRelease(&path.nodes[i]->lock);
+    pathDestroy(&path);
+    statsEndOperation();
+
+    return root;
 }
 
-// This function returns the node with the minimal value in the tree
-TreeNode* findMin(const TreeNode* root) {
+/*
+ * This function deletes a node from a balanced tree.
+ * We keep every node from the lowest node whose balance factor is 0 down to the removed node (a removal below such
+ * a node cannot change its height), and the node whose value is replaced by its successor.
+ * Rotations on the way back up lock the sibling subtrees they move.
+ *
+ * Like deleteNode we take the value off the sizes on the way down, but here a rotation may move a node we let go of
+ * out of the path, so a delete that finds nothing cannot just give the sizes back. We check that the value is in the
+ * tree first, and only when another delete takes it between the check and our walk, repairSizes fixes the path.
+ */
+TreeNode* deleteBalanced(TreeNode* root, const int data) {
 
-    // If the tree is non-existent we return null
     if (root == NULL) return NULL;
+    if (!searchValue(root, data)) return root;
 
-    TreeNode* node = (TreeNode*)root;
+    NodePath path;
+    pathInit(&path);
 
-    // Locking the initial node
-    omp_set_lock(&node->lock);
-    omp_lock_t* lock_to_free = NULL;
-    while (node->left != NULL) {
+    statsBeginOperation();
+    TreeNode* node = root, *target = NULL;
+    latchAcquireCounted(&node->lock);
+    pathPush(&path, node);
 
-        if (lock_to_free) omp_unset_lock(lock_to_free);
+    // Finding the node to remove. If the value sits in a node with two children we remove its successor instead.
+    while (true) {
+        statsVisit();
+        addSize(node, -1);
 
-        lock_to_free = &node->lock;
+        if (target == NULL && node->data == data) {
+            target = node;
+            if (!hasLeftChild(node) || !hasRightChild(node)) break;
+        }
+        else if (target != NULL && node->left == NULL) {
+            break;
+        }
 
-        omp_set_lock(&node->left->lock);
-        node = node->left;
+        if (node != target && balanceFactor(node) == 0) pathReleaseAbove(&path, target);
+
+        TreeNode* next;
+        if (target == node) next = node->right;
+        else if (target != NULL) next = node->left;
+        else next = data <= node->data ? node->left : node->right;
+
+        // If the given value is not in the tree anymore
+        if (next == NULL) {
+            for (size_t i = 0; i < path.count; ++i) latchRelease(&path.nodes[i]->lock);
+            pathDestroy(&path);
+            repairSizes(root, data);
+            statsEndOperation();
+            return root;
+        }
+
+        latchAcquireCounted(&next->lock);
+        node = next;
+        pathPush(&path, node);
     }
 
-    if (lock_to_free) omp_unset_lock(lock_to_free);
-    omp_unset_lock(&node->lock);
-    return (TreeNode*)node;
-}
+    // The removed node has at most one child, which takes its place
+    TreeNode* removed = node;
+    TreeNode* child = hasLeftChild(removed) ? removed->left : removed->right;
+
+    if (removed == root) {
+        if (child == NULL) {
+            NodeArena* arena = arenaOf(root);
+            latchRelease(&root->lock);
+            retireNode(root);
+            arenaRelease(arena);
+            pathDestroy(&path);
+            statsEndOperation();
+            return NULL;
+        }
 
-// Prints the inorder traversal
-void inorderTraversal(TreeNode* root) {
-    if (root == NULL) return;
+        // A node with a single child in an AVL tree has a leaf as its child, so we can promote it into the root
+        latchAcquireCounted(&child->lock);
+        beginWrite(root);
+        root->data = child->data;
+        root->left = NULL;
+        root->right = NULL;
+        root->height = 1;
+        endWrite(root);
+        __atomic_store_n(&root->size, 1, __ATOMIC_RELAXED);
+        latchRelease(&child->lock);
+        retireNode(child);
+
+        latchRelease(&root->lock);
+        pathDestroy(&path);
+        statsEndOperation();
+        return root;
+    }
+
+    TreeNode* parent = path.nodes[path.count - 2];
+    beginWrite(parent);
+    if (parent->left == removed) parent->left = child;
+    else parent->right = child;
+    endWrite(parent);
+
+    if (target != removed) {
+        beginWrite(target);
+        target->data = removed->data;
+        endWrite(target);
+    }
 
-    omp_set_lock(&root->lock);
+    path.count--;
+    latchRelease(&removed->lock);
+    retireNode(removed);
 
-    inorderTraversal(root->left);
-    printf("%d ", root->data);
-    inorderTraversal(root->right);
+    // Fix the heights bottom-up, rotating where the tree became unbalanced
+    bool isTargetInPath = false;
+    for (size_t i = path.count; i > 0; --i) {
+        updateHeight(path.nodes[i - 1]);
+        rebalance(path.nodes[i - 1], true);
+        if (path.nodes[i - 1] == target) isTargetInPath = true;
+    }
+
+    for (size_t i = 0; i < path.count; ++i) latchRelease(&path.nodes[i]->lock);
+    if (target != removed && !isTargetInPath) latchRelease(&target->lock);
+    pathDestroy(&path);
+    statsEndOperation();
 
-    omp_unset_lock(&root->lock);
+    return root;
 }
 
-// Prints the preorder traversal
-void preorderTraversal(TreeNode* root) {
-    if (root == NULL) return;
+// This function inserts a batch of values
+TreeNode* insertBatch(TreeNode* root, const int* keys, const size_t n) {
+    if (n == 0) return root;
 
-    omp_set_lock(&root->lock);
+    int* sorted = (int*)malloc(n * sizeof(int));
+    memcpy(sorted, keys, n * sizeof(int));
+    qsort(sorted, n, sizeof(int), compareInts);
 
-    printf("%d ", root->data);
-    preorderTraversal(root->left);
-    preorderTraversal(root->right);
+    if (root == NULL) {
+        root = buildSubtree(arenaCreate(), sorted, n);
+    }
+    else {
+        latchAcquireCounted(&root->lock);
+        mergeBatch(root, sorted, n);
+    }
 
-    omp_unset_lock(&root->lock);
+    free(sorted);
+    return root;
 }
 
-// Prints the post order traversal
-void postorderTraversal(TreeNode* root) {
+/*
+ * This function deletes a range of values.
+ * All of them lie in the subtree of the highest node inside the range, the 'split' node. In its left subtree the
+ * values smaller than lo stay: walking down from there, a node smaller than lo stays and we go right, any other node
+ * goes together with its right subtree and we go left. The nodes that stay are linked into a chain of right children.
+ * The right subtree of the split node is the mirror, a chain of left children of the values greater than hi.
+ * The split node itself stays in its place and takes the value of the last node of the lower chain (the largest value
+ * that stays below the range), or of the upper chain, which leaves the tree like a node with one child. So every node
+ * that stays is still above the same places, and deletes that are still on their way down give back their sizes
+ * to the right nodes (see deleteUnbalanced). Only when no value stays in the subtree the split node goes as well.
+ * We hold the path from the root and both cut paths while we relink them, so the sizes above the split node lose
+ * exactly what its subtree lost. The removed nodes are unreachable once we let go, and only then we retire them.
+ */
+TreeNode* deleteRange(TreeNode* root, const int lo, const int hi, size_t* deleted) {
+    size_t count = 0;
+    if (deleted) *deleted = 0;
+    if (root == NULL || lo > hi) return root;
+
+    statsBeginOperation();
+    epochEnter();
+
+    NodePath above;
+    pathInit(&above);
+
+    TreeNode* split = root;
+    latchAcquireCounted(&split->lock);
+    while (split->data < lo || split->data > hi) {
+        statsVisit();
+        pathPush(&above, split);
+
+        TreeNode* next = split->data < lo ? split->right : split->left;
+
+        // If no value of the tree is in the range
+        if (next == NULL) {
+            for (size_t i = 0; i < above.count; ++i) latchRelease(&above.nodes[i]->lock);
+            pathDestroy(&above);
+            epochExit();
+            statsEndOperation();
+            return root;
+        }
 
-    if (root == NULL) return;
+        latchAcquireCounted(&next->lock);
+        split = next;
+    }
+    statsVisit();
+
+    RangeCut cut;
+    pathInit(&cut.kept[0]);
+    pathInit(&cut.kept[1]);
+    cut.removed = NULL;
+    cut.count = 0;
+    cut.capacity = 0;
+    cutPath(&cut, split->left, lo, 0);
+    cutPath(&cut, split->right, hi, 1);
+
+    // The node whose value moves into the split node leaves its chain, and its only child takes its place
+    TreeNode* replacement = NULL;
+    TreeNode* tails[2] = { NULL, NULL };
+    int replacementSide = -1;
+    if (cut.kept[0].count > 0) {
+        replacement = cut.kept[0].nodes[--cut.kept[0].count];
+        replacementSide = 0;
+        tails[0] = replacement->left;
+    }
+    else if (cut.kept[1].count > 0) {
+        replacement = cut.kept[1].nodes[--cut.kept[1].count];
+        replacementSide = 1;
+        tails[1] = replacement->right;
+    }
+
+    /*
+     * Link each chain in the direction of its walk. Sizes are only ever changed by adding to them, since deletes that
+     * are still on their way down may give theirs back at any time: a kept node loses the nodes that were removed
+     * below it on its path, with their subtrees, which we add up as we go up the chain.
+     */
+    TreeNode* tops[2];
+    size_t removedNodes = 1, first = 0;
+    for (int side = 0; side < 2; ++side) {
+        NodePath* kept = &cut.kept[side];
+
+        size_t last = first;
+        while (last < cut.count && cut.removed[last].side == side) last++;
+
+        size_t lost = side == replacementSide ? 1 : 0, below = last;
+        for (size_t i = kept->count; i > 0; --i) {
+            TreeNode* node = kept->nodes[i - 1];
+            TreeNode* next = i < kept->count ? kept->nodes[i] : tails[side];
+            TreeNode** link = side == 0 ? &node->right : &node->left;
+            if (*link != next) {
+                beginWrite(node);
+                *link = next;
+                endWrite(node);
+            }
+
+            while (below > first && cut.removed[below - 1].kept >= i) lost += 1 + cut.removed[--below].size;
+            addSize(node, -(long)lost);
+        }
+
+        for (size_t i = first; i < last; ++i) removedNodes += 1 + cut.removed[i].size;
+        tops[side] = kept->count > 0 ? kept->nodes[0] : tails[side];
+        first = last;
+    }
 
-    omp_set_lock(&root->lock);
+    // The split node loses its value, and the replacement node or the split node itself leaves the tree
+    bool isEmpty = false;
+    count++;
+    if (replacement) {
+        beginWrite(split);
+        split->data = replacement->data;
+        split->left = tops[0];
+        split->right = tops[1];
+        endWrite(split);
+        addSize(split, -(long)removedNodes);
+    }
+    else if (above.count > 0) {
+        TreeNode* parent = above.nodes[above.count - 1];
+        beginWrite(parent);
+        if (parent->left == split) parent->left = NULL;
+        else parent->right = NULL;
+        endWrite(parent);
+    }
+    else {
+        isEmpty = true;
+    }
+    for (size_t i = 0; i < above.count; ++i) addSize(above.nodes[i], -(long)removedNodes);
+
+    for (size_t i = 0; i < above.count; ++i) latchRelease(&above.nodes[i]->lock);
+    for (int side = 0; side < 2; ++side) {
+        for (size_t i = 0; i < cut.kept[side].count; ++i) latchRelease(&cut.kept[side].nodes[i]->lock);
+    }
+
+    // Everything below is unreachable now
+    NodeArena* arena = arenaOf(root);
+    if (replacement) {
+        latchRelease(&replacement->lock);
+        retireNode(replacement);
+        latchRelease(&split->lock);
+    }
+    else {
+        latchRelease(&split->lock);
+        retireNode(split);
+    }
 
-    postorderTraversal(root->left);
-    postorderTraversal(root->right);
-    printf("%d ", root->data);
+    /*
+     * A deleteNode that was inside a detached subtree when we cut it off and does not find its value gives the sizes
+     * back along its path, which includes the nodes that were above the subtree. If the subtree turns out to hold
+     * more nodes than its size said, that is what these nodes got back, and we take it off them again. The nodes of
+     * the path that were removed meanwhile are still safe to change in our epoch.
+     */
+    for (size_t i = 0; i < cut.count; ++i) {
+        const CutNode* removed = &cut.removed[i];
+        latchRelease(&removed->node->lock);
+        retireNode(removed->node);
+        count++;
+
+        if (removed->subtree == NULL) continue;
+        const size_t retired = retireSubtree(removed->subtree);
+        count += retired;
+
+        const long excess = (long)retired - (long)removed->size;
+        if (excess == 0) continue;
+
+        const NodePath* kept = &cut.kept[removed->side];
+        for (size_t j = 0; j < above.count; ++j) addSize(above.nodes[j], -excess);
+        if (replacement) addSize(split, -excess);
+        for (size_t j = 0; j < removed->kept && j < kept->count; ++j) addSize(kept->nodes[j], -excess);
+    }
 
-    omp_unset_lock(&root->lock);
+    pathDestroy(&above);
+    pathDestroy(&cut.kept[0]);
+    pathDestroy(&cut.kept[1]);
+    free(cut.removed);
+    epochExit();
+    statsEndOperation();
+
+    if (deleted) *deleted = count;
+    if (isEmpty) {
+        arenaRelease(arena);
+        return NULL;
+    }
+    return root;
 }
 
-// Free the tree
-void freeTree(TreeNode* root) {
-    // 1. Base case: if the node is NULL, there's nothing to do
-    if (root == NULL) return;
+// This function deletes a batch of values
+TreeNode* deleteBatch(TreeNode* root, const int* keys, const size_t n, size_t* deleted) {
+    if (deleted) *deleted = 0;
+    if (root == NULL || n == 0) return root;
 
-    // 2. Recursively free the left subtree
-    freeTree(root->left);
+    int* sorted = (int*)malloc(n * sizeof(int));
+    memcpy(sorted, keys, n * sizeof(int));
+    qsort(sorted, n, sizeof(int), compareInts);
 
-    // 3. Recursively free the right subtree
-    freeTree(root->right);
+    root = deleteSorted(root, sorted, n, NULL, deleted);
 
-    // 4. Finally, free the current node
-    omp_destroy_lock(&(root->lock));
-    free(root);
+    free(sorted);
+    return root;
 }
 
-// This function checks whether a TreeNode* is a leaf
-static inline bool isLeaf(const TreeNode* root) {
+// The keys are sorted with their indices, so the results can be put back in the order of the caller
+TreeNode* deleteBatchChecked(TreeNode* root, const int* keys, const size_t n, bool* isDeleted) {
+    for (size_t i = 0; i < n; ++i) isDeleted[i] = false;
+    if (root == NULL || n == 0) return root;
+
+    IndexedKey* indexed = (IndexedKey*)malloc(n * sizeof(IndexedKey));
+    for (size_t i = 0; i < n; ++i) {
+        indexed[i].data = keys[i];
+        indexed[i].index = i;
+    }
+    qsort(indexed, n, sizeof(IndexedKey), compareIndexedKeys);
+
+    int* sorted = (int*)malloc(n * sizeof(int));
+    bool* found = (bool*)calloc(n, sizeof(bool));
+    for (size_t i = 0; i < n; ++i) sorted[i] = indexed[i].data;
+
+    root = deleteSorted(root, sorted, n, found, NULL);
+
+    // Copies of a value may be found anywhere among its keys, but the first ones in the caller's order get them
+    for (size_t i = 0; i < n;) {
+        size_t end = i, copies = 0;
+        for (; end < n && sorted[end] == sorted[i]; ++end) copies += found[end];
+        for (; i < end; ++i, copies -= copies > 0) isDeleted[indexed[i].index] = copies > 0;
+    }
+
+    free(indexed);
+    free(sorted);
+    free(found);
+    return root;
+}
+
+// This function checks whether a given value is in the tree
+bool searchNode(const TreeNode* root, const int data) {
+
     if (root == NULL) return false;
-    return root->left == NULL && root->right == NULL;
+
+    statsBeginOperation();
+    const bool found = searchValue(root, data);
+    statsEndOperation();
+
+    return found;
 }
 
-// This function checks whether a root has a left child
-static inline bool hasLeftChild(const TreeNode* root) {
-    return root != NULL && root->left != NULL;
+/*
+ * This function looks up many values at once.
+ * Each lookup is a chain of dependent loads, so a single one keeps the CPU waiting on every level. Here we keep a group
+ * of lookups in flight and advance them in turns, one level each: after a lookup picks its next node we prefetch it
+ * and move on to the others, so by the time we come back the node is usually in the cache.
+ */
+void searchBatch(const TreeNode* root, const int* keys, const size_t n, bool* out) {
+
+    if (root == NULL) {
+        for (size_t i = 0; i < n; ++i) out[i] = false;
+        return;
+    }
+
+    BatchLookup group[SEARCH_BATCH_GROUP];
+    size_t next = 0;
+    int active = 0;
+
+    epochEnter();
+
+    while (active < SEARCH_BATCH_GROUP && next < n) {
+        group[active].parent = NULL;
+        group[active].node = root;
+        group[active].index = next++;
+        active++;
+    }
+
+    while (active > 0) {
+        for (int i = 0; i < active;) {
+
+            if (!lookupStep(root, &group[i], keys, out)) {
+                i++;
+                continue;
+            }
+
+            // The lookup is done, its slot takes the next key or the last lookup of the group
+            if (next < n) {
+                group[i].parent = NULL;
+                group[i].node = root;
+                group[i].index = next++;
+                i++;
+            }
+            else {
+                group[i] = group[--active];
+            }
+        }
+    }
+
+    epochExit();
 }
 
-// This function checks whether a root has a right child
-static inline bool hasRightChild(const TreeNode* root) {
-    return root != NULL && root->right != NULL;
-}
\ No newline at end of file
+/*
+ * This function searches the tree without taking any lock.
+ * Before moving to a child we read the child's version and then validate the parent: if the parent did not change,
+ * the child was really its child when we read it. We run inside an epoch, so even a node that was removed under us
+ * is not reclaimed before we are done, and its changed version tells us to start over.
+ */
+static bool searchOptimistic(const TreeNode* root, const int data, bool* found) {
+
+    const TreeNode* node = root;
+    unsigned int version;
+    if (!readBegin(node, &version)) return false;
+
+    while (true) {
+        statsVisit();
+        const int value = __atomic_load_n(&node->data, __ATOMIC_RELAXED);
+
+        // If we found the data
+        if (value == data) {
+            *found = true;
+            return readValidate(node, version);
+        }
+
+        const TreeNode* child = data <= value ? __atomic_load_n(&node->left, __ATOMIC_RELAXED)
+                                              : __atomic_load_n(&node->right, __ATOMIC_RELAXED);
+
+        if (!readValidate(node, version)) return false;
+
+        // If we cannot go further the value is not in the tree
+        if (child == NULL) {
+            *found = false;
+            return true;
+        }
+
+        unsigned int child_version;
+        if (!readBegin(child, &child_version)) return false;
+        if (!readValidate(node, version)) return false;
+
+        node = child;
+        version = child_version;
+    }
+}
+
+/*
+ * One step of a batched lookup, following the same rules as searchOptimistic. The version of the node is read only
+ * now, after it had time to arrive in the cache, and the parent is validated after it to make sure the node was
+ * still its child. A lookup that runs into a writer is finished on the spot by searchNode.
+ */
+static bool lookupStep(const TreeNode* root, BatchLookup* lookup, const int* keys, bool* out) {
+
+    const int data = keys[lookup->index];
+    const TreeNode* node = lookup->node;
+
+    unsigned int version;
+    if (!readBegin(node, &version) ||
+        (lookup->parent != NULL && !readValidate(lookup->parent, lookup->parentVersion))) {
+        out[lookup->index] = searchNode(root, data);
+        return true;
+    }
+
+    const int value = __atomic_load_n(&node->data, __ATOMIC_RELAXED);
+    const TreeNode* child = data <= value ? __atomic_load_n(&node->left, __ATOMIC_RELAXED)
+                                          : __atomic_load_n(&node->right, __ATOMIC_RELAXED);
+
+    if (!readValidate(node, version)) {
+        out[lookup->index] = searchNode(root, data);
+        return true;
+    }
+
+    // If we found the data, or we cannot go further
+    if (value == data || child == NULL) {
+        out[lookup->index] = value == data;
+        return true;
+    }
+
+    __builtin_prefetch(child);
+    lookup->parent = node;
+    lookup->parentVersion = version;
+    lookup->node = child;
+    return false;
+}
+
+// We first try to walk the tree without any lock. The epoch keeps the nodes we pass from being reclaimed.
+static bool searchValue(const TreeNode* root, const int data) {
+    epochEnter();
+    for (int attempt = 0; attempt < OPTIMISTIC_RETRIES; ++attempt) {
+        bool found = false;
+        if (searchOptimistic(root, data, &found)) {
+            epochExit();
+            return found;
+        }
+    }
+    epochExit();
+
+    // Writers keep changing our path, so we wait for them like everybody else
+    return searchLocked(root, data);
+}
+
+// This function checks whether a given value is in the tree, locking hand-over-hand
+static bool searchLocked(const TreeNode* root, const int data) {
+
+    TreeNode* node = (TreeNode*)root;
+
+    // Locking the current node
+    latchAcquireSharedCounted(&node->lock);
+    Latch* lock_to_free = NULL;
+    while (node) {
+        statsVisit();
+
+        if (lock_to_free) latchReleaseShared(lock_to_free);
+
+        lock_to_free = &node->lock;
+
+        // If we found the data
+        if (node->data == data) {
+            latchReleaseShared(&node->lock);
+            return true;
+        }
+
+        // We should go left
+        if (data <= node->data) {
+
+            // If we should go left, but we cannot go left anymore -> return false
+            if (!node->left) {
+                latchReleaseShared(&node->lock);
+                return false;
+            }
+
+            latchAcquireSharedCounted(&node->left->lock);
+            node = node->left;
+        }
+
+        // We should go right
+        else if (data > node->data) {
+
+            // If we should go right, but we cannot go right anymore-> return false
+            if (!node->right) {
+                latchReleaseShared(&node->lock);
+                return false;
+            }
+
+            latchAcquireSharedCounted(&node->right->lock);
+            node = node->right;
+        }
+    }
+
+    return false;
+}
+
+// This function returns the node with the minimal value in the tree
+TreeNode* findMin(const TreeNode* root) {
+
+    // If the tree is non-existent we return null
+    if (root == NULL) return NULL;
+
+    TreeNode* node = (TreeNode*)root;
+
+    // Locking the initial node
+    statsBeginOperation();
+    statsVisit();
+    latchAcquireSharedCounted(&node->lock);
+    Latch* lock_to_free = NULL;
+    while (node->left != NULL) {
+        statsVisit();
+
+        if (lock_to_free) latchReleaseShared(lock_to_free);
+
+        lock_to_free = &node->lock;
+
+        latchAcquireSharedCounted(&node->left->lock);
+        node = node->left;
+    }
+
+    if (lock_to_free) latchReleaseShared(lock_to_free);
+    latchReleaseShared(&node->lock);
+    statsEndOperation();
+    return (TreeNode*)node;
+}
+
+// Every node smaller than the value counts with its left subtree, and then we go right
+size_t treeRank(const TreeNode* root, const int data) {
+    if (root == NULL) return 0;
+
+    TreeNode* node = (TreeNode*)root;
+    latchAcquireSharedCounted(&node->lock);
+
+    size_t rank = 0;
+    while (node) {
+        TreeNode* next = node->left;
+        if (node->data < data) {
+            rank += nodeSize(node->left) + 1;
+            next = node->right;
+        }
+
+        if (next) latchAcquireSharedCounted(&next->lock);
+        latchReleaseShared(&node->lock);
+        node = next;
+    }
+
+    return rank;
+}
+
+/*
+ * The left subtree holds the first values, then the node, then the right subtree.
+ * The sizes may count a delete that has not removed its node yet, or miss one that has, so the walk can run out of
+ * nodes on the right. Then the tree has no k-th value anymore.
+ */
+bool treeSelect(const TreeNode* root, size_t k, int* data) {
+    if (root == NULL) return false;
+
+    TreeNode* node = (TreeNode*)root;
+    latchAcquireSharedCounted(&node->lock);
+
+    while (true) {
+        const size_t left = nodeSize(node->left);
+
+        TreeNode* next;
+        if (k < left) {
+            next = node->left;
+        }
+        else if (k == left) {
+            *data = node->data;
+            latchReleaseShared(&node->lock);
+            return true;
+        }
+        else {
+            k -= left + 1;
+            next = node->right;
+        }
+
+        if (next == NULL) {
+            latchReleaseShared(&node->lock);
+            return false;
+        }
+
+        latchAcquireSharedCounted(&next->lock);
+        latchReleaseShared(&node->lock);
+        node = next;
+    }
+}
+
+/*
+ * We walk down to the highest node inside [lo, hi]. All the values of the range are in its subtree: its left subtree
+ * holds the ones from lo up, and its right subtree the ones up to hi.
+ */
+size_t treeCountRange(const TreeNode* root, const int lo, const int hi) {
+    if (root == NULL || lo > hi) return 0;
+
+    TreeNode* node = (TreeNode*)root;
+    latchAcquireSharedCounted(&node->lock);
+
+    while (node->data < lo || node->data > hi) {
+        TreeNode* next = node->data < lo ? node->right : node->left;
+        if (next) latchAcquireSharedCounted(&next->lock);
+        latchReleaseShared(&node->lock);
+
+        if (next == NULL) return 0;
+        node = next;
+    }
+
+    const size_t count = 1 + countSide(node->left, lo, true) + countSide(node->right, hi, false);
+    latchReleaseShared(&node->lock);
+
+    return count;
+}
+
+// Prints the inorder traversal
+void inorderTraversal(TreeNode* root) {
+    TreeIterator iterator;
+    int data;
+
+    iteratorInit(&iterator, root);
+    while (iteratorNext(&iterator, &data)) printf("%d ", data);
+    iteratorDestroy(&iterator);
+}
+
+// Start an iterator at the minimal value
+void iteratorInit(TreeIterator* iterator, TreeNode* root) {
+    iteratorInitFrom(iterator, root, INT_MIN);
+}
+
+// Start an iterator at the first value that is not smaller than lo
+void iteratorInitFrom(TreeIterator* iterator, TreeNode* root, const int lo) {
+    pathInit(&iterator->path);
+    if (root == NULL) return;
+
+    latchAcquireSharedCounted(&root->lock);
+    iteratorDescend(iterator, root, lo);
+}
+
+/*
+ * This function moves the iterator to the next value.
+ * The top of the stack is the next node in order. Its value is read, its right child is latched and then the node
+ * itself is released: we will never come back to it, so a writer may change it right away.
+ */
+bool iteratorNext(TreeIterator* iterator, int* data) {
+    NodePath* path = &iterator->path;
+    if (path->count == 0) return false;
+
+    TreeNode* node = path->nodes[--path->count];
+    *data = node->data;
+
+    TreeNode* right = node->right;
+    if (right) latchAcquireSharedCounted(&right->lock);
+    latchReleaseShared(&node->lock);
+
+    if (right) iteratorDescend(iterator, right, INT_MIN);
+    return true;
+}
+
+// Release whatever the iterator still holds
+void iteratorDestroy(TreeIterator* iterator) {
+    NodePath* path = &iterator->path;
+
+    while (path->count > 0) latchReleaseShared(&path->nodes[--path->count]->lock);
+    pathDestroy(path);
+}
+
+// Pass every value in [lo, hi] to the callback, in order, until it asks to stop
+size_t rangeScan(TreeNode* root, const int lo, const int hi, const ScanCallback callback, void* context) {
+    TreeIterator iterator;
+    size_t count = 0;
+    int data;
+
+    iteratorInitFrom(&iterator, root, lo);
+    while (iteratorNext(&iterator, &data) && data <= hi) {
+        count++;
+        if (!callback(data, context)) break;
+    }
+    iteratorDestroy(&iterator);
+
+    return count;
+}
+
+/*
+ * Prints the preorder traversal.
+ * The stack holds the latched subtrees that are still to be printed, so the traversal does not recurse and degenerate
+ * trees cannot overflow the call stack. A node is released once its children are latched and pushed (the right one
+ * first, so the left one is printed first); the stack holds at most one pending right child per level.
+ */
+void preorderTraversal(TreeNode* root) {
+    if (root == NULL) return;
+
+    NodePath path;
+    pathInit(&path);
+
+    latchAcquireSharedCounted(&root->lock);
+    pathPush(&path, root);
+
+    while (path.count > 0) {
+        TreeNode* node = path.nodes[--path.count];
+        printf("%d ", node->data);
+
+        if (node->right) {
+            latchAcquireSharedCounted(&node->right->lock);
+            pathPush(&path, node->right);
+        }
+        if (node->left) {
+            latchAcquireSharedCounted(&node->left->lock);
+            pathPush(&path, node->left);
+        }
+        latchReleaseShared(&node->lock);
+    }
+
+    pathDestroy(&path);
+}
+
+/*
+ * Prints the post order traversal.
+ * The stack holds the latched path from the root to the current node, like the recursion did. When the left subtree
+ * of the top node is done we go down its right subtree, unless we just came back from there: then the node itself is
+ * printed and released.
+ */
+void postorderTraversal(TreeNode* root) {
+    if (root == NULL) return;
+
+    NodePath path;
+    pathInit(&path);
+
+    TreeNode* node = root;
+    const TreeNode* last = NULL;
+    latchAcquireSharedCounted(&node->lock);
+
+    while (node || path.count > 0) {
+        if (node) {
+            pathPush(&path, node);
+            node = node->left;
+            if (node) latchAcquireSharedCounted(&node->lock);
+            continue;
+        }
+
+        TreeNode* top = path.nodes[path.count - 1];
+        if (top->right && top->right != last) {
+            node = top->right;
+            latchAcquireSharedCounted(&node->lock);
+            continue;
+        }
+
+        printf("%d ", top->data);
+        path.count--;
+        latchReleaseShared(&top->lock);
+        last = top;
+    }
+
+    pathDestroy(&path);
+}
+
+// Combine all the values of the tree in order
+long long treeReduce(const TreeNode* root, const ReduceOp op, const long long identity) {
+    return reduceTree(root, op, identity);
+}
+
+// Count the nodes of the tree
+size_t treeCount(const TreeNode* root) {
+    return (size_t)reduceTree(root, NULL, 0);
+}
+
+// Free the tree. All of its nodes live in its arena, so we release the arena instead of visiting every node.
+void freeTree(TreeNode* root) {
+    if (root == NULL) return;
+
+    arenaRelease(arenaOf(root));
+}
+
+// This function checks whether a TreeNode* is a leaf
+static inline bool isLeaf(const TreeNode* root) {
+    if (root == NULL) return false;
+    return root->left == NULL && root->right == NULL;
+}
+
+// This function checks whether a root has a left child
+static inline bool hasLeftChild(const TreeNode* root) {
+    return root != NULL && root->left != NULL;
+}
+
+// This function checks whether a root has a right child
+static inline bool hasRightChild(const TreeNode* root) {
+    return root != NULL && root->right != NULL;
+}
+
+// This function marks the start of a change to a locked node
+static inline void beginWrite(TreeNode* node) {
+    __atomic_store_n(&node->version, node->version + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// This function marks the end of a change to a locked node
+static inline void endWrite(TreeNode* node) {
+    __atomic_store_n(&node->version, node->version + 1, __ATOMIC_RELEASE);
+}
+
+// This function reads the version of a node before reading it, failing if a writer is in the middle of a change
+static inline bool readBegin(const TreeNode* node, unsigned int* version) {
+    *version = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+    return *version % 2 == 0;
+}
+
+// This function checks that a node did not change since readBegin returned the given version
+static inline bool readValidate(const TreeNode* node, const unsigned int version) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&node->version, __ATOMIC_RELAXED) == version;
+}
+
+// This function creates a node in the arena of an existing tree
+static TreeNode* newNode(NodeArena* arena, const int data) {
+    TreeNode* node = arenaAlloc(arena);
+    statsAllocation();
+
+    // A reused node may still be read by a late lock-free reader, so we keep its version counter going
+    beginWrite(node);
+    node->data = data;
+    node->left = NULL;
+    node->right = NULL;
+    node->height = 1;
+    node->size = 1;
+    endWrite(node);
+
+    return node;
+}
+
+// This function returns a removed node to its arena
+static void retireNode(TreeNode* node) {
+
+    // Readers that are still looking at the node will fail their validation
+    beginWrite(node);
+    endWrite(node);
+
+    arenaRetire(node);
+}
+
+// Initializes an empty path that uses its inline buffer
+static void pathInit(NodePath* path) {
+    path->nodes = path->buffer;
+    path->count = 0;
+    path->capacity = sizeof(path->buffer) / sizeof(path->buffer[0]);
+}
+
+// Pushes a node to the path, moving it to the heap when the inline buffer is full
+static void pathPush(NodePath* path, TreeNode* node) {
+    if (path->count == path->capacity) {
+        TreeNode** nodes = (TreeNode**)malloc(2 * path->capacity * sizeof(TreeNode*));
+        for (size_t i = 0; i < path->count; ++i) nodes[i] = path->nodes[i];
+        if (path->nodes != path->buffer) free(path->nodes);
+        path->nodes = nodes;
+        path->capacity *= 2;
+    }
+    path->nodes[path->count++] = node;
+}
+
+/*
+ * Walk down from a latched node with lock coupling. A node with a value not smaller than lo still has to be visited,
+ * so it stays latched on the stack and we go left. A smaller value is skipped together with its left subtree: we go
+ * right and let go of it.
+ */
+static void iteratorDescend(TreeIterator* iterator, TreeNode* node, const int lo) {
+    while (node) {
+        const bool visit = node->data >= lo;
+        TreeNode* next = visit ? node->left : node->right;
+
+        if (next) latchAcquireSharedCounted(&next->lock);
+        if (visit) pathPush(&iterator->path, node);
+        else latchReleaseShared(&node->lock);
+
+        node = next;
+    }
+}
+
+// Frees the heap memory of the path, if it has any
+static void pathDestroy(NodePath* path) {
+    if (path->nodes != path->buffer) free(path->nodes);
+}
+
+// Unlocks every node in the path above the last one, except 'keep' which stays locked and leaves the path
+static void pathReleaseAbove(NodePath* path, const TreeNode* keep) {
+    if (path->count < 2) return;
+
+    for (size_t i = 0; i + 1 < path->count; ++i) {
+        if (path->nodes[i] != keep) latchRelease(&path->nodes[i]->lock);
+    }
+    path->nodes[0] = path->nodes[path->count - 1];
+    path->count = 1;
+}
+
+/*
+ * This function returns the height of a node.
+ * The balanced functions only read the height of a child they do not hold when no other writer holds its parent,
+ * and such a child either is unlocked or is the top of another writer's locked path, whose height cannot change.
+ */
+static inline int nodeHeight(const TreeNode* node) {
+    return node == NULL ? 0 : node->height;
+}
+
+// This function returns the difference between the heights of the left and right subtrees
+static inline int balanceFactor(const TreeNode* node) {
+    return nodeHeight(node->left) - nodeHeight(node->right);
+}
+
+// This function recomputes the height of a node from its children
+static inline void updateHeight(TreeNode* node) {
+    const int left = nodeHeight(node->left), right = nodeHeight(node->right);
+    node->height = 1 + (left > right ? left : right);
+}
+
+static inline size_t nodeSize(const TreeNode* node) {
+    return node == NULL ? 0 : __atomic_load_n(&node->size, __ATOMIC_RELAXED);
+}
+
+// Sizes wrap around like unsigned ints, so a negative delta is added as its two's complement
+static inline void addSize(TreeNode* node, const long delta) {
+    __atomic_add_fetch(&node->size, (unsigned int)delta, __ATOMIC_RELAXED);
+}
+
+// This function recomputes the size of a node from its children
+static inline void updateSize(TreeNode* node) {
+    __atomic_store_n(&node->size, (unsigned int)(1 + nodeSize(node->left) + nodeSize(node->right)), __ATOMIC_RELAXED);
+}
+
+/*
+ * This function rotates a node with its left child without moving the node itself.
+ * The node takes the data of its left child, and the left child becomes the right child holding the old data:
+ * (x (y A B) C) becomes (y A (x B C)).
+ */
+static void rotateRight(TreeNode* node) {
+    TreeNode* left = node->left;
+
+    beginWrite(node);
+    beginWrite(left);
+
+    const int data = node->data;
+    node->data = left->data;
+    left->data = data;
+
+    node->left = left->left;
+    left->left = left->right;
+    left->right = node->right;
+    node->right = left;
+
+    endWrite(left);
+    endWrite(node);
+
+    updateHeight(left);
+    updateHeight(node);
+    updateSize(left);
+    updateSize(node);
+}
+
+// This function rotates a node with its right child without moving the node itself (the mirror of rotateRight)
+static void rotateLeft(TreeNode* node) {
+    TreeNode* right = node->right;
+
+    beginWrite(node);
+    beginWrite(right);
+
+    const int data = node->data;
+    node->data = right->data;
+    right->data = data;
+
+    node->right = right->right;
+    right->right = right->left;
+    right->left = node->left;
+    node->left = right;
+
+    endWrite(right);
+    endWrite(node);
+
+    updateHeight(right);
+    updateHeight(node);
+    updateSize(right);
+    updateSize(node);
+}
+
+// This function restores the AVL property of a node whose subtrees differ in height by 2
+static void rebalance(TreeNode* node, const bool lockChildren) {
+    const int balance = balanceFactor(node);
+
+    if (balance > 1) {
+        TreeNode* left = node->left;
+        if (lockChildren) latchAcquireCounted(&left->lock);
+
+        // Left-right case: we first turn it into a left-left case
+        if (balanceFactor(left) < 0) {
+            TreeNode* grandchild = left->right;
+            if (lockChildren) latchAcquireCounted(&grandchild->lock);
+            rotateLeft(left);
+            if (lockChildren) latchRelease(&grandchild->lock);
+        }
+
+        rotateRight(node);
+        if (lockChildren) latchRelease(&left->lock);
+    }
+
+    else if (balance < -1) {
+        TreeNode* right = node->right;
+        if (lockChildren) latchAcquireCounted(&right->lock);
+
+        // Right-left case: we first turn it into a right-right case
+        if (balanceFactor(right) > 0) {
+            TreeNode* grandchild = right->left;
+            if (lockChildren) latchAcquireCounted(&grandchild->lock);
+            rotateRight(right);
+            if (lockChildren) latchRelease(&grandchild->lock);
+        }
+
+        rotateLeft(node);
+        if (lockChildren) latchRelease(&right->lock);
+    }
+}
+
+// Compare two ints for qsort
+static int compareInts(const void* a, const void* b) {
+    const int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Binary search for the first key that is greater than the value
+static int compareIndexedKeys(const void* a, const void* b) {
+    const IndexedKey* x = (const IndexedKey*)a, *y = (const IndexedKey*)b;
+    if (x->data != y->data) return (x->data > y->data) - (x->data < y->data);
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+static size_t sortedUpperBound(const int* keys, const size_t n, const int data) {
+    size_t low = 0, high = n;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (keys[middle] <= data) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+// Build a subtree, opening a parallel region for large ranges if we are not inside one already
+static TreeNode* buildSubtree(NodeArena* arena, const int* keys, const size_t n) {
+    if (n <= BUILD_TASK_CUTOFF || omp_in_parallel()) return buildRange(arena, keys, n);
+
+    TreeNode* subtree = NULL;
+    #pragma omp parallel
+    {
+        #pragma omp single
+        subtree = buildRange(arena, keys, n);
+    }
+    return subtree;
+}
+
+/*
+ * This function builds a balanced subtree from sorted keys.
+ * Equal values must go left of each other, so the root of a range is the last copy of its value, or the value right
+ * before the copies when that splits the range more evenly. A range of copies of one value becomes a left chain.
+ * The left half is built by a new task when it is large enough, and the subtree is unreachable until we return it,
+ * so no locks are needed.
+ */
+static TreeNode* buildRange(NodeArena* arena, const int* keys, const size_t n) {
+    if (n == 0) return NULL;
+
+    // Copies are not valid for the balanced functions anyway, so the height of a long chain is only capped
+    if (keys[0] == keys[n - 1]) {
+        TreeNode* top = newNode(arena, keys[0]), *node = top;
+        node->height = (unsigned char)(n < UCHAR_MAX ? n : UCHAR_MAX);
+        node->size = (unsigned int)n;
+        for (size_t i = 1; i < n; ++i) {
+            node->left = newNode(arena, keys[i]);
+            node = node->left;
+            node->height = (unsigned char)(n - i < UCHAR_MAX ? n - i : UCHAR_MAX);
+            node->size = (unsigned int)(n - i);
+        }
+        return top;
+    }
+
+    const size_t middle = n / 2;
+    size_t first = middle, last = middle;
+    while (first > 0 && keys[first - 1] == keys[middle]) first--;
+    while (last + 1 < n && keys[last + 1] == keys[middle]) last++;
+
+    size_t pivot = last;
+    if (first > 0 && n - first < last) pivot = first - 1;
+
+    TreeNode* node = newNode(arena, keys[pivot]);
+    TreeNode* left = NULL, *right = NULL;
+
+    #pragma omp task shared(left) if(pivot > BUILD_TASK_CUTOFF)
+    left = buildRange(arena, keys, pivot);
+
+    right = buildRange(arena, keys + pivot + 1, n - pivot - 1);
+
+    #pragma omp taskwait
+
+    node->left = left;
+    node->right = right;
+    updateHeight(node);
+    updateSize(node);
+
+    return node;
+}
+
+// Reduce from the root, in a parallel region of our own unless we are already in one
+static long long reduceTree(const TreeNode* root, const ReduceOp op, const long long identity) {
+    if (root == NULL) return identity;
+    if (omp_in_parallel()) return reduceSubtree((TreeNode*)root, op, identity, 0);
+
+    long long result = identity;
+    #pragma omp parallel
+    {
+        #pragma omp single
+        result = reduceSubtree((TreeNode*)root, op, identity, 0);
+    }
+    return result;
+}
+
+/*
+ * This function reduces a subtree, left subtree first, then the node, then the right subtree.
+ * The node stays latched until both of its subtrees are done, so the children cannot be changed or moved under us.
+ * Near the root the left subtree is reduced by a new task. The depth tells us which subtrees are large enough to be
+ * worth a task, as the sizes in the nodes may also count writers that are still on their way down.
+ */
+static long long reduceSubtree(TreeNode* node, const ReduceOp op, const long long identity, const int depth) {
+    latchAcquireSharedCounted(&node->lock);
+
+    long long left = identity, right = identity;
+
+    #pragma omp task shared(left) if(depth < REDUCE_TASK_DEPTH && node->left != NULL && node->right != NULL)
+    if (node->left) left = reduceSubtree(node->left, op, identity, depth + 1);
+
+    if (node->right) right = reduceSubtree(node->right, op, identity, depth + 1);
+
+    #pragma omp taskwait
+
+    long long result;
+    if (op == NULL) result = left + 1 + right;
+    else result = op(op(left, node->data), right);
+
+    latchReleaseShared(&node->lock);
+    return result;
+}
+
+/*
+ * This function merges sorted keys into a subtree, locking hand-over-hand.
+ * At every node the keys split into the ones that go left and the ones that go right. A side whose child is empty gets
+ * a subtree built from its keys. When both children exist we lock both, merge the smaller part recursively (so the
+ * recursion is at most log(n) deep) and continue with the larger part in the loop.
+ */
+static void mergeBatch(TreeNode* node, const int* keys, size_t n) {
+    while (true) {
+        addSize(node, (long)n);
+        const size_t split = sortedUpperBound(keys, n, node->data);
+
+        TreeNode* children[2] = { NULL, NULL };
+        const int* childKeys[2] = { keys, keys + split };
+        const size_t childCounts[2] = { split, n - split };
+
+        for (int side = 0; side < 2; ++side) {
+            if (childCounts[side] == 0) continue;
+
+            TreeNode** link = side == 0 ? &node->left : &node->right;
+            if (*link == NULL) {
+                TreeNode* subtree = buildSubtree(arenaOf(node), childKeys[side], childCounts[side]);
+                beginWrite(node);
+                *link = subtree;
+                endWrite(node);
+            }
+            else {
+                latchAcquireCounted(&(*link)->lock);
+                children[side] = *link;
+            }
+        }
+
+        latchRelease(&node->lock);
+
+        if (children[0] && children[1]) {
+            const int smaller = childCounts[0] <= childCounts[1] ? 0 : 1;
+            mergeBatch(children[smaller], childKeys[smaller], childCounts[smaller]);
+            children[smaller] = NULL;
+        }
+
+        const int next = children[0] ? 0 : 1;
+        if (children[next] == NULL) return;
+
+        node = children[next];
+        keys = childKeys[next];
+        n = childCounts[next];
+    }
+}
+
+/*
+ * A deleteBalanced that did not find its value left the sizes of the nodes above the place of the value one short.
+ * Rotations may have moved them since, but the nodes with a short size are always the ones above that place, which
+ * is where the value leads from the root. We hold that whole path, so no writer is left between us and the place,
+ * and recompute the sizes from the bottom up. The subtrees we don't hold have correct sizes.
+ */
+static void repairSizes(TreeNode* root, const int data) {
+    NodePath path;
+    pathInit(&path);
+
+    TreeNode* node = root;
+    latchAcquireCounted(&node->lock);
+    pathPush(&path, node);
+
+    while (true) {
+        TreeNode* next = data <= node->data ? node->left : node->right;
+        if (next == NULL) break;
+
+        latchAcquireCounted(&next->lock);
+        pathPush(&path, next);
+        node = next;
+    }
+
+    for (size_t i = path.count; i > 0; --i) updateSize(path.nodes[i - 1]);
+    for (size_t i = 0; i < path.count; ++i) latchRelease(&path.nodes[i]->lock);
+    pathDestroy(&path);
+}
+
+/*
+ * On the lower side every node that is not smaller than lo counts with its right subtree and we go left, otherwise we
+ * go right. The upper side is the mirror. The caller holds the parent of the node.
+ */
+static size_t countSide(TreeNode* node, const int bound, const bool isLower) {
+    if (node == NULL) return 0;
+    latchAcquireSharedCounted(&node->lock);
+
+    size_t count = 0;
+    while (node) {
+        TreeNode* next;
+        if (isLower ? node->data >= bound : node->data <= bound) {
+            count += 1 + nodeSize(isLower ? node->right : node->left);
+            next = isLower ? node->left : node->right;
+        }
+        else {
+            next = isLower ? node->right : node->left;
+        }
+
+        if (next) latchAcquireSharedCounted(&next->lock);
+        latchReleaseShared(&node->lock);
+        node = next;
+    }
+
+    return count;
+}
+
+/*
+ * On the lower path (side 0) a node smaller than the bound stays and we go right, any other node is removed with its
+ * right subtree and we go left. The upper path (side 1) is the mirror. Removed nodes stay latched, so nobody follows
+ * us into the subtrees we cut off, and we read their sizes while we hold their parents.
+ */
+static void cutPath(RangeCut* cut, TreeNode* node, const int bound, const int side) {
+    NodePath* kept = &cut->kept[side];
+
+    while (node) {
+        latchAcquireCounted(&node->lock);
+        statsVisit();
+
+        if (side == 0 ? node->data < bound : node->data > bound) {
+            pathPush(kept, node);
+            node = side == 0 ? node->right : node->left;
+            continue;
+        }
+
+        if (cut->count == cut->capacity) {
+            cut->capacity = cut->capacity ? 2 * cut->capacity : 16;
+            cut->removed = (CutNode*)realloc(cut->removed, cut->capacity * sizeof(CutNode));
+        }
+
+        CutNode* removed = &cut->removed[cut->count++];
+        removed->node = node;
+        removed->subtree = side == 0 ? node->right : node->left;
+        removed->size = nodeSize(removed->subtree);
+        removed->kept = kept->count;
+        removed->side = side;
+
+        node = side == 0 ? node->left : node->right;
+    }
+}
+
+// Retire from the top, in a parallel region of our own for a large subtree unless we are already in one
+static size_t retireSubtree(TreeNode* top) {
+    if (nodeSize(top) <= RETIRE_TASK_CUTOFF || omp_in_parallel()) return retireRange(top);
+
+    size_t count = 0;
+    #pragma omp parallel
+    {
+        #pragma omp single
+        count = retireRange(top);
+    }
+    return count;
+}
+
+/*
+ * This function retires a detached subtree with an explicit stack, so a long path does not run out of call stack.
+ * Every node is latched before it is retired: a writer that was already inside the subtree when it was cut off is
+ * still below the nodes we did not reach, and we wait for it to leave. Nobody else can reach the subtree anymore, so
+ * we let go of a node before we latch its children. A large left subtree is retired by a task of its own.
+ */
+static size_t retireRange(TreeNode* top) {
+    NodePath stack;
+    pathInit(&stack);
+    pathPush(&stack, top);
+
+    // Our own count is only ours, the tasks add theirs to 'tasked', which we read once they are all done
+    size_t count = 0, tasked = 0;
+    while (stack.count > 0) {
+        TreeNode* node = stack.nodes[--stack.count];
+
+        latchAcquireCounted(&node->lock);
+        TreeNode* left = node->left, *right = node->right;
+        latchRelease(&node->lock);
+        retireNode(node);
+        count++;
+
+        if (left && right && nodeSize(left) > RETIRE_TASK_CUTOFF) {
+            #pragma omp task shared(tasked)
+            {
+                const size_t retired = retireRange(left);
+                #pragma omp atomic
+                tasked += retired;
+            }
+        }
+        else if (left) {
+            pathPush(&stack, left);
+        }
+
+        if (right) pathPush(&stack, right);
+    }
+
+    #pragma omp taskwait
+    pathDestroy(&stack);
+    return count + tasked;
+}
@@ -9,14 +9,41 @@
 #include <stdbool.h>
 #include <omp.h>
 
+#include "latch.h"
+
 // The binary tree
+// The small fields come first, so they share 16 bytes with a 1-byte latch and the node is half a cache line.
 typedef struct TreeNode {
     int data;
+    unsigned int size; // The number of nodes in the subtree of the node, used by treeRank, treeSelect and treeCountRange
+    unsigned int version; // Odd while a writer changes the node, used by the lock-free path of searchNode
+    unsigned char height; // Only kept by the balanced functions, whose trees are less than 64 levels deep
+    Latch lock;
     struct TreeNode *left;
     struct TreeNode *right;
-    omp_lock_t lock;
 } TreeNode;
 
+// A growable stack of nodes, used to remember a path of latched nodes
+typedef struct NodePath {
+    TreeNode** nodes;
+    size_t count;
+    size_t capacity;
+    TreeNode* buffer[64];
+} NodePath;
+
+/*
+ * An in-order iterator. Its stack holds the nodes whose values are still ahead, each one latched in shared mode, and
+ * they all lie on the path from the root to the current node. A node is released as soon as its value is returned,
+ * so writers are only held back on that path, never in the parts of the tree that are already done or not reached.
+ * The thread that holds an iterator must not change the tree until it destroys the iterator.
+ */
+typedef struct TreeIterator {
+    NodePath path;
+} TreeIterator;
+
+// The callback of rangeScan gets every value with the caller's context, and returns false to stop the scan
+typedef bool (*ScanCallback)(int data, void* context);
+
 // This function will create a new binary search tree
 TreeNode* createNode(const int data);
 
@@ -26,12 +53,124 @@ TreeNode* insertNode(TreeNode* root, const int data);
 // This function will delete a node from the binary search tree
 TreeNode* deleteNode(TreeNode* root, const int data);
 
-// This function checks whether a value exists in the tree
+// This function deletes a node like deleteNode, and sets isDeleted to whether the value was in the tree
+TreeNode* deleteNodeChecked(TreeNode* root, const int data, bool* isDeleted);
+
+/*
+ * Self-balancing (AVL) variants of insertNode and deleteNode.
+ * A tree must be built and modified only through these two functions (searchNode, findMin and the traversals
+ * work on both kinds of trees). The root node is never replaced, so the returned root is always the given one,
+ * unless the tree was empty or became empty. Rotations may move keys equal to a node into its right subtree.
+ */
+TreeNode* insertBalanced(TreeNode* root, const int data);
+TreeNode* deleteBalanced(TreeNode* root, const int data);
+
+/*
+ * This function inserts many values at once and returns the root.
+ * The batch is sorted and merged into the tree in a single walk: where a batch range meets an empty child, the whole
+ * range becomes a perfectly balanced subtree that is built without locks, in parallel OpenMP tasks for large ranges.
+ * The result is the same as inserting the values one by one with insertNode. Starting from an empty tree, the result
+ * is perfectly balanced (and valid for the balanced functions as long as the values are distinct).
+ */
+TreeNode* insertBatch(TreeNode* root, const int* keys, size_t n);
+
+/*
+ * This function deletes every value in [lo, hi], copies included, and returns the root (NULL if the tree became
+ * empty). If deleted is not NULL it is set to the number of values that were deleted.
+ * Instead of one walk per value, the range is cut out of the tree along two paths, from its highest node down to lo
+ * and down to hi, and the parts of the tree that lie inside it are detached whole. Only those paths and the path from
+ * the root are latched while the tree changes; the detached subtrees are retired afterwards, in parallel OpenMP tasks
+ * when they are large, while other threads already use the tree.
+ * Like deleteNode, it is meant for trees that are not kept balanced by the balanced functions.
+ */
+TreeNode* deleteRange(TreeNode* root, int lo, int hi, size_t* deleted);
+
+/*
+ * This function deletes one copy of each of the n values, like calling deleteNode for every one of them, and returns
+ * the root (NULL if the tree became empty). If deleted is not NULL it is set to the number of values that were in the
+ * tree.
+ * Instead of one walk per value, the sorted values are swept down the tree together and split between the two
+ * subtrees of every node they pass, so the part of their paths that they share is walked and latched once, and every
+ * node is visited at most once. A node stays latched until the values below it are done.
+ * Like deleteNode, it is meant for trees that are not kept balanced by the balanced functions.
+ */
+TreeNode* deleteBatch(TreeNode* root, const int* keys, size_t n, size_t* deleted);
+
+// This function deletes like deleteBatch, and sets isDeleted[i] to whether keys[i] was in the tree. Of equal values,
+// the ones that come first in keys are the ones that get the copies.
+TreeNode* deleteBatchChecked(TreeNode* root, const int* keys, size_t n, bool* isDeleted);
+
+/*
+ * This function checks whether a value exists in the tree.
+ * It walks the tree without taking locks and validates every node it visits against its version counter, falling
+ * back to hand-over-hand locking only after repeated conflicts with writers.
+ */
 bool searchNode(const TreeNode* root, const int data);
 
-// The function returns the minimus value in the tree
+/*
+ * This function checks for each of the n values whether it exists in the tree, and writes the answers to out.
+ * It gives the same answers as calling searchNode for every value, but walks many lookups through the tree together
+ * so that their memory accesses overlap.
+ */
+void searchBatch(const TreeNode* root, const int* keys, size_t n, bool* out);
+
+/*
+ * The function returns the minimus value in the tree.
+ * The node is unlocked when it is returned, so a concurrent delete may remove it. To keep reading it safely, call
+ * findMin between epochEnter and epochExit (see epoch.h): the removed node is not reclaimed before epochExit.
+ */
 TreeNode* findMin(const TreeNode* root);
 
+// These functions start an iterator at the minimal value, or at the first value that is not smaller than lo
+void iteratorInit(TreeIterator* iterator, TreeNode* root);
+void iteratorInitFrom(TreeIterator* iterator, TreeNode* root, int lo);
+
+// This function writes the next value in order to data, returns false once there are no more values
+bool iteratorNext(TreeIterator* iterator, int* data);
+
+// This function releases an iterator, whether or not it reached the end
+void iteratorDestroy(TreeIterator* iterator);
+
+/*
+ * This function passes the values in [lo, hi] to the callback in order, copies included, and returns how many it
+ * passed. It walks with an iterator, so only the current path is latched while the callback runs.
+ */
+size_t rangeScan(TreeNode* root, int lo, int hi, ScanCallback callback, void* context);
+
+// The operation of treeReduce. It must be associative, and the identity given to treeReduce must be neutral for it.
+typedef long long (*ReduceOp)(long long a, long long b);
+
+/*
+ * This function combines all the values of the tree with op, in order, and returns the result (identity for an empty
+ * tree). Large subtrees are reduced in parallel OpenMP tasks.
+ * Every node stays latched until its subtree is done, so no writer can move values in or out of a subtree while it
+ * is being reduced. Writers wait for the reduction to pass them, while searchNode does not.
+ */
+long long treeReduce(const TreeNode* root, ReduceOp op, long long identity);
+
+// This function counts the nodes of the tree, in parallel like treeReduce
+size_t treeCount(const TreeNode* root);
+
+/*
+ * Order statistics. Every node keeps the size of its subtree, which insertNode, deleteNode, the balanced functions
+ * and insertBatch update on their way down, while they hold the node. These functions walk a single path with shared
+ * latch coupling, so they take O(log n) on a balanced tree. A writer that is still on its way down is already counted
+ * in the nodes above it.
+ */
+
+// This function returns the number of values in the tree that are smaller than the given value
+size_t treeRank(const TreeNode* root, const int data);
+
+// This function writes the k-th smallest value (counting from 0, copies included) to data, returns false if the tree
+// has no more than k values
+bool treeSelect(const TreeNode* root, size_t k, int* data);
+
+/*
+ * This function returns the number of values in [lo, hi], copies included.
+ * It latches the highest node inside the range for the whole count, so writers cannot change the range meanwhile.
+ */
+size_t treeCountRange(const TreeNode* root, const int lo, const int hi);
+
 // This function prints the inorder traversal
 void inorderTraversal(TreeNode* root);
 
@@ -41,7 +180,7 @@ void preorderTraversal(TreeNode* root);
 // This function prints the postorder traversal
 void postorderTraversal(TreeNode* root);
 
-// This function free the tree
+// This function free the tree. Large trees are freed by all the threads.
 void freeTree(TreeNode* root);
 
 #endif //BINARY_TREE_H
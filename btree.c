@@ -0,0 +1,492 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "btree.h"
+#include "key_search.h"
+#include "latch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The vector key search compares whole nodes of KEY_SEARCH_WIDTH keys
+#if BTREE_NODE_KEYS != KEY_SEARCH_WIDTH
+#error "BTREE_NODE_KEYS must be KEY_SEARCH_WIDTH"
+#endif
+
+// A node is at most this deep. With a fan-out of 17 even a 2^64 values tree is far less deep.
+#define BTREE_MAX_DEPTH 32
+
+// The most nodes waiting to be freed at once: the siblings of every node on the current path, and the node itself
+#define BTREE_FREE_STACK (BTREE_MAX_DEPTH * BTREE_NODE_KEYS + 1)
+
+/*
+ * A node of the tree.
+ * In an inner node children[i] holds the values in [keys[i - 1], keys[i]). A separator is only removed with an empty
+ * leaf (see mergeEmptyLeaf), so a value that was deleted may still appear as a separator.
+ * A leaf holds distinct keys with the number of copies of each one, and points to the next leaf.
+ * Nodes are allocated on a cache line boundary and the keys start a line of their own, so the key search of a node
+ * reads exactly one line. The header before them and the children after them are only touched once the key is found.
+ */
+typedef struct BTreeNode {
+    Latch lock;
+    bool isLeaf;
+    int count;
+    int keys[BTREE_NODE_KEYS] __attribute__((aligned(64)));
+    union {
+        struct BTreeNode* children[BTREE_NODE_KEYS + 1];
+        struct {
+            unsigned int copies[BTREE_NODE_KEYS];
+            struct BTreeNode* next;
+        } leaf;
+    } u;
+} BTreeNode;
+
+// The latch of the tree protects the root pointer, which changes when the root splits. Every operation reads the
+// root through it, so it is an RwLatch, which readers really share whatever TREE_LATCH is.
+struct BTree {
+    RwLatch lock;
+    BTreeNode* root;
+};
+
+// This function creates an empty node
+static BTreeNode* newNode(bool isLeaf);
+
+// This function descends with shared latches to the leaf of a value, and latches the leaf in the given mode
+static BTreeNode* latchLeaf(BTree* tree, int data, bool exclusive);
+
+// This function inserts a value to a full leaf, splitting every node on the way up that has no room
+static void insertWithSplits(BTree* tree, int data);
+
+// This function splits a full leaf while adding a value to it, returns the new right leaf
+static BTreeNode* splitLeaf(BTreeNode* leaf, int position, int data);
+
+// This function adds a separator and the child to its right to an inner node, returns the new right node if it split
+static BTreeNode* insertSeparator(BTreeNode* node, int* separator, BTreeNode* right);
+
+// This function takes the leaf of a value out of the tree if it is empty and has a sibling under the same parent
+static void mergeEmptyLeaf(BTree* tree, int data);
+
+// This function removes a separator and the child to its right from an inner node
+static void removeSeparator(BTreeNode* node, int position);
+
+// This function frees a node and everything below it
+static void freeNode(BTreeNode* node);
+
+// Create a new empty tree
+BTree* btreeCreate(void) {
+    BTree* tree = (BTree*)malloc(sizeof(BTree));
+    rwLatchInit(&tree->lock);
+    tree->root = newNode(true);
+
+    return tree;
+}
+
+/*
+ * This function inserts a value to the tree.
+ * Most inserts only change their leaf, so we first try with shared latches on the way down. Only if the leaf is full
+ * we start over with exclusive latches, keeping the nodes that the split may reach.
+ */
+void btreeInsert(BTree* tree, const int data) {
+    BTreeNode* leaf = latchLeaf(tree, data, true);
+    const int position = keysLowerBound(leaf->keys, leaf->count, data);
+
+    // The value is already in the tree, we count another copy
+    if (position < leaf->count && leaf->keys[position] == data) {
+        leaf->u.leaf.copies[position]++;
+        latchRelease(&leaf->lock);
+        return;
+    }
+
+    if (leaf->count < BTREE_NODE_KEYS) {
+        for (int i = leaf->count; i > position; --i) {
+            leaf->keys[i] = leaf->keys[i - 1];
+            leaf->u.leaf.copies[i] = leaf->u.leaf.copies[i - 1];
+        }
+        leaf->keys[position] = data;
+        leaf->u.leaf.copies[position] = 1;
+        leaf->count++;
+
+        latchRelease(&leaf->lock);
+        return;
+    }
+
+    latchRelease(&leaf->lock);
+    insertWithSplits(tree, data);
+}
+
+/*
+ * This function deletes one copy of a value. Only the leaf changes, so it is the only node we latch exclusively.
+ * If that leaves the leaf empty, we go down again to take it out of the tree.
+ */
+bool btreeDelete(BTree* tree, const int data) {
+    BTreeNode* leaf = latchLeaf(tree, data, true);
+    const int position = keysLowerBound(leaf->keys, leaf->count, data);
+
+    // If the given value is not in the tree
+    if (position == leaf->count || leaf->keys[position] != data) {
+        latchRelease(&leaf->lock);
+        return false;
+    }
+
+    // The last copy takes the key out of the leaf
+    if (--leaf->u.leaf.copies[position] == 0) {
+        for (int i = position; i + 1 < leaf->count; ++i) {
+            leaf->keys[i] = leaf->keys[i + 1];
+            leaf->u.leaf.copies[i] = leaf->u.leaf.copies[i + 1];
+        }
+        leaf->count--;
+    }
+
+    const bool isEmpty = leaf->count == 0;
+    latchRelease(&leaf->lock);
+
+    if (isEmpty) mergeEmptyLeaf(tree, data);
+    return true;
+}
+
+// This function checks whether a value is in the tree
+bool btreeSearch(const BTree* tree, const int data) {
+    BTreeNode* leaf = latchLeaf((BTree*)tree, data, false);
+
+    const int position = keysLowerBound(leaf->keys, leaf->count, data);
+    const bool found = position < leaf->count && leaf->keys[position] == data;
+
+    latchReleaseShared(&leaf->lock);
+    return found;
+}
+
+// This function finds the minimal value. Deletes may leave empty leaves, so we move right until we find a key.
+bool btreeFindMin(const BTree* tree, int* min) {
+    BTree* mutableTree = (BTree*)tree;
+
+    rwLatchAcquireShared(&mutableTree->lock);
+    BTreeNode* node = mutableTree->root;
+    latchAcquireShared(&node->lock);
+    rwLatchReleaseShared(&mutableTree->lock);
+
+    while (!node->isLeaf) {
+        BTreeNode* child = node->u.children[0];
+        latchAcquireShared(&child->lock);
+        latchReleaseShared(&node->lock);
+        node = child;
+    }
+
+    while (node->count == 0 && node->u.leaf.next != NULL) {
+        BTreeNode* next = node->u.leaf.next;
+        latchAcquireShared(&next->lock);
+        latchReleaseShared(&node->lock);
+        node = next;
+    }
+
+    const bool isFound = node->count > 0;
+    if (isFound) *min = node->keys[0];
+
+    latchReleaseShared(&node->lock);
+    return isFound;
+}
+
+// Free the tree
+void btreeFree(BTree* tree) {
+    if (tree == NULL) return;
+
+    freeNode(tree->root);
+    free(tree);
+}
+
+// Create an empty node with an initialized latch
+static BTreeNode* newNode(const bool isLeaf) {
+    void* memory;
+    if (posix_memalign(&memory, 64, sizeof(BTreeNode)) != 0) abort();
+
+    BTreeNode* node = (BTreeNode*)memory;
+    latchInit(&node->lock);
+    node->isLeaf = isLeaf;
+    node->count = 0;
+    memset(node->keys, 0, sizeof(node->keys));
+    if (isLeaf) node->u.leaf.next = NULL;
+
+    return node;
+}
+
+// Walk down with shared latches, latching each child before we let go of its parent
+static BTreeNode* latchLeaf(BTree* tree, const int data, const bool exclusive) {
+    rwLatchAcquireShared(&tree->lock);
+    BTreeNode* node = tree->root;
+
+    if (node->isLeaf && exclusive) latchAcquire(&node->lock);
+    else latchAcquireShared(&node->lock);
+    rwLatchReleaseShared(&tree->lock);
+
+    while (!node->isLeaf) {
+        BTreeNode* child = node->u.children[keysUpperBound(node->keys, node->count, data)];
+
+        if (child->isLeaf && exclusive) latchAcquire(&child->lock);
+        else latchAcquireShared(&child->lock);
+        latchReleaseShared(&node->lock);
+
+        node = child;
+    }
+
+    return node;
+}
+
+/*
+ * This function inserts a value with exclusive latch crabbing.
+ * A node with room for one more key absorbs a split of its child, so when we reach one we let go of everything above
+ * it. What is left on the path when we reach the leaf is exactly the chain of nodes that may split.
+ */
+static void insertWithSplits(BTree* tree, const int data) {
+    BTreeNode* path[BTREE_MAX_DEPTH];
+    int depth = 0;
+    bool holdsTree = true;
+
+    rwLatchAcquire(&tree->lock);
+    BTreeNode* node = tree->root;
+    latchAcquire(&node->lock);
+    path[depth++] = node;
+
+    while (true) {
+        if (node->count < BTREE_NODE_KEYS) {
+            if (holdsTree) rwLatchRelease(&tree->lock);
+            holdsTree = false;
+
+            for (int i = 0; i + 1 < depth; ++i) latchRelease(&path[i]->lock);
+            path[0] = node;
+            depth = 1;
+        }
+
+        if (node->isLeaf) break;
+
+        BTreeNode* child = node->u.children[keysUpperBound(node->keys, node->count, data)];
+        latchAcquire(&child->lock);
+        path[depth++] = child;
+        node = child;
+    }
+
+    BTreeNode* leaf = node;
+    const int position = keysLowerBound(leaf->keys, leaf->count, data);
+
+    // Another thread may have made room, or inserted the same value, since we let go of the leaf
+    if (position < leaf->count && leaf->keys[position] == data) {
+        leaf->u.leaf.copies[position]++;
+    }
+    else if (leaf->count < BTREE_NODE_KEYS) {
+        for (int i = leaf->count; i > position; --i) {
+            leaf->keys[i] = leaf->keys[i - 1];
+            leaf->u.leaf.copies[i] = leaf->u.leaf.copies[i - 1];
+        }
+        leaf->keys[position] = data;
+        leaf->u.leaf.copies[position] = 1;
+        leaf->count++;
+    }
+    else {
+        BTreeNode* right = splitLeaf(leaf, position, data);
+        int separator = right->keys[0];
+
+        // Every node above the leaf on the path is full and splits in turn, except maybe the first one
+        for (int i = depth - 2; i >= 0 && right != NULL; --i) {
+            right = insertSeparator(path[i], &separator, right);
+        }
+
+        // The root itself split, so the tree grows by one level
+        if (right != NULL) {
+            BTreeNode* root = newNode(false);
+            root->keys[0] = separator;
+            root->u.children[0] = tree->root;
+            root->u.children[1] = right;
+            root->count = 1;
+            tree->root = root;
+        }
+    }
+
+    for (int i = 0; i < depth; ++i) latchRelease(&path[i]->lock);
+    if (holdsTree) rwLatchRelease(&tree->lock);
+}
+
+// Split a full leaf in two halves while inserting the value at its position
+static BTreeNode* splitLeaf(BTreeNode* leaf, const int position, const int data) {
+    int keys[BTREE_NODE_KEYS + 1];
+    unsigned int copies[BTREE_NODE_KEYS + 1];
+
+    for (int i = 0, j = 0; i <= BTREE_NODE_KEYS; ++i) {
+        if (i == position) {
+            keys[i] = data;
+            copies[i] = 1;
+        }
+        else {
+            keys[i] = leaf->keys[j];
+            copies[i] = leaf->u.leaf.copies[j];
+            j++;
+        }
+    }
+
+    BTreeNode* right = newNode(true);
+    const int leftCount = (BTREE_NODE_KEYS + 1) / 2;
+
+    for (int i = 0; i < leftCount; ++i) {
+        leaf->keys[i] = keys[i];
+        leaf->u.leaf.copies[i] = copies[i];
+    }
+    for (int i = leftCount; i <= BTREE_NODE_KEYS; ++i) {
+        right->keys[i - leftCount] = keys[i];
+        right->u.leaf.copies[i - leftCount] = copies[i];
+    }
+    leaf->count = leftCount;
+    right->count = BTREE_NODE_KEYS + 1 - leftCount;
+
+    right->u.leaf.next = leaf->u.leaf.next;
+    leaf->u.leaf.next = right;
+
+    return right;
+}
+
+/*
+ * Add a separator to an inner node. If the node is full it splits: the middle key moves up through 'separator' and
+ * the new right half is returned. Otherwise NULL is returned.
+ */
+static BTreeNode* insertSeparator(BTreeNode* node, int* separator, BTreeNode* right) {
+    const int position = keysUpperBound(node->keys, node->count, *separator);
+
+    if (node->count < BTREE_NODE_KEYS) {
+        for (int i = node->count; i > position; --i) {
+            node->keys[i] = node->keys[i - 1];
+            node->u.children[i + 1] = node->u.children[i];
+        }
+        node->keys[position] = *separator;
+        node->u.children[position + 1] = right;
+        node->count++;
+        return NULL;
+    }
+
+    int keys[BTREE_NODE_KEYS + 1];
+    BTreeNode* children[BTREE_NODE_KEYS + 2];
+
+    children[0] = node->u.children[0];
+    for (int i = 0, j = 0; i <= BTREE_NODE_KEYS; ++i) {
+        if (i == position) {
+            keys[i] = *separator;
+            children[i + 1] = right;
+        }
+        else {
+            keys[i] = node->keys[j];
+            children[i + 1] = node->u.children[j + 1];
+            j++;
+        }
+    }
+
+    // The left half keeps the first keys, the middle one moves up, and the new node takes the rest
+    BTreeNode* sibling = newNode(false);
+    const int leftCount = BTREE_NODE_KEYS / 2;
+
+    for (int i = 0; i < leftCount; ++i) {
+        node->keys[i] = keys[i];
+        node->u.children[i] = children[i];
+    }
+    node->u.children[leftCount] = children[leftCount];
+    node->count = leftCount;
+
+    *separator = keys[leftCount];
+
+    for (int i = leftCount + 1; i <= BTREE_NODE_KEYS; ++i) {
+        sibling->keys[i - leftCount - 1] = keys[i];
+        sibling->u.children[i - leftCount - 1] = children[i];
+    }
+    sibling->u.children[BTREE_NODE_KEYS - leftCount] = children[BTREE_NODE_KEYS + 1];
+    sibling->count = BTREE_NODE_KEYS - leftCount;
+
+    return sibling;
+}
+
+/*
+ * This function takes an empty leaf out of the tree, after the delete that emptied it let go of it. We give up if the
+ * leaf got a value meanwhile, or if it is the only child of its parent. Inner nodes are never merged.
+ * We latch the parent exclusively and then the two leaves from left to right, like every walk along the leaves. Every
+ * thread reaches a leaf while it holds its parent or its left neighbour, so once we hold all three nobody waits for
+ * the leaf we remove, and nobody can reach it after we let go. An empty leaf gives its range to its left sibling, and
+ * the first leaf of a parent takes the values of its right sibling instead, which goes in its place. Either way the
+ * leaf chain only changes in a leaf we hold.
+ */
+static void mergeEmptyLeaf(BTree* tree, const int data) {
+    rwLatchAcquireShared(&tree->lock);
+    BTreeNode* node = tree->root;
+    latchAcquireShared(&node->lock);
+    rwLatchReleaseShared(&tree->lock);
+
+    if (node->isLeaf) {
+        latchReleaseShared(&node->lock);
+        return;
+    }
+
+    while (!node->u.children[0]->isLeaf) {
+        BTreeNode* child = node->u.children[keysUpperBound(node->keys, node->count, data)];
+        latchAcquireShared(&child->lock);
+        latchReleaseShared(&node->lock);
+        node = child;
+    }
+
+    // Inner nodes are never freed and never change their level, so we can latch the parent again exclusively
+    BTreeNode* parent = node;
+    latchReleaseShared(&parent->lock);
+    latchAcquire(&parent->lock);
+
+    if (parent->count == 0) {
+        latchRelease(&parent->lock);
+        return;
+    }
+
+    const int position = keysUpperBound(parent->keys, parent->count, data);
+    const int left = position > 0 ? position - 1 : 0;
+    BTreeNode* first = parent->u.children[left], *second = parent->u.children[left + 1];
+    latchAcquire(&first->lock);
+    latchAcquire(&second->lock);
+
+    BTreeNode* removed = NULL;
+    if (position > 0 && second->count == 0) {
+        removed = second;
+    }
+    else if (position == 0 && first->count == 0) {
+        memcpy(first->keys, second->keys, (size_t)second->count * sizeof(int));
+        memcpy(first->u.leaf.copies, second->u.leaf.copies, (size_t)second->count * sizeof(unsigned int));
+        first->count = second->count;
+        removed = second;
+    }
+
+    if (removed) {
+        first->u.leaf.next = second->u.leaf.next;
+        removeSeparator(parent, left);
+    }
+
+    latchRelease(&second->lock);
+    latchRelease(&first->lock);
+    latchRelease(&parent->lock);
+
+    if (removed) {
+        latchDestroy(&removed->lock);
+        free(removed);
+    }
+}
+
+// Remove a separator and its right child. The node may be left with no separator and a single child.
+static void removeSeparator(BTreeNode* node, const int position) {
+    for (int i = position; i + 1 < node->count; ++i) {
+        node->keys[i] = node->keys[i + 1];
+        node->u.children[i + 1] = node->u.children[i + 2];
+    }
+    node->count--;
+}
+
+// Free a node and its subtree, with an explicit stack of the nodes that are still to be freed
+static void freeNode(BTreeNode* node) {
+    BTreeNode* stack[BTREE_FREE_STACK];
+    int size = 0;
+    stack[size++] = node;
+
+    while (size > 0) {
+        node = stack[--size];
+        if (!node->isLeaf) {
+            for (int i = 0; i <= node->count; ++i) stack[size++] = node->u.children[i];
+        }
+
+        latchDestroy(&node->lock);
+        free(node);
+    }
+}
@@ -0,0 +1,46 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <stdbool.h>
+
+/*
+ * A B+-tree with the same contract as the binary search tree: duplicates are allowed, and every delete removes one
+ * copy of a value. Nodes are wide (BTREE_NODE_KEYS sorted keys), so a lookup touches a few cache lines per level
+ * instead of one node per level. Leaves keep a counter per key instead of storing duplicates twice.
+ *
+ * All functions are thread safe. Readers couple shared latches from the root to a leaf; writers do the same and latch
+ * only the leaf exclusively, and an insert that has to split a full leaf retries with exclusive latch crabbing, keeping
+ * only the ancestors that the split can reach. The root pointer is guarded by an RwLatch, so operations share it
+ * whatever TREE_LATCH is.
+ * A delete that empties a leaf takes it out of the tree afterwards, unless it is the only child of its parent. Inner
+ * nodes are never merged, so an inner node may be left with a single child.
+ */
+typedef struct BTree BTree;
+
+// The number of keys in a node. Only the key array fills a cache line: with its latch and its children or counters a
+// node takes five of them, but a search within the node reads the one line of keys.
+#define BTREE_NODE_KEYS 16
+
+// This function creates a new empty tree
+BTree* btreeCreate(void);
+
+// This function inserts a value to the tree
+void btreeInsert(BTree* tree, const int data);
+
+// This function deletes one copy of a value from the tree, returns false if the value is not in the tree
+bool btreeDelete(BTree* tree, const int data);
+
+// This function checks whether a value exists in the tree
+bool btreeSearch(const BTree* tree, const int data);
+
+// This function finds the minimal value in the tree, returns false if the tree is empty
+bool btreeFindMin(const BTree* tree, int* min);
+
+// This function frees the tree
+void btreeFree(BTree* tree);
+
+#endif //BTREE_H
@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "combining_tree.h"
+#include "epoch.h"
+
+#include <sched.h>
+#include <stdlib.h>
+
+// The number of times a waiting thread checks its request before giving the processor to another thread
+#define SPINS_BEFORE_YIELD 64
+
+// The number of batches a combiner applies before it hands over to a waiting thread
+#define COMBINE_PASSES 4
+
+/*
+ * 'pending' is the only field that every writer changes, every waiting thread keeps testing 'isCombining', and
+ * 'waiting' changes whenever a thread starts or stops waiting, so each of them has a cache line of its own. The
+ * combiner owns the root pointer and the batch buffers. Readers load the root inside an epoch: the combiner only
+ * replaces it when the tree becomes empty or stops being empty, and a removed root is reclaimed through the epoch
+ * like any other node.
+ */
+struct CombiningTree {
+    TreeRequest* pending __attribute__((aligned(64))); // Published requests, the newest first
+    int isCombining __attribute__((aligned(64)));
+    int waiting __attribute__((aligned(64))); // The number of threads in combiningWait whose request is not done
+
+    TreeNode* root __attribute__((aligned(64)));
+    TreeRequest** batch;
+    size_t batchCapacity;
+    int* inserts;
+    int* deletes;
+    bool* results;
+    TreeRequest** deleters; // The requests of 'deletes', in the same order
+};
+
+// This function becomes the combiner if there are pending requests and no other thread is combining. 'isWaiting' is
+// set when the calling thread is one of the waiting ones.
+static void tryCombine(CombiningTree* tree, bool isWaiting);
+
+// This function applies a list of requests, the newest first, and marks them done
+static void applyRequests(CombiningTree* tree, TreeRequest* list);
+
+// This function orders requests by value, and requests of the same value by the order they were published
+static int compareRequests(const void* a, const void* b);
+
+CombiningTree* combiningCreate(TreeNode* root) {
+    void* memory;
+    if (posix_memalign(&memory, 64, sizeof(CombiningTree)) != 0) {
+        return NULL;
+    }
+
+    CombiningTree* tree = (CombiningTree*)memory;
+    tree->pending = NULL;
+    tree->isCombining = 0;
+    tree->waiting = 0;
+    tree->root = root;
+    tree->batch = NULL;
+    tree->batchCapacity = 0;
+    tree->inserts = NULL;
+    tree->deletes = NULL;
+    tree->results = NULL;
+    tree->deleters = NULL;
+
+    return tree;
+}
+
+void requestInit(TreeRequest* request, const TreeOperation operation, const int data, const RequestCallback callback,
+                 void* context) {
+    request->operation = operation;
+    request->data = data;
+    request->result = false;
+    request->callback = callback;
+    request->context = context;
+    request->done = 0;
+    request->next = NULL;
+}
+
+// Push the request to the pending list, then make sure someone applies it
+void combiningSubmit(CombiningTree* tree, TreeRequest* request) {
+    __atomic_store_n(&request->done, 0, __ATOMIC_RELAXED);
+
+    request->next = __atomic_load_n(&tree->pending, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&tree->pending, &request->next, request, true, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED)) {}
+
+    tryCombine(tree, false);
+}
+
+bool requestDone(const TreeRequest* request) {
+    return __atomic_load_n(&request->done, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * The request may be in a batch of another combiner, or published after it took its last batch. While we wait we are
+ * counted in 'waiting', which lets a combiner that has done its share stop and leave the rest to us.
+ */
+bool combiningWait(CombiningTree* tree, TreeRequest* request) {
+    if (requestDone(request)) return request->result;
+
+    __atomic_add_fetch(&tree->waiting, 1, __ATOMIC_SEQ_CST);
+    int spins = 0;
+
+    while (!requestDone(request)) {
+        tryCombine(tree, true);
+
+        if (++spins < SPINS_BEFORE_YIELD) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            continue;
+        }
+        spins = 0;
+        sched_yield();
+    }
+    __atomic_sub_fetch(&tree->waiting, 1, __ATOMIC_SEQ_CST);
+
+    // A combiner may have stopped for us after our request was already done, so its pending requests are now ours
+    tryCombine(tree, false);
+    return request->result;
+}
+
+void combiningInsert(CombiningTree* tree, const int data) {
+    TreeRequest request;
+    requestInit(&request, TREE_INSERT, data, NULL, NULL);
+    combiningSubmit(tree, &request);
+    combiningWait(tree, &request);
+}
+
+bool combiningDelete(CombiningTree* tree, const int data) {
+    TreeRequest request;
+    requestInit(&request, TREE_DELETE, data, NULL, NULL);
+    combiningSubmit(tree, &request);
+    return combiningWait(tree, &request);
+}
+
+bool combiningSearch(CombiningTree* tree, const int data) {
+    epochEnter();
+    const TreeNode* root = __atomic_load_n(&tree->root, __ATOMIC_ACQUIRE);
+    const bool isFound = root != NULL && searchNode(root, data);
+    epochExit();
+
+    return isFound;
+}
+
+// The epoch also keeps the minimal node readable after findMin lets go of it
+bool combiningFindMin(CombiningTree* tree, int* min) {
+    epochEnter();
+    const TreeNode* node = findMin(__atomic_load_n(&tree->root, __ATOMIC_ACQUIRE));
+    if (node) *min = node->data;
+    epochExit();
+
+    return node != NULL;
+}
+
+void combiningFree(CombiningTree* tree) {
+    if (tree == NULL) return;
+
+    freeTree(tree->root);
+    free(tree->batch);
+    free(tree->inserts);
+    free(tree->deletes);
+    free(tree->results);
+    free(tree->deleters);
+    free(tree);
+}
+
+/*
+ * We check for pending requests again after giving up the combiner role, and publishers check after they push, so
+ * a request published while a combiner finishes is always picked up by one of the two.
+ * A combiner applies at most COMBINE_PASSES batches in a row, so that its own caller can return while others keep
+ * publishing. It only stops when another thread is waiting: that thread either takes over, or finds its request done
+ * and takes over when it stops waiting (see combiningWait). With nobody waiting we go on, or requests that were
+ * submitted without waiting would be left behind.
+ */
+static void tryCombine(CombiningTree* tree, const bool isWaiting) {
+    while (__atomic_load_n(&tree->pending, __ATOMIC_SEQ_CST) != NULL &&
+           !__atomic_exchange_n(&tree->isCombining, 1, __ATOMIC_ACQUIRE)) {
+
+        TreeRequest* list;
+        int passes = 0;
+        while (passes < COMBINE_PASSES && (list = __atomic_exchange_n(&tree->pending, NULL, __ATOMIC_ACQUIRE))) {
+            applyRequests(tree, list);
+            passes++;
+        }
+
+        __atomic_store_n(&tree->isCombining, 0, __ATOMIC_SEQ_CST);
+        if (passes == COMBINE_PASSES && __atomic_load_n(&tree->waiting, __ATOMIC_SEQ_CST) > isWaiting) return;
+    }
+}
+
+/*
+ * The batch is sorted by value, so every value is handled in one place. Inserts of a value wait in a counter, and a
+ * delete of the value takes one of them back before it goes to the tree, which gives the same results as applying
+ * the requests one by one. The deletes that remain go to the tree first, all in one deleteBatchChecked, which gives
+ * the copies of a value to its earliest deletes. Then the inserts that remain are merged in one insertBatch.
+ */
+static void applyRequests(CombiningTree* tree, TreeRequest* list) {
+    size_t n = 0;
+    for (TreeRequest* request = list; request; request = request->next) n++;
+
+    if (n > tree->batchCapacity) {
+        tree->batchCapacity = 2 * n;
+        tree->batch = (TreeRequest**)realloc(tree->batch, tree->batchCapacity * sizeof(TreeRequest*));
+        tree->inserts = (int*)realloc(tree->inserts, tree->batchCapacity * sizeof(int));
+        tree->deletes = (int*)realloc(tree->deletes, tree->batchCapacity * sizeof(int));
+        tree->results = (bool*)realloc(tree->results, tree->batchCapacity * sizeof(bool));
+        tree->deleters = (TreeRequest**)realloc(tree->deleters, tree->batchCapacity * sizeof(TreeRequest*));
+    }
+
+    // The list is the newest first, so the batch is filled from its end
+    size_t index = n;
+    for (TreeRequest* request = list; request; request = request->next) {
+        request->sequence = --index;
+        tree->batch[index] = request;
+    }
+    qsort(tree->batch, n, sizeof(TreeRequest*), compareRequests);
+
+    size_t inserts = 0, deletes = 0;
+    for (size_t i = 0; i < n;) {
+        const int data = tree->batch[i]->data;
+        size_t copies = 0;
+
+        for (; i < n && tree->batch[i]->data == data; ++i) {
+            TreeRequest* request = tree->batch[i];
+            if (request->operation == TREE_INSERT) {
+                copies++;
+                request->result = true;
+            }
+            else if (copies > 0) {
+                copies--;
+                request->result = true;
+            }
+            else {
+                tree->deleters[deletes] = request;
+                tree->deletes[deletes++] = data;
+            }
+        }
+
+        while (copies-- > 0) tree->inserts[inserts++] = data;
+    }
+
+    TreeNode* root = deleteBatchChecked(tree->root, tree->deletes, deletes, tree->results);
+    for (size_t i = 0; i < deletes; ++i) tree->deleters[i]->result = tree->results[i];
+    __atomic_store_n(&tree->root, root, __ATOMIC_RELEASE);
+
+    root = insertBatch(root, tree->inserts, inserts);
+    __atomic_store_n(&tree->root, root, __ATOMIC_RELEASE);
+
+    // The request may be gone as soon as it is marked done, so it is the last thing we touch
+    for (size_t i = 0; i < n; ++i) {
+        TreeRequest* request = tree->batch[i];
+        if (request->callback) request->callback(request, request->context);
+        __atomic_store_n(&request->done, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static int compareRequests(const void* a, const void* b) {
+    const TreeRequest* x = *(TreeRequest* const*)a, *y = *(TreeRequest* const*)b;
+    if (x->data != y->data) return (x->data > y->data) - (x->data < y->data);
+    return (x->sequence > y->sequence) - (x->sequence < y->sequence);
+}
@@ -0,0 +1,79 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef COMBINING_TREE_H
+#define COMBINING_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "binary_tree.h"
+
+/*
+ * A front-end that applies all the writes to a binary search tree from a single thread at a time (flat combining).
+ * Writers don't walk the tree: they publish a request and either wait for it or go on. Whichever thread finds the
+ * tree free becomes the combiner. It takes every published request, sorts them by value and applies them together:
+ * the inserts are merged with a single insertBatch, and requests for the same value are applied in the order they
+ * were published. Requests of the same thread are applied in the order it published them.
+ * A delete that follows an insert of its value in the same batch cancels it without touching the tree, and the other
+ * deletes are swept down the tree together with a single deleteBatchChecked.
+ * So writers never hand latches to each other on the way down, and a batch costs one merge and one sweep instead of
+ * one walk per request. Searches go to the tree directly and run alongside the combiner.
+ * A combiner hands over to a waiting thread after a few batches, so a steady stream of requests does not keep it from
+ * returning. When no thread waits it keeps going, since requests submitted without waiting need someone to apply them.
+ *
+ * A request is owned by the caller and must stay alive until it is done.
+ */
+typedef enum TreeOperation {
+    TREE_INSERT,
+    TREE_DELETE
+} TreeOperation;
+
+typedef struct TreeRequest TreeRequest;
+
+// A callback runs on the combining thread once the request is applied, before it is marked done
+typedef void (*RequestCallback)(TreeRequest* request, void* context);
+
+struct TreeRequest {
+    TreeOperation operation;
+    int data;
+    bool result; // For a delete, whether the value was in the tree. Inserts always succeed.
+    RequestCallback callback;
+    void* context;
+
+    // Owned by the tree while the request is pending
+    int done;
+    size_t sequence;
+    TreeRequest* next;
+};
+
+typedef struct CombiningTree CombiningTree;
+
+// This function creates a front-end for a tree, which it takes over. The tree may be NULL. Returns NULL on failure.
+CombiningTree* combiningCreate(TreeNode* root);
+
+// This function prepares a request. The callback may be NULL.
+void requestInit(TreeRequest* request, TreeOperation operation, int data, RequestCallback callback, void* context);
+
+// This function publishes a request and returns, applying the pending requests if no other thread is doing it
+void combiningSubmit(CombiningTree* tree, TreeRequest* request);
+
+// This function checks whether a request was applied
+bool requestDone(const TreeRequest* request);
+
+// This function waits until a request is applied, combining meanwhile if no other thread is, and returns its result
+bool combiningWait(CombiningTree* tree, TreeRequest* request);
+
+// These functions publish a request and wait for it
+void combiningInsert(CombiningTree* tree, const int data);
+bool combiningDelete(CombiningTree* tree, const int data);
+
+// These functions read the tree directly, like searchNode and findMin
+bool combiningSearch(CombiningTree* tree, const int data);
+bool combiningFindMin(CombiningTree* tree, int* min);
+
+// This function frees the tree. No request may be pending.
+void combiningFree(CombiningTree* tree);
+
+#endif //COMBINING_TREE_H
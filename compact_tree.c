@@ -0,0 +1,564 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "compact_tree.h"
+#include "epoch.h"
+
+#include <omp.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * An index is a chunk number in its high CHUNK_BITS bits and a position in the chunk in the low ones. A chunk holds up
+ * to 2^CHUNK_BITS nodes, but the first chunks are smaller and double in size, so a small tree does not take a whole
+ * chunk: chunk c holds 2^(FIRST_CHUNK_BITS + c) nodes until that reaches 2^CHUNK_BITS.
+ */
+#define CHUNK_BITS 16
+#define CHUNK_NODES ((uint32_t)1 << CHUNK_BITS)
+#define FIRST_CHUNK_BITS 8
+
+// Chunks are made of blocks of 2^BLOCK_BITS nodes that are aligned to their size, so the block of a node is found by
+// masking its address
+#define BLOCK_BITS 8
+#define BLOCK_NODES ((uint32_t)1 << BLOCK_BITS)
+#define BLOCK_BYTES (BLOCK_NODES * sizeof(CompactNode))
+
+// The chunk table has two levels of 2^TABLE_BITS entries, and a table of the second level is created with its first
+// chunk, so a small tree has a single one
+#define TABLE_BITS 8
+#define TABLE_SIZE ((size_t)1 << TABLE_BITS)
+
+// Index 0 means no node
+#define NO_NODE 0
+
+/*
+ * The 'meta' word of a node: bit 0 is the latch, and the rest is the version counter. A writer that holds the latch
+ * adds VERSION_UNIT before and after a change, so the counter is odd (VERSION_WRITING is set) during the change.
+ * Taking and releasing the latch does not change the version, so readers only retry on real changes.
+ */
+#define LATCH_BIT 1u
+#define VERSION_UNIT 2u
+#define VERSION_WRITING 2u
+
+// Number of lock-free search attempts before falling back to locking, as in binary_tree.c
+#define OPTIMISTIC_RETRIES 8
+
+// The number of times we check a busy latch before giving the processor to another thread
+#define SPINS_BEFORE_YIELD 64
+
+typedef struct CompactNode {
+    int data;
+    uint32_t left;
+    uint32_t right;
+    uint32_t meta;
+} CompactNode;
+
+// The first node of every block is replaced by this header, so no node ever has an index that is a multiple of 2^8
+typedef struct CompactBlock {
+    CompactTree* tree;
+    uint32_t base;
+} CompactBlock;
+
+/*
+ * The head node is never removed and is not a value: its left child is the root of the tree, so a change of the root
+ * is a change of the head like any other change of a parent.
+ */
+struct CompactTree {
+    CompactNode** tables[TABLE_SIZE]; // Chunk c is tables[c >> TABLE_BITS][c % TABLE_SIZE]
+    omp_lock_t lock; // Protects the free list and the creation of chunks and tables
+    uint32_t next; // The next index that was never handed out
+    uint32_t freeList; // Free nodes, linked through 'left'
+    unsigned long references; // One for the tree, and one for every retired node that was not reclaimed yet
+    uint32_t head;
+};
+
+// This function returns the node of an index
+static inline CompactNode* nodeAt(const CompactTree* tree, uint32_t index);
+
+// This function returns the number of nodes a chunk holds
+static inline uint32_t chunkNodes(size_t chunk);
+
+// This function creates a chunk and its table if they do not exist yet
+static void createChunk(CompactTree* tree, size_t chunk);
+
+// These functions take a node from the pool, and return a removed one once no reader can see it
+static uint32_t allocNode(CompactTree* tree, int data);
+static void retireNode(CompactTree* tree, uint32_t index);
+static void reclaimNode(void* object);
+
+// This function drops a reference to a tree, and frees it with the last one
+static void treeUnref(CompactTree* tree);
+
+// The latch and the version counter, see 'meta'
+static inline void latchNode(CompactNode* node);
+static inline void unlatchNode(CompactNode* node);
+static inline void beginWrite(CompactNode* node);
+static inline void endWrite(CompactNode* node);
+static inline bool readBegin(const CompactNode* node, uint32_t* version);
+static inline bool readValidate(const CompactNode* node, uint32_t version);
+
+// The lock-free walks, return false if they ran into a writer and should be retried
+static bool searchOptimistic(const CompactTree* tree, int data, bool* found);
+static bool findMinOptimistic(const CompactTree* tree, bool* found, int* min);
+
+// The locked walks, used when the lock-free ones keep failing
+static bool searchLocked(const CompactTree* tree, int data);
+static bool findMinLocked(const CompactTree* tree, int* min);
+
+// Create a tree whose pool holds only the head
+CompactTree* compactCreate(void) {
+    CompactTree* tree = (CompactTree*)calloc(1, sizeof(CompactTree));
+    omp_init_lock(&tree->lock);
+    tree->next = 1;
+    tree->freeList = NO_NODE;
+    tree->references = 1;
+    tree->head = allocNode(tree, 0);
+
+    return tree;
+}
+
+// Insert a value, locking hand-over-hand from the head down to the empty child it goes to
+void compactInsert(CompactTree* tree, const int data) {
+    CompactNode* node = nodeAt(tree, tree->head);
+    latchNode(node);
+
+    // The head sends everything to its left
+    uint32_t* child = &node->left;
+    while (*child != NO_NODE) {
+        CompactNode* next = nodeAt(tree, *child);
+        latchNode(next);
+        unlatchNode(node);
+
+        node = next;
+        child = data <= node->data ? &node->left : &node->right;
+    }
+
+    const uint32_t leaf = allocNode(tree, data);
+    beginWrite(node);
+    __atomic_store_n(child, leaf, __ATOMIC_RELAXED);
+    endWrite(node);
+    unlatchNode(node);
+}
+
+/*
+ * Delete one copy of a value, like deleteNode.
+ * We hold the node and its parent, which is the head for the root. A node with at most one child is replaced by the
+ * child, and a node with two children takes the value of its successor, which is removed instead.
+ */
+bool compactDelete(CompactTree* tree, const int data) {
+    CompactNode* parent = nodeAt(tree, tree->head);
+    latchNode(parent);
+
+    uint32_t index = parent->left;
+    if (index == NO_NODE) {
+        unlatchNode(parent);
+        return false;
+    }
+
+    CompactNode* node = nodeAt(tree, index);
+    latchNode(node);
+
+    while (node->data != data) {
+        const uint32_t next = data <= node->data ? node->left : node->right;
+
+        // The value is not in the tree
+        if (next == NO_NODE) {
+            unlatchNode(node);
+            unlatchNode(parent);
+            return false;
+        }
+
+        CompactNode* nextNode = nodeAt(tree, next);
+        latchNode(nextNode);
+        unlatchNode(parent);
+
+        parent = node;
+        node = nextNode;
+        index = next;
+    }
+
+    // At most one child: the child takes the place of the node
+    if (node->left == NO_NODE || node->right == NO_NODE) {
+        const uint32_t child = node->left != NO_NODE ? node->left : node->right;
+
+        beginWrite(parent);
+        if (parent->left == index) __atomic_store_n(&parent->left, child, __ATOMIC_RELAXED);
+        else __atomic_store_n(&parent->right, child, __ATOMIC_RELAXED);
+        endWrite(parent);
+
+        unlatchNode(parent);
+        unlatchNode(node);
+        retireNode(tree, index);
+        return true;
+    }
+
+    // Two children: find the successor, the leftmost node of the right subtree, holding it and its parent
+    unlatchNode(parent);
+
+    uint32_t successorIndex = node->right;
+    CompactNode* successor = nodeAt(tree, successorIndex), *successorParent = node;
+    latchNode(successor);
+
+    while (successor->left != NO_NODE) {
+        const uint32_t next = successor->left;
+        CompactNode* nextNode = nodeAt(tree, next);
+        latchNode(nextNode);
+        if (successorParent != node) unlatchNode(successorParent);
+
+        successorParent = successor;
+        successor = nextNode;
+        successorIndex = next;
+    }
+
+    beginWrite(successorParent);
+    if (successorParent->left == successorIndex) __atomic_store_n(&successorParent->left, successor->right,
+                                                                  __ATOMIC_RELAXED);
+    else __atomic_store_n(&successorParent->right, successor->right, __ATOMIC_RELAXED);
+    endWrite(successorParent);
+
+    beginWrite(node);
+    __atomic_store_n(&node->data, successor->data, __ATOMIC_RELAXED);
+    endWrite(node);
+
+    unlatchNode(successor);
+    if (successorParent != node) unlatchNode(successorParent);
+    unlatchNode(node);
+    retireNode(tree, successorIndex);
+
+    return true;
+}
+
+// Search without locks first, inside an epoch so that the nodes we pass are not reused under us
+bool compactSearch(const CompactTree* tree, const int data) {
+    epochEnter();
+    for (int attempt = 0; attempt < OPTIMISTIC_RETRIES; ++attempt) {
+        bool found = false;
+        if (searchOptimistic(tree, data, &found)) {
+            epochExit();
+            return found;
+        }
+    }
+    epochExit();
+
+    return searchLocked(tree, data);
+}
+
+// Walk down the left children, like compactSearch
+bool compactFindMin(const CompactTree* tree, int* min) {
+    epochEnter();
+    for (int attempt = 0; attempt < OPTIMISTIC_RETRIES; ++attempt) {
+        bool found = false;
+        if (findMinOptimistic(tree, &found, min)) {
+            epochExit();
+            return found;
+        }
+    }
+    epochExit();
+
+    return findMinLocked(tree, min);
+}
+
+// Every chunk and table that exists counts in full, whether or not its nodes are used
+size_t compactMemory(const CompactTree* tree) {
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < TABLE_SIZE; ++i) {
+        CompactNode** table = __atomic_load_n(&tree->tables[i], __ATOMIC_ACQUIRE);
+        if (table == NULL) continue;
+
+        bytes += TABLE_SIZE * sizeof(CompactNode*);
+        for (size_t j = 0; j < TABLE_SIZE; ++j) {
+            if (__atomic_load_n(&table[j], __ATOMIC_ACQUIRE) == NULL) continue;
+            bytes += chunkNodes(i * TABLE_SIZE + j) * sizeof(CompactNode);
+        }
+    }
+
+    return bytes;
+}
+
+// Drop the reference of the tree, and reclaim the retired nodes that no reader can see anymore, so that the pool goes
+// now rather than whenever their threads retire again
+void compactFree(CompactTree* tree) {
+    if (tree == NULL) return;
+
+    treeUnref(tree);
+    epochCollect();
+}
+
+// The chunk number is in the high bits of the index, the position in the chunk in the low bits
+static inline CompactNode* nodeAt(const CompactTree* tree, const uint32_t index) {
+    const size_t chunk = index >> CHUNK_BITS;
+    CompactNode** table = __atomic_load_n(&tree->tables[chunk >> TABLE_BITS], __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&table[chunk & (TABLE_SIZE - 1)], __ATOMIC_ACQUIRE) + (index & (CHUNK_NODES - 1));
+}
+
+static inline uint32_t chunkNodes(const size_t chunk) {
+    return chunk < CHUNK_BITS - FIRST_CHUNK_BITS ? (uint32_t)1 << (FIRST_CHUNK_BITS + chunk) : CHUNK_NODES;
+}
+
+/*
+ * This function takes a node from the free list, or else the next index that was never used, skipping the first
+ * index of every block, which is the block header, and the positions past the end of a small chunk. A new chunk is
+ * created by the first thread that needs it.
+ */
+static uint32_t allocNode(CompactTree* tree, const int data) {
+    uint32_t index = NO_NODE;
+
+    if (__atomic_load_n(&tree->freeList, __ATOMIC_RELAXED) != NO_NODE) {
+        omp_set_lock(&tree->lock);
+        index = tree->freeList;
+        if (index != NO_NODE) tree->freeList = nodeAt(tree, index)->left;
+        omp_unset_lock(&tree->lock);
+    }
+
+    if (index == NO_NODE) {
+        uint32_t position;
+        do {
+            index = __atomic_fetch_add(&tree->next, 1, __ATOMIC_RELAXED);
+            if (index == UINT32_MAX) abort();
+
+            // The first thread past the end of a small chunk moves the others to the next chunk
+            position = index & (CHUNK_NODES - 1);
+            if (position >= chunkNodes(index >> CHUNK_BITS)) {
+                uint32_t expected = index + 1;
+                __atomic_compare_exchange_n(&tree->next, &expected, (index | (CHUNK_NODES - 1)) + 1, false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            }
+        } while ((position & (BLOCK_NODES - 1)) == 0 || position >= chunkNodes(index >> CHUNK_BITS));
+
+        createChunk(tree, index >> CHUNK_BITS);
+    }
+
+    // A reused node may still be read by a late lock-free reader, so we keep its version counter going
+    CompactNode* node = nodeAt(tree, index);
+    beginWrite(node);
+    node->data = data;
+    node->left = NO_NODE;
+    node->right = NO_NODE;
+    endWrite(node);
+
+    return index;
+}
+
+// Chunks and tables are published with a release store, after their block headers are written
+static void createChunk(CompactTree* tree, const size_t chunk) {
+    CompactNode** table = __atomic_load_n(&tree->tables[chunk >> TABLE_BITS], __ATOMIC_ACQUIRE);
+    if (table && __atomic_load_n(&table[chunk & (TABLE_SIZE - 1)], __ATOMIC_ACQUIRE)) return;
+
+    omp_set_lock(&tree->lock);
+
+    table = tree->tables[chunk >> TABLE_BITS];
+    if (table == NULL) {
+        table = (CompactNode**)calloc(TABLE_SIZE, sizeof(CompactNode*));
+        if (table == NULL) abort();
+        __atomic_store_n(&tree->tables[chunk >> TABLE_BITS], table, __ATOMIC_RELEASE);
+    }
+
+    if (table[chunk & (TABLE_SIZE - 1)] == NULL) {
+        const size_t bytes = chunkNodes(chunk) * sizeof(CompactNode);
+        void* memory = NULL;
+        if (posix_memalign(&memory, BLOCK_BYTES, bytes) != 0) abort();
+        memset(memory, 0, bytes);
+
+        for (uint32_t block = 0; block < chunkNodes(chunk); block += BLOCK_NODES) {
+            CompactBlock* header = (CompactBlock*)((CompactNode*)memory + block);
+            header->tree = tree;
+            header->base = (uint32_t)(chunk << CHUNK_BITS) + block;
+        }
+        __atomic_store_n(&table[chunk & (TABLE_SIZE - 1)], (CompactNode*)memory, __ATOMIC_RELEASE);
+    }
+
+    omp_unset_lock(&tree->lock);
+}
+
+// The node is changed once more so that readers still looking at it fail their validation, then waits for the epoch
+static void retireNode(CompactTree* tree, const uint32_t index) {
+    CompactNode* node = nodeAt(tree, index);
+    beginWrite(node);
+    endWrite(node);
+
+    __atomic_add_fetch(&tree->references, 1, __ATOMIC_RELAXED);
+    epochRetire(node, reclaimNode);
+}
+
+// The block header tells the tree and the index of the node
+static void reclaimNode(void* object) {
+    CompactNode* node = (CompactNode*)object;
+    const CompactBlock* header = (const CompactBlock*)((uintptr_t)node & ~(uintptr_t)(BLOCK_BYTES - 1));
+    CompactTree* tree = header->tree;
+    const uint32_t index = header->base + (uint32_t)(node - (CompactNode*)header);
+
+    omp_set_lock(&tree->lock);
+    node->left = tree->freeList;
+    __atomic_store_n(&tree->freeList, index, __ATOMIC_RELAXED);
+    omp_unset_lock(&tree->lock);
+
+    treeUnref(tree);
+}
+
+static void treeUnref(CompactTree* tree) {
+    if (__atomic_sub_fetch(&tree->references, 1, __ATOMIC_ACQ_REL) != 0) return;
+
+    // Threads create the chunks of the indices they take, so the chunks need not be created in index order
+    for (size_t i = 0; i < TABLE_SIZE; ++i) {
+        if (tree->tables[i] == NULL) continue;
+
+        for (size_t j = 0; j < TABLE_SIZE; ++j) free(tree->tables[i][j]);
+        free(tree->tables[i]);
+    }
+    omp_destroy_lock(&tree->lock);
+    free(tree);
+}
+
+// Spin until the latch bit is clear and we are the one who sets it, giving the processor away now and then
+static inline void latchNode(CompactNode* node) {
+    int spins = 0;
+
+    while (true) {
+        uint32_t meta = __atomic_load_n(&node->meta, __ATOMIC_RELAXED);
+        if (!(meta & LATCH_BIT) && __atomic_compare_exchange_n(&node->meta, &meta, meta | LATCH_BIT, true,
+                                                               __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return;
+        }
+
+        if (++spins < SPINS_BEFORE_YIELD) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            continue;
+        }
+        spins = 0;
+        sched_yield();
+    }
+}
+
+static inline void unlatchNode(CompactNode* node) {
+    __atomic_fetch_and(&node->meta, ~LATCH_BIT, __ATOMIC_RELEASE);
+}
+
+// The version changes with an atomic add, since other threads may set the latch bit of the same word meanwhile
+static inline void beginWrite(CompactNode* node) {
+    __atomic_fetch_add(&node->meta, VERSION_UNIT, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void endWrite(CompactNode* node) {
+    __atomic_fetch_add(&node->meta, VERSION_UNIT, __ATOMIC_RELEASE);
+}
+
+// The latch bit is not part of the version
+static inline bool readBegin(const CompactNode* node, uint32_t* version) {
+    *version = __atomic_load_n(&node->meta, __ATOMIC_ACQUIRE) & ~LATCH_BIT;
+    return !(*version & VERSION_WRITING);
+}
+
+static inline bool readValidate(const CompactNode* node, const uint32_t version) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (__atomic_load_n(&node->meta, __ATOMIC_RELAXED) & ~LATCH_BIT) == version;
+}
+
+/*
+ * The lock-free search of searchNode, starting at the head: a child index is only followed after its parent was
+ * validated again, so we never follow an index read from a node that changed or was removed.
+ */
+static bool searchOptimistic(const CompactTree* tree, const int data, bool* found) {
+    const CompactNode* node = nodeAt(tree, tree->head);
+    uint32_t version;
+    if (!readBegin(node, &version)) return false;
+
+    uint32_t child = __atomic_load_n(&node->left, __ATOMIC_RELAXED);
+    while (true) {
+        if (!readValidate(node, version)) return false;
+
+        if (child == NO_NODE) {
+            *found = false;
+            return true;
+        }
+
+        const CompactNode* next = nodeAt(tree, child);
+        uint32_t nextVersion;
+        if (!readBegin(next, &nextVersion)) return false;
+        if (!readValidate(node, version)) return false;
+
+        node = next;
+        version = nextVersion;
+
+        const int value = __atomic_load_n(&node->data, __ATOMIC_RELAXED);
+        if (value == data) {
+            *found = true;
+            return readValidate(node, version);
+        }
+
+        child = data <= value ? __atomic_load_n(&node->left, __ATOMIC_RELAXED)
+                              : __atomic_load_n(&node->right, __ATOMIC_RELAXED);
+    }
+}
+
+// Like searchOptimistic, always going left and reading the last node
+static bool findMinOptimistic(const CompactTree* tree, bool* found, int* min) {
+    const CompactNode* node = nodeAt(tree, tree->head);
+    uint32_t version;
+    if (!readBegin(node, &version)) return false;
+
+    uint32_t child = __atomic_load_n(&node->left, __ATOMIC_RELAXED);
+    *found = false;
+    while (true) {
+        if (!readValidate(node, version)) return false;
+        if (child == NO_NODE) return true;
+
+        const CompactNode* next = nodeAt(tree, child);
+        uint32_t nextVersion;
+        if (!readBegin(next, &nextVersion)) return false;
+        if (!readValidate(node, version)) return false;
+
+        node = next;
+        version = nextVersion;
+
+        *min = __atomic_load_n(&node->data, __ATOMIC_RELAXED);
+        *found = true;
+        child = __atomic_load_n(&node->left, __ATOMIC_RELAXED);
+    }
+}
+
+// The nodes have a single latch, so the locked search takes them exclusively, hand-over-hand
+static bool searchLocked(const CompactTree* tree, const int data) {
+    CompactNode* node = nodeAt(tree, tree->head);
+    latchNode(node);
+
+    uint32_t child = node->left;
+    while (child != NO_NODE) {
+        CompactNode* next = nodeAt(tree, child);
+        latchNode(next);
+        unlatchNode(node);
+        node = next;
+
+        if (node->data == data) {
+            unlatchNode(node);
+            return true;
+        }
+        child = data <= node->data ? node->left : node->right;
+    }
+
+    unlatchNode(node);
+    return false;
+}
+
+static bool findMinLocked(const CompactTree* tree, int* min) {
+    CompactNode* node = nodeAt(tree, tree->head);
+    latchNode(node);
+
+    bool isFound = false;
+    while (node->left != NO_NODE) {
+        CompactNode* next = nodeAt(tree, node->left);
+        latchNode(next);
+        unlatchNode(node);
+        node = next;
+
+        *min = node->data;
+        isFound = true;
+    }
+
+    unlatchNode(node);
+    return isFound;
+}
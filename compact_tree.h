@@ -0,0 +1,45 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef COMPACT_TREE_H
+#define COMPACT_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A binary search tree with the contract of binary_tree.h (duplicates go left, every delete removes one copy of a
+ * value) in 16 bytes per node instead of 40: children are 32-bit indices into the node pool of the tree, and the latch
+ * and the version counter of the lock-free search share one 32-bit word. Four nodes fit in a cache line.
+ *
+ * The pool is made of chunks of up to 2^16 nodes, so an index is a chunk number and a position in it, and a tree
+ * holds a little less than 2^32 nodes. The first chunks start at 256 nodes and double, and the chunk table grows with
+ * them, so an empty tree takes a few KiB. Removed nodes go back to the pool through epoch.h.
+ * All functions are thread safe. Writers lock hand-over-hand and searches walk without locks, like the locked tree.
+ */
+typedef struct CompactTree CompactTree;
+
+// This function creates a new empty tree
+CompactTree* compactCreate(void);
+
+// This function inserts a value to the tree
+void compactInsert(CompactTree* tree, const int data);
+
+// This function deletes one copy of a value from the tree, returns false if the value is not in the tree
+bool compactDelete(CompactTree* tree, const int data);
+
+// This function checks whether a value exists in the tree
+bool compactSearch(const CompactTree* tree, const int data);
+
+// This function finds the minimal value in the tree, returns false if the tree is empty
+bool compactFindMin(const CompactTree* tree, int* min);
+
+// This function returns the number of bytes the node pool of the tree takes
+size_t compactMemory(const CompactTree* tree);
+
+// This function frees the tree. No other thread may use it anymore. Retired nodes are reclaimed through epochCollect,
+// so the pool goes right away unless a reader is inside an epoch.
+void compactFree(CompactTree* tree);
+
+#endif //COMPACT_TREE_H
@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "epoch.h"
+
+#include <omp.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The number of retires between two attempts to advance the epoch and reclaim the limbo list
+#define EPOCH_RETIRE_BATCH 64
+
+// An object in a limbo list, with the global epoch at the time it was retired
+typedef struct LimboEntry {
+    void* object;
+    EpochReclaim reclaim;
+    unsigned long epoch;
+} LimboEntry;
+
+/*
+ * The record of a thread. 'state' is the epoch the thread entered shifted left by one, with the lowest bit set while
+ * the thread is inside an epoch. It is the only field other threads read, so it gets a cache line of its own.
+ * Records are never freed: a thread that exits leaves its record inactive, and the other threads reclaim its limbo
+ * list when they sweep.
+ */
+typedef struct EpochThread {
+    unsigned long state;
+    char padding[64 - sizeof(unsigned long)];
+
+    int depth;
+    omp_lock_t lock; // Protects the limbo list from epochSynchronize
+    LimboEntry* limbo;
+    size_t count;
+    size_t capacity;
+    size_t retiredSinceScan;
+    struct EpochThread* next;
+} EpochThread;
+
+static unsigned long globalEpoch = 0;
+static EpochThread* threads = NULL;
+
+static EpochThread* self = NULL;
+#pragma omp threadprivate(self)
+
+// This function returns the record of the calling thread, registering it on first use
+static EpochThread* threadRecord(void);
+
+// This function advances the global epoch if every thread inside an epoch already entered the current one
+static bool tryAdvance(void);
+
+// This function reclaims the objects of a locked record that no reader can see anymore
+static void reclaimLimbo(EpochThread* thread);
+
+// This function reclaims what it can from the records of all the threads but 'own', skipping the ones that are busy
+static void sweepLimbos(const EpochThread* own);
+
+// Enter an epoch, announcing the global epoch we read before touching any shared pointer
+void epochEnter(void) {
+    EpochThread* thread = threadRecord();
+    if (thread->depth++ > 0) return;
+
+    const unsigned long epoch = __atomic_load_n(&globalEpoch, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&thread->state, epoch << 1 | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// Leave an epoch. Everything we read inside it is done with.
+void epochExit(void) {
+    EpochThread* thread = self;
+    if (--thread->depth > 0) return;
+
+    __atomic_store_n(&thread->state, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * This function adds an object to the limbo list of the calling thread.
+ * The object was unlinked before we read the global epoch, so a thread that enters an epoch after it advances cannot
+ * find it. Two advances later every thread that could have found it has left its epoch.
+ */
+void epochRetire(void* object, const EpochReclaim reclaim) {
+    EpochThread* thread = threadRecord();
+
+    omp_set_lock(&thread->lock);
+
+    if (thread->count == thread->capacity) {
+        thread->capacity = thread->capacity ? thread->capacity * 2 : EPOCH_RETIRE_BATCH;
+        thread->limbo = (LimboEntry*)realloc(thread->limbo, thread->capacity * sizeof(LimboEntry));
+    }
+
+    LimboEntry* entry = &thread->limbo[thread->count++];
+    entry->object = object;
+    entry->reclaim = reclaim;
+    entry->epoch = __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST);
+
+    if (++thread->retiredSinceScan >= EPOCH_RETIRE_BATCH) {
+        thread->retiredSinceScan = 0;
+        tryAdvance();
+        reclaimLimbo(thread);
+        sweepLimbos(thread);
+    }
+
+    omp_unset_lock(&thread->lock);
+}
+
+// Advance the epoch twice, waiting for the readers of each one, and reclaim every limbo list
+void epochSynchronize(void) {
+    const unsigned long target = __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST) + 2;
+
+    while (__atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST) < target) {
+        if (!tryAdvance()) sched_yield();
+    }
+
+    for (EpochThread* thread = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+        omp_set_lock(&thread->lock);
+        reclaimLimbo(thread);
+        omp_unset_lock(&thread->lock);
+    }
+}
+
+// Two advances are enough for everything retired before the call, when no reader holds the epoch back
+void epochCollect(void) {
+    tryAdvance();
+    tryAdvance();
+    sweepLimbos(NULL);
+}
+
+// Create the record of a new thread and push it to the list of all the records
+static EpochThread* threadRecord(void) {
+    if (self) return self;
+
+    EpochThread* thread = (EpochThread*)calloc(1, sizeof(EpochThread));
+    omp_init_lock(&thread->lock);
+
+    thread->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&threads, &thread->next, thread, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+
+    self = thread;
+    return thread;
+}
+
+// A thread that is still inside an older epoch may hold pointers retired in it, so it holds the epoch back
+static bool tryAdvance(void) {
+    unsigned long epoch = __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST);
+
+    for (EpochThread* thread = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+        const unsigned long state = __atomic_load_n(&thread->state, __ATOMIC_SEQ_CST);
+        if ((state & 1) && state >> 1 != epoch) return false;
+    }
+
+    return __atomic_compare_exchange_n(&globalEpoch, &epoch, epoch + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+// Entries are added in epoch order, so the ones that are safe to reclaim are a prefix of the list
+static void reclaimLimbo(EpochThread* thread) {
+    const unsigned long epoch = __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST);
+
+    size_t reclaimed = 0;
+    while (reclaimed < thread->count && thread->limbo[reclaimed].epoch + 2 <= epoch) {
+        thread->limbo[reclaimed].reclaim(thread->limbo[reclaimed].object);
+        reclaimed++;
+    }
+
+    thread->count -= reclaimed;
+    memmove(thread->limbo, thread->limbo + reclaimed, thread->count * sizeof(LimboEntry));
+}
+
+// A busy record is being reclaimed or appended to by its owner, who reclaims it itself, so we never wait for it
+static void sweepLimbos(const EpochThread* own) {
+    for (EpochThread* thread = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+        if (thread == own || !omp_test_lock(&thread->lock)) continue;
+
+        reclaimLimbo(thread);
+        omp_unset_lock(&thread->lock);
+    }
+}
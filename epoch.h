@@ -0,0 +1,44 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stdbool.h>
+
+/*
+ * Epoch-based reclamation.
+ * A thread that reads shared memory without locks does it between epochEnter and epochExit. An object that was
+ * unlinked is passed to epochRetire instead of being freed, and waits in a limbo list of the retiring thread. Its
+ * reclaim function runs once every thread that was inside an epoch when it was retired has left it, so no reader
+ * can still hold a pointer to it. Limbo lists are reclaimed in batches, every EPOCH_RETIRE_BATCH retires, and every
+ * batch also sweeps the lists of the other threads, so the objects of a thread that stopped retiring (or exited) are
+ * not left behind.
+ */
+
+// The function that finally frees a retired object. It must not retire objects itself.
+typedef void (*EpochReclaim)(void* object);
+
+// These functions mark a section in which the calling thread may hold pointers to retired objects. They nest.
+void epochEnter(void);
+void epochExit(void);
+
+// This function schedules an unreachable object to be reclaimed once no reader can still see it
+void epochRetire(void* object, EpochReclaim reclaim);
+
+/*
+ * This function waits until no thread is inside an epoch it entered before the call, and then reclaims everything
+ * that was retired before the call, by any thread. It must not be called from inside an epoch.
+ */
+void epochSynchronize(void);
+
+/*
+ * This function reclaims, without waiting, everything in the limbo lists of all the threads that no reader can see
+ * anymore. It tries to advance the epoch first, so objects that were just retired go too unless a thread is inside an
+ * epoch. arenaRelease and compactFree call it, so freeing a tree returns the memory of its retired nodes right away
+ * when it can.
+ */
+void epochCollect(void);
+
+#endif //EPOCH_H
@@ -0,0 +1,94 @@
+#include "eytzinger.h"
+
+#include <stdlib.h>
+
+// This function fills the implicit subtree of a position by an in-order walk, and returns the next index of the sorted
+// array. fillSorted is the other way around.
+static size_t fillLayout(const int* sorted, int* values, size_t n, size_t position, size_t next);
+static size_t fillSorted(const int* values, int* sorted, size_t n, size_t position, size_t next);
+
+// The array doubles as the iterator goes, so it is read in a single pass
+int* eytzingerCollect(TreeNode* root, size_t* count) {
+    size_t capacity = 1024, n = 0;
+    int* sorted = (int*)malloc(capacity * sizeof(int));
+
+    TreeIterator iterator;
+    int data;
+    iteratorInit(&iterator, root);
+    while (iteratorNext(&iterator, &data)) {
+        if (n == capacity) {
+            capacity *= 2;
+            sorted = (int*)realloc(sorted, capacity * sizeof(int));
+        }
+        sorted[n++] = data;
+    }
+    iteratorDestroy(&iterator);
+
+    *count = n;
+    return sorted;
+}
+
+void eytzingerFromSorted(const int* sorted, int* values, const size_t n) {
+    fillLayout(sorted, values, n, 1, 0);
+}
+
+void eytzingerToSorted(const int* values, int* sorted, const size_t n) {
+    fillSorted(values, sorted, n, 1, 0);
+}
+
+/*
+ * Walk down the implicit tree without branches, going right whenever the value at the position is smaller, so we end
+ * below the first value that is not smaller than data. The right turns we took after it are the trailing ones of the
+ * position, and shifting them out (with the left turn before them) gives its position back.
+ * Positions 16i to 16i + 15 are a single aligned cache line, which we prefetch 4 levels ahead. The prefetch may point
+ * past the array near the leaves, which is harmless.
+ */
+bool eytzingerSearch(const int* values, const size_t n, const int data) {
+    size_t position = 1;
+    while (position <= n) {
+        __builtin_prefetch(values + 16 * position);
+        position = 2 * position + (values[position] < data);
+    }
+    position >>= __builtin_ffsll((long long)~position);
+
+    return position != 0 && values[position] == data;
+}
+
+// The minimum is the leftmost position
+bool eytzingerFindMin(const int* values, const size_t n, int* min) {
+    if (n == 0) return false;
+
+    size_t position = 1;
+    while (2 * position <= n) position *= 2;
+    *min = values[position];
+
+    return true;
+}
+
+// insertBatch builds a perfectly balanced tree out of an empty one
+TreeNode* eytzingerRestore(const int* values, const size_t n) {
+    int* sorted = (int*)malloc((n ? n : 1) * sizeof(int));
+    eytzingerToSorted(values, sorted, n);
+
+    TreeNode* root = insertBatch(NULL, sorted, n);
+    free(sorted);
+
+    return root;
+}
+
+// The implicit tree is balanced, so the recursion is as deep as its height
+static size_t fillLayout(const int* sorted, int* values, const size_t n, const size_t position, size_t next) {
+    if (position > n) return next;
+
+    next = fillLayout(sorted, values, n, 2 * position, next);
+    values[position] = sorted[next++];
+    return fillLayout(sorted, values, n, 2 * position + 1, next);
+}
+
+static size_t fillSorted(const int* values, int* sorted, const size_t n, const size_t position, size_t next) {
+    if (position > n) return next;
+
+    next = fillSorted(values, sorted, n, 2 * position, next);
+    sorted[next++] = values[position];
+    return fillSorted(values, sorted, n, 2 * position + 1, next);
+}
@@ -0,0 +1,37 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef EYTZINGER_H
+#define EYTZINGER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "binary_tree.h"
+
+/*
+ * The Eytzinger layout shared by the frozen trees of frozen_tree.h and the mapped files of tree_file.h.
+ * The values form an implicit balanced tree in an array: the children of position i (counting from 1) are at 2i and
+ * 2i + 1, and the value of position i is values[i], so values[0] is not used. With the array aligned to a cache line,
+ * positions 16i to 16i + 15 share one line, which a search fetches while it walks the 4 levels above it.
+ */
+
+// This function reads the values of the tree in order, copies included, with an iterator, so writers may keep working
+// on it. It returns a new array with room for at least one value, and writes the number of values to count.
+int* eytzingerCollect(TreeNode* root, size_t* count);
+
+// These functions move n values between sorted order and the Eytzinger layout. values has room for n + 1 values.
+void eytzingerFromSorted(const int* sorted, int* values, size_t n);
+void eytzingerToSorted(const int* values, int* sorted, size_t n);
+
+// This function checks whether a value exists among the n values of the layout
+bool eytzingerSearch(const int* values, size_t n, int data);
+
+// This function finds the minimal value of the layout, returns false if it is empty
+bool eytzingerFindMin(const int* values, size_t n, int* min);
+
+// This function builds a perfectly balanced binary search tree of the n values of the layout
+TreeNode* eytzingerRestore(const int* values, size_t n);
+
+#endif //EYTZINGER_H
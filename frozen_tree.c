@@ -0,0 +1,64 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "frozen_tree.h"
+#include "eytzinger.h"
+
+#include <stdlib.h>
+
+#define CACHE_LINE 64
+
+struct FrozenTree {
+    int* values; // Position i of the implicit tree is values[i], values[0] is not used
+    size_t count;
+    size_t bytes;
+};
+
+// Read the values in order, then place them in an array whose position 16 starts a cache line
+FrozenTree* treeFreeze(TreeNode* root) {
+    size_t count = 0;
+    int* sorted = eytzingerCollect(root, &count);
+
+    const size_t bytes = ((count + 1) * sizeof(int) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    void* memory = NULL;
+    FrozenTree* tree = (FrozenTree*)malloc(sizeof(FrozenTree));
+    if (tree == NULL || posix_memalign(&memory, CACHE_LINE, bytes) != 0) {
+        free(tree);
+        free(sorted);
+        return NULL;
+    }
+
+    tree->values = (int*)memory;
+    tree->count = count;
+    tree->bytes = bytes;
+    eytzingerFromSorted(sorted, tree->values, count);
+    free(sorted);
+
+    return tree;
+}
+
+bool frozenSearch(const FrozenTree* tree, const int data) {
+    return eytzingerSearch(tree->values, tree->count, data);
+}
+
+bool frozenFindMin(const FrozenTree* tree, int* min) {
+    return eytzingerFindMin(tree->values, tree->count, min);
+}
+
+size_t frozenCount(const FrozenTree* tree) {
+    return tree->count;
+}
+
+size_t frozenMemory(const FrozenTree* tree) {
+    return sizeof(FrozenTree) + tree->bytes;
+}
+
+TreeNode* frozenThaw(const FrozenTree* tree) {
+    return eytzingerRestore(tree->values, tree->count);
+}
+
+void frozenFree(FrozenTree* tree) {
+    if (tree == NULL) return;
+
+    free(tree->values);
+    free(tree);
+}
@@ -0,0 +1,46 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef FROZEN_TREE_H
+#define FROZEN_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "binary_tree.h"
+
+/*
+ * A read-only copy of a tree for data that is written once and then searched many times.
+ * The values are kept as an implicit balanced tree in Eytzinger order, 4 bytes each with no pointers or latches: the
+ * children of position i are at 2i and 2i + 1. The array is aligned so that the 16 positions 4 levels below any
+ * position share one cache line, and a search fetches that line while it walks the 4 levels above it.
+ * A frozen tree never changes, so any number of threads may search it with no synchronization at all.
+ */
+typedef struct FrozenTree FrozenTree;
+
+/*
+ * This function copies the values of the tree, copies included, to a new frozen tree, and returns NULL if there is no
+ * memory for it. It reads the tree with an iterator, so writers may keep working on it, and leaves it as it is.
+ */
+FrozenTree* treeFreeze(TreeNode* root);
+
+// This function checks whether a value exists in a frozen tree
+bool frozenSearch(const FrozenTree* tree, const int data);
+
+// This function finds the minimal value in a frozen tree, returns false if it is empty
+bool frozenFindMin(const FrozenTree* tree, int* min);
+
+// This function returns the number of values in a frozen tree
+size_t frozenCount(const FrozenTree* tree);
+
+// This function returns the number of bytes a frozen tree takes
+size_t frozenMemory(const FrozenTree* tree);
+
+// This function builds a perfectly balanced binary search tree of the values of a frozen tree, to change them again
+TreeNode* frozenThaw(const FrozenTree* tree);
+
+// This function frees a frozen tree
+void frozenFree(FrozenTree* tree);
+
+#endif //FROZEN_TREE_H
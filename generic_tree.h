@@ -0,0 +1,376 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+/*
+ * A binary search tree of keys with values, generated for any key and value type. Include this file once per tree
+ * type, after defining:
+ *     TREE_NAME          - the prefix of the generated names, e.g. IntMap
+ *     TREE_KEY           - the key type
+ *     TREE_VALUE         - the value type
+ *     TREE_COMPARE(a, b) - optional, a negative, zero or positive int as a is smaller, equal or greater than b.
+ *                          The default compares with < and >.
+ * The definitions are removed at the end of the file, so it can be included again for another type.
+ *
+ * It generates the node type TREE_NAME##Node and the functions below, all static inline, so the comparison is
+ * compiled into every loop instead of being called through a pointer. For IntMap:
+ *     IntMapNode* IntMapCreate(int key, V value);
+ *     IntMapNode* IntMapInsert(IntMapNode* root, int key, V value);
+ *     IntMapNode* IntMapDelete(IntMapNode* root, int key);
+ *     bool IntMapSearch(const IntMapNode* root, int key, V* value);
+ *     bool IntMapFindMin(const IntMapNode* root, int* key, V* value);
+ *     void IntMapFree(IntMapNode* root);
+ *
+ * It has the contract of binary_tree.h: duplicate keys are allowed and go left, Delete removes one entry of a key, and
+ * Insert and Delete return the root, which changes only when the tree was empty or became empty. Writers lock
+ * hand-over-hand, and Search walks without locks, validating every node against its version counter like searchNode.
+ * Keys and values are copied in and out of the nodes, so Search and FindMin return copies. Removed nodes are reclaimed
+ * through epoch.h. Search may still compare a key that is being deleted, so memory that keys point to must outlive
+ * the searches that run while it is deleted (free it through epochRetire).
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "latch.h"
+#include "epoch.h"
+
+#if !defined(TREE_NAME) || !defined(TREE_KEY) || !defined(TREE_VALUE)
+#error "TREE_NAME, TREE_KEY and TREE_VALUE must be defined before including generic_tree.h"
+#endif
+
+#ifndef TREE_COMPARE
+#define TREE_COMPARE(a, b) (((a) > (b)) - ((a) < (b)))
+#endif
+
+#ifndef GENERIC_TREE_NAMES
+#define GENERIC_TREE_NAMES
+#define GENERIC_TREE_CONCAT_(a, b) a##b
+#define GENERIC_TREE_CONCAT(a, b) GENERIC_TREE_CONCAT_(a, b)
+
+// Number of lock-free search attempts before falling back to locking, as in binary_tree.c
+#define GENERIC_TREE_RETRIES 8
+#endif
+
+#define GT(name) GENERIC_TREE_CONCAT(TREE_NAME, name)
+#define GT_NODE GT(Node)
+
+typedef struct GT_NODE {
+    TREE_KEY key;
+    TREE_VALUE value;
+    struct GT_NODE* left;
+    struct GT_NODE* right;
+    unsigned int version; // Odd while a writer changes the node, used by the lock-free search
+    Latch lock;
+} GT_NODE;
+
+// Writers wrap every change that Search may be reading with these two, like beginWrite and endWrite of binary_tree.c
+static inline void GT(BeginWrite)(GT_NODE* node) {
+    __atomic_store_n(&node->version, node->version + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void GT(EndWrite)(GT_NODE* node) {
+    __atomic_store_n(&node->version, node->version + 1, __ATOMIC_RELEASE);
+}
+
+static inline bool GT(ReadBegin)(const GT_NODE* node, unsigned int* version) {
+    *version = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+    return *version % 2 == 0;
+}
+
+static inline bool GT(ReadValidate)(const GT_NODE* node, const unsigned int version) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&node->version, __ATOMIC_RELAXED) == version;
+}
+
+// The reclaim function of removed nodes
+static inline void GT(Reclaim)(void* object) {
+    GT_NODE* node = (GT_NODE*)object;
+
+    latchDestroy(&node->lock);
+    free(node);
+}
+
+// A removed node is changed once more, so readers that still look at it fail their validation
+static inline void GT(Retire)(GT_NODE* node) {
+    GT(BeginWrite)(node);
+    GT(EndWrite)(node);
+
+    epochRetire(node, GT(Reclaim));
+}
+
+// Create a tree of a single entry
+static inline GT_NODE* GT(Create)(const TREE_KEY key, const TREE_VALUE value) {
+    GT_NODE* node = (GT_NODE*)malloc(sizeof(GT_NODE));
+
+    node->key = key;
+    node->value = value;
+    node->left = NULL;
+    node->right = NULL;
+    node->version = 0;
+    latchInit(&node->lock);
+
+    return node;
+}
+
+// Insert an entry, locking hand-over-hand down to the empty child it goes to
+static inline GT_NODE* GT(Insert)(GT_NODE* root, const TREE_KEY key, const TREE_VALUE value) {
+    if (root == NULL) return GT(Create)(key, value);
+
+    GT_NODE* node = root;
+    latchAcquire(&node->lock);
+
+    while (true) {
+        GT_NODE** child = TREE_COMPARE(key, node->key) <= 0 ? &node->left : &node->right;
+
+        if (*child == NULL) {
+            GT_NODE* leaf = GT(Create)(key, value);
+            GT(BeginWrite)(node);
+            *child = leaf;
+            GT(EndWrite)(node);
+            break;
+        }
+
+        GT_NODE* next = *child;
+        latchAcquire(&next->lock);
+        latchRelease(&node->lock);
+        node = next;
+    }
+
+    latchRelease(&node->lock);
+    return root;
+}
+
+/*
+ * Delete one entry of a key, like deleteNode.
+ * We hold the node and its parent. A node with at most one child is replaced by the child, and a node with two children
+ * takes the entry of its successor, which is removed instead. The root node is only removed when it is the last one.
+ */
+static inline GT_NODE* GT(Delete)(GT_NODE* root, const TREE_KEY key) {
+    if (root == NULL) return NULL;
+
+    GT_NODE* node = root, *parent = NULL;
+    latchAcquire(&node->lock);
+
+    while (true) {
+        const int order = TREE_COMPARE(key, node->key);
+        if (order == 0) break;
+
+        GT_NODE* next = order < 0 ? node->left : node->right;
+
+        // The key is not in the tree
+        if (next == NULL) {
+            latchRelease(&node->lock);
+            if (parent) latchRelease(&parent->lock);
+            return root;
+        }
+
+        latchAcquire(&next->lock);
+        if (parent) latchRelease(&parent->lock);
+        parent = node;
+        node = next;
+    }
+
+    // At most one child: the child takes the place of the node
+    if (node->left == NULL || node->right == NULL) {
+        GT_NODE* child = node->left ? node->left : node->right;
+
+        if (parent) {
+            GT(BeginWrite)(parent);
+            if (parent->left == node) parent->left = child;
+            else parent->right = child;
+            GT(EndWrite)(parent);
+
+            latchRelease(&parent->lock);
+            latchRelease(&node->lock);
+            GT(Retire)(node);
+            return root;
+        }
+
+        if (child == NULL) {
+            latchRelease(&node->lock);
+            GT(Retire)(node);
+            return NULL;
+        }
+
+        // The root stays in place, so the child moves up into it
+        latchAcquire(&child->lock);
+        GT(BeginWrite)(node);
+        node->key = child->key;
+        node->value = child->value;
+        node->left = child->left;
+        node->right = child->right;
+        GT(EndWrite)(node);
+        latchRelease(&child->lock);
+        GT(Retire)(child);
+
+        latchRelease(&node->lock);
+        return root;
+    }
+
+    // Two children: find the successor, the leftmost node of the right subtree, holding it and its parent
+    if (parent) latchRelease(&parent->lock);
+
+    GT_NODE* successor = node->right, *successorParent = node;
+    latchAcquire(&successor->lock);
+    while (successor->left) {
+        GT_NODE* next = successor->left;
+        latchAcquire(&next->lock);
+        if (successorParent != node) latchRelease(&successorParent->lock);
+        successorParent = successor;
+        successor = next;
+    }
+
+    GT(BeginWrite)(successorParent);
+    if (successorParent->left == successor) successorParent->left = successor->right;
+    else successorParent->right = successor->right;
+    GT(EndWrite)(successorParent);
+
+    GT(BeginWrite)(node);
+    node->key = successor->key;
+    node->value = successor->value;
+    GT(EndWrite)(node);
+
+    latchRelease(&successor->lock);
+    if (successorParent != node) latchRelease(&successorParent->lock);
+    latchRelease(&node->lock);
+    GT(Retire)(successor);
+
+    return root;
+}
+
+/*
+ * The lock-free search of searchNode: a child is trusted only after its parent is validated again. The entry is
+ * copied out before the node is validated, so a copy torn by a writer is never returned.
+ */
+static inline bool GT(SearchOptimistic)(const GT_NODE* root, const TREE_KEY key, TREE_VALUE* value, bool* found) {
+    const GT_NODE* node = root;
+    unsigned int version;
+    if (!GT(ReadBegin)(node, &version)) return false;
+
+    while (true) {
+        const TREE_KEY nodeKey = node->key;
+        const int order = TREE_COMPARE(key, nodeKey);
+
+        if (order == 0) {
+            const TREE_VALUE nodeValue = node->value;
+            if (!GT(ReadValidate)(node, version)) return false;
+
+            if (value) *value = nodeValue;
+            *found = true;
+            return true;
+        }
+
+        const GT_NODE* child = order < 0 ? __atomic_load_n(&node->left, __ATOMIC_RELAXED)
+                                         : __atomic_load_n(&node->right, __ATOMIC_RELAXED);
+        if (!GT(ReadValidate)(node, version)) return false;
+
+        if (child == NULL) {
+            *found = false;
+            return true;
+        }
+
+        unsigned int childVersion;
+        if (!GT(ReadBegin)(child, &childVersion)) return false;
+        if (!GT(ReadValidate)(node, version)) return false;
+
+        node = child;
+        version = childVersion;
+    }
+}
+
+// The hand-over-hand search, used when the lock-free one keeps running into writers
+static inline bool GT(SearchLocked)(const GT_NODE* root, const TREE_KEY key, TREE_VALUE* value) {
+    GT_NODE* node = (GT_NODE*)root;
+    latchAcquireShared(&node->lock);
+
+    while (true) {
+        const int order = TREE_COMPARE(key, node->key);
+
+        if (order == 0) {
+            if (value) *value = node->value;
+            latchReleaseShared(&node->lock);
+            return true;
+        }
+
+        GT_NODE* next = order < 0 ? node->left : node->right;
+        if (next == NULL) {
+            latchReleaseShared(&node->lock);
+            return false;
+        }
+
+        latchAcquireShared(&next->lock);
+        latchReleaseShared(&node->lock);
+        node = next;
+    }
+}
+
+// Look up a key, and copy the value of one of its entries to 'value' if it is not NULL
+static inline bool GT(Search)(const GT_NODE* root, const TREE_KEY key, TREE_VALUE* value) {
+    if (root == NULL) return false;
+
+    epochEnter();
+    for (int attempt = 0; attempt < GENERIC_TREE_RETRIES; ++attempt) {
+        bool found = false;
+        if (GT(SearchOptimistic)(root, key, value, &found)) {
+            epochExit();
+            return found;
+        }
+    }
+    epochExit();
+
+    return GT(SearchLocked)(root, key, value);
+}
+
+// Copy the entry with the smallest key, returns false if the tree is empty. Either output may be NULL.
+static inline bool GT(FindMin)(const GT_NODE* root, TREE_KEY* key, TREE_VALUE* value) {
+    if (root == NULL) return false;
+
+    GT_NODE* node = (GT_NODE*)root;
+    latchAcquireShared(&node->lock);
+
+    while (node->left) {
+        GT_NODE* next = node->left;
+        latchAcquireShared(&next->lock);
+        latchReleaseShared(&node->lock);
+        node = next;
+    }
+
+    if (key) *key = node->key;
+    if (value) *value = node->value;
+    latchReleaseShared(&node->lock);
+
+    return true;
+}
+
+// Free every node of the tree, with an explicit stack so that deep trees do not overflow the call stack
+static inline void GT(Free)(GT_NODE* root) {
+    if (root == NULL) return;
+
+    size_t count = 0, capacity = 64;
+    GT_NODE** stack = (GT_NODE**)malloc(capacity * sizeof(GT_NODE*));
+    stack[count++] = root;
+
+    while (count > 0) {
+        GT_NODE* node = stack[--count];
+
+        if (count + 2 > capacity) {
+            capacity *= 2;
+            stack = (GT_NODE**)realloc(stack, capacity * sizeof(GT_NODE*));
+        }
+        if (node->left) stack[count++] = node->left;
+        if (node->right) stack[count++] = node->right;
+
+        GT(Reclaim)(node);
+    }
+
+    free(stack);
+}
+
+#undef GT_NODE
+#undef GT
+#undef TREE_NAME
+#undef TREE_KEY
+#undef TREE_VALUE
+#undef TREE_COMPARE
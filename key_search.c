@@ -0,0 +1,94 @@
+#include "key_search.h"
+
+#ifndef KEY_SEARCH_ISA
+typedef int (*KeySearch)(const int* keys, int count, int data);
+
+// The implementations, picked by the first call
+static int lowerBoundResolve(const int* keys, int count, int data);
+static int upperBoundResolve(const int* keys, int count, int data);
+static KeySearch lowerBoundImpl = lowerBoundResolve;
+static KeySearch upperBoundImpl = upperBoundResolve;
+static const char* isa = "scalar";
+
+// This function picks the best implementations for the CPU we run on
+static void resolve(void);
+#endif
+
+// The name of the chosen instruction set
+const char* keySearchIsa(void) {
+#ifdef KEY_SEARCH_ISA
+    return KEY_SEARCH_ISA;
+#else
+    resolve();
+    return __atomic_load_n(&isa, __ATOMIC_RELAXED);
+#endif
+}
+
+// The plain loop, stopping at the first key that is not smaller
+int keysLowerBoundScalar(const int* keys, const int count, const int data) {
+    int position = 0;
+    while (position < count && keys[position] < data) position++;
+    return position;
+}
+
+// The plain loop, stopping at the first key that is greater
+int keysUpperBoundScalar(const int* keys, const int count, const int data) {
+    int position = 0;
+    while (position < count && keys[position] <= data) position++;
+    return position;
+}
+
+#ifndef KEY_SEARCH_ISA
+
+// Count the keys smaller than the value
+int keysLowerBound(const int* keys, const int count, const int data) {
+    return __atomic_load_n(&lowerBoundImpl, __ATOMIC_RELAXED)(keys, count, data);
+}
+
+// Count the keys smaller than or equal to the value
+int keysUpperBound(const int* keys, const int count, const int data) {
+    return __atomic_load_n(&upperBoundImpl, __ATOMIC_RELAXED)(keys, count, data);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// A 32-bit x86 build may not assume SSE2, but the CPU under it almost always has it
+static void resolve(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        __atomic_store_n(&isa, "avx2", __ATOMIC_RELAXED);
+        __atomic_store_n(&lowerBoundImpl, keysLowerBoundAvx2, __ATOMIC_RELAXED);
+        __atomic_store_n(&upperBoundImpl, keysUpperBoundAvx2, __ATOMIC_RELAXED);
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        __atomic_store_n(&isa, "sse2", __ATOMIC_RELAXED);
+        __atomic_store_n(&lowerBoundImpl, keysLowerBoundSse2, __ATOMIC_RELAXED);
+        __atomic_store_n(&upperBoundImpl, keysUpperBoundSse2, __ATOMIC_RELAXED);
+    }
+    else {
+        __atomic_store_n(&lowerBoundImpl, keysLowerBoundScalar, __ATOMIC_RELAXED);
+        __atomic_store_n(&upperBoundImpl, keysUpperBoundScalar, __ATOMIC_RELAXED);
+    }
+}
+
+#else
+
+static void resolve(void) {
+    __atomic_store_n(&lowerBoundImpl, keysLowerBoundScalar, __ATOMIC_RELAXED);
+    __atomic_store_n(&upperBoundImpl, keysUpperBoundScalar, __ATOMIC_RELAXED);
+}
+
+#endif
+
+// Racing first calls all store the same pointers and name, so atomic stores are enough and no lock is needed
+static int lowerBoundResolve(const int* keys, const int count, const int data) {
+    resolve();
+    return keysLowerBound(keys, count, data);
+}
+
+static int upperBoundResolve(const int* keys, const int count, const int data) {
+    resolve();
+    return keysUpperBound(keys, count, data);
+}
+
+#endif
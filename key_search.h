@@ -0,0 +1,154 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef KEY_SEARCH_H
+#define KEY_SEARCH_H
+
+/*
+ * Searching a sorted array of keys inside a wide tree node.
+ * Instead of comparing the keys one by one, all of them are compared with the value at once, and the number of keys
+ * that pass the comparison is the position of the value. The instruction set (AVX2 or SSE2 on x86, NEON on ARM) is
+ * chosen at compile time whenever the compiler may use it, so the search is inlined into the tree code. Only builds
+ * that may not assume any of them choose once at runtime according to the CPU, or fall back to plain C.
+ *
+ * The vector versions compare a whole node of KEY_SEARCH_WIDTH keys without a loop, so 'keys' must have room for
+ * KEY_SEARCH_WIDTH keys (the tree nodes keep their keys in a fixed array of that size) and 'count' must not be larger,
+ * while only the first 'count' of them are counted.
+ */
+#define KEY_SEARCH_WIDTH 16
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// The plain C versions, always available
+int keysLowerBoundScalar(const int* keys, int count, int data);
+int keysUpperBoundScalar(const int* keys, int count, int data);
+
+// This function returns the name of the instruction set that keysLowerBound and keysUpperBound use
+const char* keySearchIsa(void);
+
+// This function returns a mask of the first 'count' keys of a node
+static inline unsigned int keySearchLanes(const int count) {
+    return (1u << count) - 1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// SSE2 compares 4 keys at once. The 4 compares are packed into one byte per key, so a single movemask takes them all.
+__attribute__((target("sse2")))
+static inline unsigned int keysPackSse2(const __m128i a, const __m128i b, const __m128i c, const __m128i d) {
+    return (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+}
+
+__attribute__((target("sse2")))
+static inline int keysLowerBoundSse2(const int* keys, const int count, const int data) {
+    const __m128i value = _mm_set1_epi32(data);
+    const unsigned int less = keysPackSse2(_mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)keys), value),
+                                           _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(keys + 4)), value),
+                                           _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(keys + 8)), value),
+                                           _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(keys + 12)), value));
+    return __builtin_popcount(less & keySearchLanes(count));
+}
+
+__attribute__((target("sse2")))
+static inline int keysUpperBoundSse2(const int* keys, const int count, const int data) {
+    const __m128i value = _mm_set1_epi32(data);
+    const unsigned int greater = keysPackSse2(_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)keys), value),
+                                              _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(keys + 4)), value),
+                                              _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(keys + 8)), value),
+                                              _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(keys + 12)), value));
+    return __builtin_popcount(~greater & keySearchLanes(count));
+}
+
+// AVX2 compares 8 keys at once, so a node takes two compares. movemask_ps takes one bit from each 32-bit lane.
+__attribute__((target("avx2")))
+static inline unsigned int keysPackAvx2(const __m256i low, const __m256i high) {
+    return (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(low))
+           | (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(high)) << 8;
+}
+
+__attribute__((target("avx2")))
+static inline int keysLowerBoundAvx2(const int* keys, const int count, const int data) {
+    const __m256i value = _mm256_set1_epi32(data);
+    const __m256i low = _mm256_loadu_si256((const __m256i*)keys);
+    const __m256i high = _mm256_loadu_si256((const __m256i*)(keys + 8));
+    const unsigned int less = keysPackAvx2(_mm256_cmpgt_epi32(value, low), _mm256_cmpgt_epi32(value, high));
+    return __builtin_popcount(less & keySearchLanes(count));
+}
+
+__attribute__((target("avx2")))
+static inline int keysUpperBoundAvx2(const int* keys, const int count, const int data) {
+    const __m256i value = _mm256_set1_epi32(data);
+    const __m256i low = _mm256_loadu_si256((const __m256i*)keys);
+    const __m256i high = _mm256_loadu_si256((const __m256i*)(keys + 8));
+    const unsigned int greater = keysPackAvx2(_mm256_cmpgt_epi32(low, value), _mm256_cmpgt_epi32(high, value));
+    return __builtin_popcount(~greater & keySearchLanes(count));
+}
+
+#elif defined(__aarch64__)
+
+// NEON is part of every AArch64 CPU. A true compare lane is all ones, so shifting it right by 31 leaves 1, and the
+// lanes past 'count' are cleared by comparing their index with it.
+static inline int keysCountNeon(const uint32x4_t a, const uint32x4_t b, const uint32x4_t c, const uint32x4_t d,
+                                const int count) {
+    const int32x4_t limit = vdupq_n_s32(count);
+    const uint32x4_t counted = vaddq_u32(
+        vaddq_u32(vshrq_n_u32(vandq_u32(a, vcltq_s32((int32x4_t){ 0, 1, 2, 3 }, limit)), 31),
+                  vshrq_n_u32(vandq_u32(b, vcltq_s32((int32x4_t){ 4, 5, 6, 7 }, limit)), 31)),
+        vaddq_u32(vshrq_n_u32(vandq_u32(c, vcltq_s32((int32x4_t){ 8, 9, 10, 11 }, limit)), 31),
+                  vshrq_n_u32(vandq_u32(d, vcltq_s32((int32x4_t){ 12, 13, 14, 15 }, limit)), 31)));
+    return (int)vaddvq_u32(counted);
+}
+
+static inline int keysLowerBoundNeon(const int* keys, const int count, const int data) {
+    const int32x4_t value = vdupq_n_s32(data);
+    return keysCountNeon(vcltq_s32(vld1q_s32(keys), value), vcltq_s32(vld1q_s32(keys + 4), value),
+                         vcltq_s32(vld1q_s32(keys + 8), value), vcltq_s32(vld1q_s32(keys + 12), value), count);
+}
+
+static inline int keysUpperBoundNeon(const int* keys, const int count, const int data) {
+    const int32x4_t value = vdupq_n_s32(data);
+    return keysCountNeon(vcleq_s32(vld1q_s32(keys), value), vcleq_s32(vld1q_s32(keys + 4), value),
+                         vcleq_s32(vld1q_s32(keys + 8), value), vcleq_s32(vld1q_s32(keys + 12), value), count);
+}
+
+#endif
+
+/*
+ * keysLowerBound returns the number of keys smaller than the value, and keysUpperBound the number of keys smaller
+ * than or equal to it. Without a compile time instruction set they are functions of key_search.c that pick one at
+ * their first call.
+ */
+#if defined(__AVX2__)
+#define KEY_SEARCH_ISA "avx2"
+#define KEY_SEARCH_KERNEL(bound) keys##bound##Avx2
+#elif defined(__SSE2__)
+#define KEY_SEARCH_ISA "sse2"
+#define KEY_SEARCH_KERNEL(bound) keys##bound##Sse2
+#elif defined(__aarch64__)
+#define KEY_SEARCH_ISA "neon"
+#define KEY_SEARCH_KERNEL(bound) keys##bound##Neon
+#endif
+
+#ifdef KEY_SEARCH_ISA
+
+static inline int keysLowerBound(const int* keys, const int count, const int data) {
+    return KEY_SEARCH_KERNEL(LowerBound)(keys, count, data);
+}
+
+static inline int keysUpperBound(const int* keys, const int count, const int data) {
+    return KEY_SEARCH_KERNEL(UpperBound)(keys, count, data);
+}
+
+#else
+
+int keysLowerBound(const int* keys, int count, int data);
+int keysUpperBound(const int* keys, int count, int data);
+
+#endif
+
+#endif //KEY_SEARCH_H
@@ -0,0 +1,54 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "latch.h"
+
+#include <sched.h>
+
+// The number of times we check a busy latch before giving the processor to another thread
+#define SPINS_BEFORE_YIELD 64
+
+// This function waits a little before the next check of a busy latch
+static inline void backoff(int* spins) {
+    if (++*spins < SPINS_BEFORE_YIELD) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+        return;
+    }
+
+    *spins = 0;
+    sched_yield();
+}
+
+// Announce that a writer waits, then take the latch once the readers are gone
+void latchRwWait(RwLatch* latch) {
+    int spins = 0;
+    while (!rwLatchTryAcquire(latch)) {
+        __atomic_fetch_or(latch, LATCH_WRITER_WAITING, __ATOMIC_RELAXED);
+        backoff(&spins);
+    }
+}
+
+// Wait until no writer holds or waits for the latch, then join the readers
+void latchRwWaitShared(RwLatch* latch) {
+    int spins = 0;
+    while (true) {
+        unsigned int state = __atomic_load_n(latch, __ATOMIC_RELAXED);
+        if ((state & (LATCH_WRITER | LATCH_WRITER_WAITING)) == 0 &&
+            __atomic_compare_exchange_n(latch, &state, state + LATCH_READER, false, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED)) {
+            return;
+        }
+        backoff(&spins);
+    }
+}
+
+#if TREE_LATCH == TREE_LATCH_SPIN
+
+// Spin until the latch looks free, then try to take it
+void latchSpinWait(Latch* latch) {
+    int spins = 0;
+    while (!latchTryAcquire(latch)) backoff(&spins);
+}
+
+#endif
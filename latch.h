@@ -0,0 +1,127 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef LATCH_H
+#define LATCH_H
+
+#include <stdbool.h>
+#include <omp.h>
+
+/*
+ * The lock embedded in every tree node. The type is chosen at compile time with -DTREE_LATCH=<kind>:
+ * TREE_LATCH_OMP  - an omp_lock_t (the default).
+ * TREE_LATCH_SPIN - a 1-byte test-and-test-and-set spinlock.
+ * TREE_LATCH_RW   - a 4-byte shared/exclusive latch, so readers of the same node do not block each other.
+ * Only the RW latch really shares: with the other two a shared acquire is an exclusive one.
+ */
+#define TREE_LATCH_OMP 0
+#define TREE_LATCH_SPIN 1
+#define TREE_LATCH_RW 2
+
+#ifndef TREE_LATCH
+#define TREE_LATCH TREE_LATCH_OMP
+#endif
+
+/*
+ * A 4-byte shared/exclusive latch that is there whatever TREE_LATCH is, for the locks that must let readers share,
+ * like the ones that guard a root pointer. It is also the node latch of TREE_LATCH_RW.
+ * Bit 0 is set while a writer holds the latch, bit 1 while a writer waits for it (new readers then stay out so writers
+ * are not starved), and the remaining bits count the readers.
+ */
+typedef unsigned int RwLatch;
+
+#define LATCH_WRITER 1u
+#define LATCH_WRITER_WAITING 2u
+#define LATCH_READER 4u
+
+// The contended paths, spinning on a plain load and yielding the processor after a while
+void latchRwWait(RwLatch* latch);
+void latchRwWaitShared(RwLatch* latch);
+
+static inline void rwLatchInit(RwLatch* latch) { *latch = 0; }
+
+static inline bool rwLatchTryAcquire(RwLatch* latch) {
+    unsigned int state = __atomic_load_n(latch, __ATOMIC_RELAXED) & LATCH_WRITER_WAITING;
+    return __atomic_compare_exchange_n(latch, &state, LATCH_WRITER, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void rwLatchAcquire(RwLatch* latch) {
+    if (!rwLatchTryAcquire(latch)) latchRwWait(latch);
+}
+
+static inline void rwLatchRelease(RwLatch* latch) { __atomic_fetch_and(latch, ~LATCH_WRITER, __ATOMIC_RELEASE); }
+
+static inline bool rwLatchTryAcquireShared(RwLatch* latch) {
+    unsigned int state = __atomic_load_n(latch, __ATOMIC_RELAXED);
+    return (state & (LATCH_WRITER | LATCH_WRITER_WAITING)) == 0 &&
+           __atomic_compare_exchange_n(latch, &state, state + LATCH_READER, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void rwLatchAcquireShared(RwLatch* latch) {
+    if (!rwLatchTryAcquireShared(latch)) latchRwWaitShared(latch);
+}
+
+static inline void rwLatchReleaseShared(RwLatch* latch) { __atomic_fetch_sub(latch, LATCH_READER, __ATOMIC_RELEASE); }
+
+#if TREE_LATCH == TREE_LATCH_OMP
+
+typedef omp_lock_t Latch;
+
+// Whether latchDestroy has to be called before the memory of a latch is reused
+#define LATCH_NEEDS_DESTROY 1
+
+static inline void latchInit(Latch* latch) { omp_init_lock(latch); }
+static inline void latchDestroy(Latch* latch) { omp_destroy_lock(latch); }
+static inline void latchAcquire(Latch* latch) { omp_set_lock(latch); }
+static inline bool latchTryAcquire(Latch* latch) { return omp_test_lock(latch); }
+static inline void latchRelease(Latch* latch) { omp_unset_lock(latch); }
+static inline bool latchTryAcquireShared(Latch* latch) { return omp_test_lock(latch); }
+static inline void latchAcquireShared(Latch* latch) { omp_set_lock(latch); }
+static inline void latchReleaseShared(Latch* latch) { omp_unset_lock(latch); }
+
+#elif TREE_LATCH == TREE_LATCH_SPIN
+
+typedef unsigned char Latch;
+
+#define LATCH_NEEDS_DESTROY 0
+
+// The contended path, spinning on a plain load and yielding the processor after a while
+void latchSpinWait(Latch* latch);
+
+static inline void latchInit(Latch* latch) { *latch = 0; }
+static inline void latchDestroy(Latch* latch) { (void)latch; }
+
+static inline bool latchTryAcquire(Latch* latch) {
+    return __atomic_load_n(latch, __ATOMIC_RELAXED) == 0 && __atomic_exchange_n(latch, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+static inline void latchAcquire(Latch* latch) {
+    if (!latchTryAcquire(latch)) latchSpinWait(latch);
+}
+
+static inline void latchRelease(Latch* latch) { __atomic_store_n(latch, 0, __ATOMIC_RELEASE); }
+static inline bool latchTryAcquireShared(Latch* latch) { return latchTryAcquire(latch); }
+static inline void latchAcquireShared(Latch* latch) { latchAcquire(latch); }
+static inline void latchReleaseShared(Latch* latch) { latchRelease(latch); }
+
+#elif TREE_LATCH == TREE_LATCH_RW
+
+typedef RwLatch Latch;
+
+#define LATCH_NEEDS_DESTROY 0
+
+static inline void latchInit(Latch* latch) { rwLatchInit(latch); }
+static inline void latchDestroy(Latch* latch) { (void)latch; }
+static inline bool latchTryAcquire(Latch* latch) { return rwLatchTryAcquire(latch); }
+static inline void latchAcquire(Latch* latch) { rwLatchAcquire(latch); }
+static inline void latchRelease(Latch* latch) { rwLatchRelease(latch); }
+static inline bool latchTryAcquireShared(Latch* latch) { return rwLatchTryAcquireShared(latch); }
+static inline void latchAcquireShared(Latch* latch) { rwLatchAcquireShared(latch); }
+static inline void latchReleaseShared(Latch* latch) { rwLatchReleaseShared(latch); }
+
+#else
+#error "TREE_LATCH must be TREE_LATCH_OMP, TREE_LATCH_SPIN or TREE_LATCH_RW"
+#endif
+
+#endif //LATCH_H
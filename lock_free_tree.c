@@ -0,0 +1,344 @@
+#include "lock_free_tree.h"
+#include "epoch.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Edges are node pointers with two marks in their low bits. A flagged edge leads to a leaf that is being deleted, a
+ * tagged edge leads to a node whose parent is being removed. A marked edge never changes again.
+ */
+#define EDGE_FLAG ((uintptr_t)1)
+#define EDGE_TAG ((uintptr_t)2)
+#define EDGE_MARKS (EDGE_FLAG | EDGE_TAG)
+
+// The keys of the sentinel leaves, greater than every int so that the real values always stay to their left
+#define SENTINEL_0 ((long long)INT_MAX + 1)
+#define SENTINEL_1 ((long long)INT_MAX + 2)
+#define SENTINEL_2 ((long long)INT_MAX + 3)
+
+/*
+ * A node of the tree. An inner node routes values smaller than its key to the left and the rest to the right, and
+ * always has two children. A leaf has no children and never changes: it holds a value and its number of copies.
+ */
+typedef struct LockFreeNode {
+    long long key;
+    unsigned int copies;
+    uintptr_t left;
+    uintptr_t right;
+} LockFreeNode;
+
+/*
+ * The root is an inner node with the key SENTINEL_2, whose left child is an inner node with the key SENTINEL_1.
+ * Neither of them is ever removed, so every seek starts below them.
+ */
+struct LockFreeTree {
+    LockFreeNode* root;
+};
+
+/*
+ * The result of a seek: the leaf where the value is or would be, its parent, and the last edge above them that is
+ * not tagged (from 'ancestor' to 'successor'). A cleanup swings that edge over everything between them.
+ */
+typedef struct SeekRecord {
+    LockFreeNode* ancestor;
+    LockFreeNode* successor;
+    LockFreeNode* parent;
+    LockFreeNode* leaf;
+} SeekRecord;
+
+// These functions create a leaf, and an inner node over two existing nodes
+static LockFreeNode* newLeaf(long long key, unsigned int copies);
+static LockFreeNode* newInner(long long key, LockFreeNode* left, LockFreeNode* right);
+
+// This function returns the node of an edge, without its marks
+static inline LockFreeNode* edgeNode(uintptr_t edge);
+
+// This function returns the edge of a node that a value follows
+static inline uintptr_t* edgeFor(LockFreeNode* node, long long key);
+
+// This function walks from the root to the leaf of a value
+static void seek(const LockFreeTree* tree, long long key, SeekRecord* record);
+
+// This function finishes the delete in progress at the parent of a seek, returns false if another thread did it
+static bool cleanup(long long key, const SeekRecord* record);
+
+// This function retires the nodes a cleanup cut off, between the successor and the parent of a seek
+static void retireRemoved(const SeekRecord* record, long long key, const LockFreeNode* kept);
+
+// Create a new tree made of the sentinels only
+LockFreeTree* lockFreeCreate(void) {
+    LockFreeTree* tree = (LockFreeTree*)malloc(sizeof(LockFreeTree));
+
+    LockFreeNode* sentinels = newInner(SENTINEL_1, newLeaf(SENTINEL_0, 1), newLeaf(SENTINEL_1, 1));
+    tree->root = newInner(SENTINEL_2, sentinels, newLeaf(SENTINEL_2, 1));
+
+    return tree;
+}
+
+/*
+ * This function inserts a value to the tree.
+ * The edge from the parent to the leaf is swung with a CAS: to a new leaf with one more copy if the value is already
+ * there, or otherwise to a new inner node that holds the old leaf and a new one. The CAS fails if the edge got marked
+ * in the meantime, and then we help the delete that marked it before we retry.
+ */
+void lockFreeInsert(LockFreeTree* tree, const int data) {
+    const long long key = data;
+    SeekRecord record;
+
+    epochEnter();
+    while (true) {
+        seek(tree, key, &record);
+        LockFreeNode* leaf = record.leaf;
+
+        LockFreeNode* added = NULL, *replacement;
+        if (leaf->key == key) {
+            replacement = newLeaf(key, leaf->copies + 1);
+        }
+        else {
+            added = newLeaf(key, 1);
+            replacement = key < leaf->key ? newInner(leaf->key, added, leaf) : newInner(key, leaf, added);
+        }
+
+        uintptr_t expected = (uintptr_t)leaf;
+        if (__atomic_compare_exchange_n(edgeFor(record.parent, key), &expected, (uintptr_t)replacement, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            if (added == NULL) epochRetire(leaf, free);
+            break;
+        }
+
+        // Nobody saw the new nodes, so they go right away
+        free(replacement);
+        free(added);
+
+        if (edgeNode(expected) == leaf && (expected & EDGE_MARKS)) cleanup(key, &record);
+    }
+    epochExit();
+}
+
+/*
+ * This function deletes one copy of a value.
+ * While there are more copies we replace the leaf like an insert does. The last copy is deleted in two phases: we
+ * flag the edge to the leaf (from here on the delete can no longer fail, and any thread may finish it), and then
+ * cleanup removes the leaf and its parent. If cleanup fails, the leaf is either gone already or we seek again and
+ * retry.
+ */
+bool lockFreeDelete(LockFreeTree* tree, const int data) {
+    const long long key = data;
+    SeekRecord record;
+    LockFreeNode* leaf = NULL;
+    bool isFlagged = false, isDeleted = false;
+
+    epochEnter();
+    while (true) {
+        seek(tree, key, &record);
+
+        // Our leaf was flagged before, we only have to make sure it is removed
+        if (isFlagged) {
+            isDeleted = record.leaf != leaf || cleanup(key, &record);
+            if (isDeleted) break;
+            continue;
+        }
+
+        leaf = record.leaf;
+        if (leaf->key != key) break;
+
+        uintptr_t* edge = edgeFor(record.parent, key);
+        uintptr_t expected = (uintptr_t)leaf;
+
+        if (leaf->copies > 1) {
+            LockFreeNode* replacement = newLeaf(key, leaf->copies - 1);
+            if (__atomic_compare_exchange_n(edge, &expected, (uintptr_t)replacement, false, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE)) {
+                epochRetire(leaf, free);
+                isDeleted = true;
+                break;
+            }
+            free(replacement);
+        }
+        else if (__atomic_compare_exchange_n(edge, &expected, expected | EDGE_FLAG, false, __ATOMIC_ACQ_REL,
+                                             __ATOMIC_ACQUIRE)) {
+            isFlagged = true;
+            isDeleted = cleanup(key, &record);
+            if (isDeleted) break;
+            continue;
+        }
+
+        if (edgeNode(expected) == leaf && (expected & EDGE_MARKS)) cleanup(key, &record);
+    }
+    epochExit();
+
+    return isDeleted;
+}
+
+// Walk down to the leaf of the value. Leaves are never changed, so finding the value there is enough.
+bool lockFreeSearch(const LockFreeTree* tree, const int data) {
+    const long long key = data;
+
+    epochEnter();
+    LockFreeNode* node = tree->root;
+    while (node->left) node = edgeNode(__atomic_load_n(edgeFor(node, key), __ATOMIC_ACQUIRE));
+
+    const bool isFound = node->key == key;
+    epochExit();
+
+    return isFound;
+}
+
+// The leftmost leaf holds the minimal value, unless it is the first sentinel
+bool lockFreeFindMin(const LockFreeTree* tree, int* min) {
+    epochEnter();
+    LockFreeNode* node = tree->root;
+    while (node->left) node = edgeNode(__atomic_load_n(&node->left, __ATOMIC_ACQUIRE));
+
+    const bool isFound = node->key < SENTINEL_0;
+    if (isFound) *min = (int)node->key;
+    epochExit();
+
+    return isFound;
+}
+
+// Free every node that is still in the tree. The nodes that were removed are reclaimed by the epochs.
+void lockFreeFree(LockFreeTree* tree) {
+    if (tree == NULL) return;
+
+    size_t count = 0, capacity = 64;
+    LockFreeNode** stack = (LockFreeNode**)malloc(capacity * sizeof(LockFreeNode*));
+    stack[count++] = tree->root;
+
+    while (count > 0) {
+        LockFreeNode* node = stack[--count];
+        if (node->left) {
+            if (count + 2 > capacity) {
+                capacity *= 2;
+                stack = (LockFreeNode**)realloc(stack, capacity * sizeof(LockFreeNode*));
+            }
+            stack[count++] = edgeNode(node->left);
+            stack[count++] = edgeNode(node->right);
+        }
+        free(node);
+    }
+
+    free(stack);
+    free(tree);
+}
+
+// Create a leaf. It is published only by a CAS with release order, so plain stores are enough.
+static LockFreeNode* newLeaf(const long long key, const unsigned int copies) {
+    LockFreeNode* node = (LockFreeNode*)malloc(sizeof(LockFreeNode));
+    node->key = key;
+    node->copies = copies;
+    node->left = 0;
+    node->right = 0;
+
+    return node;
+}
+
+// Create an inner node with clean edges to its children
+static LockFreeNode* newInner(const long long key, LockFreeNode* left, LockFreeNode* right) {
+    LockFreeNode* node = (LockFreeNode*)malloc(sizeof(LockFreeNode));
+    node->key = key;
+    node->copies = 0;
+    node->left = (uintptr_t)left;
+    node->right = (uintptr_t)right;
+
+    return node;
+}
+
+// Nodes come from malloc, so the two low bits of their address are always free for the marks
+static inline LockFreeNode* edgeNode(const uintptr_t edge) {
+    return (LockFreeNode*)(edge & ~EDGE_MARKS);
+}
+
+// Smaller values go left
+static inline uintptr_t* edgeFor(LockFreeNode* node, const long long key) {
+    return key < node->key ? &node->left : &node->right;
+}
+
+/*
+ * Walk from the root to a leaf, remembering the last untagged edge on the way.
+ * Every real value is smaller than the keys of the two top inner nodes and of the node right below them (which holds
+ * SENTINEL_0 or is its leaf), so the walk starts by going left three times.
+ */
+static void seek(const LockFreeTree* tree, const long long key, SeekRecord* record) {
+    LockFreeNode* top = edgeNode(__atomic_load_n(&tree->root->left, __ATOMIC_ACQUIRE));
+
+    record->ancestor = tree->root;
+    record->successor = top;
+    record->parent = top;
+
+    uintptr_t parentEdge = __atomic_load_n(&top->left, __ATOMIC_ACQUIRE);
+    record->leaf = edgeNode(parentEdge);
+
+    uintptr_t currentEdge = __atomic_load_n(&record->leaf->left, __ATOMIC_ACQUIRE);
+    LockFreeNode* current = edgeNode(currentEdge);
+
+    while (current) {
+        if (!(parentEdge & EDGE_TAG)) {
+            record->ancestor = record->parent;
+            record->successor = record->leaf;
+        }
+
+        record->parent = record->leaf;
+        record->leaf = current;
+
+        parentEdge = currentEdge;
+        currentEdge = __atomic_load_n(edgeFor(current, key), __ATOMIC_ACQUIRE);
+        current = edgeNode(currentEdge);
+    }
+}
+
+/*
+ * Remove a flagged leaf together with its parent.
+ * The parent has one flagged edge, the leaf that goes, and the other edge stays. If our side is not the flagged one,
+ * the delete in progress is of our sibling, and our side is the one that stays. We tag the edge that stays so it can
+ * no longer change, and then swing the edge above the successor to its node, keeping its flag in case it leads to
+ * another leaf that is being deleted. One CAS removes the leaf, the parent, and every node that was tagged between
+ * the successor and the parent.
+ */
+static bool cleanup(const long long key, const SeekRecord* record) {
+    LockFreeNode* parent = record->parent;
+    uintptr_t* successorEdge = edgeFor(record->ancestor, key);
+
+    uintptr_t* childEdge = key < parent->key ? &parent->left : &parent->right;
+    uintptr_t* siblingEdge = key < parent->key ? &parent->right : &parent->left;
+    if (!(__atomic_load_n(childEdge, __ATOMIC_ACQUIRE) & EDGE_FLAG)) siblingEdge = childEdge;
+
+    const uintptr_t sibling = __atomic_or_fetch(siblingEdge, EDGE_TAG, __ATOMIC_ACQ_REL);
+
+    uintptr_t expected = (uintptr_t)record->successor;
+    if (!__atomic_compare_exchange_n(successorEdge, &expected, sibling & ~EDGE_TAG, false, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    retireRemoved(record, key, edgeNode(sibling));
+    return true;
+}
+
+/*
+ * The removed part is a chain of inner nodes from the successor down to the parent, along the path of the value.
+ * Every edge on the chain is tagged, which means the other child of each node is a flagged leaf that goes with it.
+ * At the parent the child that goes is the one that was not moved up. All of these edges are marked, so they cannot
+ * change while we walk them.
+ */
+static void retireRemoved(const SeekRecord* record, const long long key, const LockFreeNode* kept) {
+    LockFreeNode* node = record->successor;
+
+    while (true) {
+        LockFreeNode* left = edgeNode(__atomic_load_n(&node->left, __ATOMIC_ACQUIRE));
+        LockFreeNode* right = edgeNode(__atomic_load_n(&node->right, __ATOMIC_ACQUIRE));
+
+        if (node == record->parent) {
+            epochRetire(left == kept ? right : left, free);
+            epochRetire(node, free);
+            return;
+        }
+
+        LockFreeNode* next = key < node->key ? left : right;
+        epochRetire(next == left ? right : left, free);
+        epochRetire(node, free);
+        node = next;
+    }
+}
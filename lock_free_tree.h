@@ -0,0 +1,40 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef LOCK_FREE_TREE_H
+#define LOCK_FREE_TREE_H
+
+#include <stdbool.h>
+
+/*
+ * A lock-free binary search tree (Natarajan and Mittal, "Fast Concurrent Lock-Free Binary Search Trees").
+ * It has the same contract as the locked tree: duplicates are allowed, and every delete removes one copy of a value.
+ *
+ * The tree is external: values live in the leaves and inner nodes only route. A delete marks the edge to its leaf
+ * (flag), freezes the edge to the sibling (tag) and then swings a single edge of an ancestor over the whole removed
+ * part with one CAS. Any thread that runs into a marked edge finishes that delete before going on, so no thread ever
+ * waits for another one. Copies of a value share a leaf with a counter, which is changed by replacing the leaf.
+ * Searches never write. Removed nodes are reclaimed through epoch.h.
+ */
+typedef struct LockFreeTree LockFreeTree;
+
+// This function creates a new empty tree
+LockFreeTree* lockFreeCreate(void);
+
+// This function inserts a value to the tree
+void lockFreeInsert(LockFreeTree* tree, const int data);
+
+// This function deletes one copy of a value from the tree, returns false if the value is not in the tree
+bool lockFreeDelete(LockFreeTree* tree, const int data);
+
+// This function checks whether a value exists in the tree
+bool lockFreeSearch(const LockFreeTree* tree, const int data);
+
+// This function finds the minimal value in the tree, returns false if the tree is empty
+bool lockFreeFindMin(const LockFreeTree* tree, int* min);
+
+// This function frees the tree. No other thread may use it anymore.
+void lockFreeFree(LockFreeTree* tree);
+
+#endif //LOCK_FREE_TREE_H
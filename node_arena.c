@@ -0,0 +1,205 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "node_arena.h"
+#include "epoch.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// The size and alignment of a slab. It must be a power of two.
+#define SLAB_SIZE (64 * 1024)
+
+// The number of free lists in an arena. Each thread takes a slot number the first time it uses an arena, and the
+// threads beyond the first ARENA_FREE_LISTS share lists with earlier ones.
+#define ARENA_FREE_LISTS 16
+
+// Arenas with at least this many slabs are released in parallel
+#define ARENA_PARALLEL_RELEASE 64
+
+// A slab starts with this header and continues with as many nodes as fit in it
+typedef struct Slab {
+    NodeArena* arena;
+    struct Slab* next;
+    size_t used;
+    TreeNode nodes[];
+} Slab;
+
+#define NODES_PER_SLAB ((SLAB_SIZE - sizeof(Slab)) / sizeof(TreeNode))
+
+// A free list, padded so that two threads never share a cache line
+typedef struct FreeList {
+    omp_lock_t lock;
+    TreeNode* head;
+    char padding[64];
+} FreeList;
+
+struct NodeArena {
+    omp_lock_t lock; // Protects the slabs list and the bump allocation
+    unsigned long references; // One for the tree, and one for every retired node that was not reclaimed yet
+    Slab* slabs;
+    FreeList free_lists[ARENA_FREE_LISTS];
+};
+
+// The free list slot of the calling thread, -1 until it first needs one. It is kept per thread rather than taken from
+// omp_get_thread_num, which repeats across teams and nesting levels.
+static int freeListSlot = -1;
+#pragma omp threadprivate(freeListSlot)
+static unsigned int nextFreeListSlot = 0;
+
+// This function returns the free list of the calling thread
+static inline FreeList* threadFreeList(NodeArena* arena);
+
+// This function takes a node out of a free list, returns NULL if it is empty (or busy, when 'wait' is false)
+static TreeNode* popFreeList(FreeList* list, bool wait);
+
+// This function returns a retired node to its arena, once the epoch says it is safe
+static void reclaimNode(void* node);
+
+// This function drops a reference to an arena, and frees it with the last one
+static void arenaUnref(NodeArena* arena);
+static void arenaDestroy(NodeArena* arena);
+
+// Create a new empty arena
+NodeArena* arenaCreate(void) {
+    NodeArena* arena = (NodeArena*)malloc(sizeof(NodeArena));
+    omp_init_lock(&arena->lock);
+    arena->references = 1;
+    arena->slabs = NULL;
+
+    for (int i = 0; i < ARENA_FREE_LISTS; ++i) {
+        omp_init_lock(&arena->free_lists[i].lock);
+        arena->free_lists[i].head = NULL;
+    }
+
+    return arena;
+}
+
+/*
+ * This function allocates a node.
+ * We first reuse a node from our own free list, then try to take one from the lists of other threads (so memory
+ * freed by one thread is reused by another), and only then carve a new node out of the newest slab. Running out of
+ * memory for a slab aborts, like the node pool of compact_tree.c.
+ */
+TreeNode* arenaAlloc(NodeArena* arena) {
+
+    FreeList* own = threadFreeList(arena);
+    TreeNode* node = popFreeList(own, true);
+    if (node) return node;
+
+    for (int i = 0; i < ARENA_FREE_LISTS && node == NULL; ++i) {
+        if (&arena->free_lists[i] != own) node = popFreeList(&arena->free_lists[i], false);
+    }
+    if (node) return node;
+
+    omp_set_lock(&arena->lock);
+
+    Slab* slab = arena->slabs;
+    if (slab == NULL || slab->used == NODES_PER_SLAB) {
+        void* memory = NULL;
+        if (posix_memalign(&memory, SLAB_SIZE, SLAB_SIZE) != 0) abort();
+
+        slab = (Slab*)memory;
+        slab->arena = arena;
+        slab->next = arena->slabs;
+        slab->used = 0;
+        arena->slabs = slab;
+    }
+
+    node = &slab->nodes[slab->used++];
+    omp_unset_lock(&arena->lock);
+
+    node->version = 0;
+    latchInit(&node->lock);
+
+    return node;
+}
+
+// Return a node to the free list of the calling thread, linked through its 'left' pointer
+void arenaFree(TreeNode* node) {
+    FreeList* list = threadFreeList(arenaOf(node));
+
+    omp_set_lock(&list->lock);
+    node->left = list->head;
+    list->head = node;
+    omp_unset_lock(&list->lock);
+}
+
+// Find the arena of a node from the header of its slab
+NodeArena* arenaOf(const TreeNode* node) {
+    const Slab* slab = (const Slab*)((uintptr_t)node & ~(uintptr_t)(SLAB_SIZE - 1));
+    return slab->arena;
+}
+
+// Retire a node, holding a reference to its arena until the node is reclaimed
+void arenaRetire(TreeNode* node) {
+    __atomic_add_fetch(&arenaOf(node)->references, 1, __ATOMIC_RELAXED);
+    epochRetire(node, reclaimNode);
+}
+
+// Release the reference of the tree, and reclaim the retired nodes that no reader can see anymore, so that the arena
+// goes now rather than whenever their threads retire again
+void arenaRelease(NodeArena* arena) {
+    arenaUnref(arena);
+    epochCollect();
+}
+
+// The first ARENA_FREE_LISTS threads get lists of their own. Later threads share them, which the list locks make safe.
+static inline FreeList* threadFreeList(NodeArena* arena) {
+    if (freeListSlot < 0) {
+        freeListSlot = (int)(__atomic_fetch_add(&nextFreeListSlot, 1, __ATOMIC_RELAXED) % ARENA_FREE_LISTS);
+    }
+    return &arena->free_lists[freeListSlot];
+}
+
+// Pop the head of a free list
+static TreeNode* popFreeList(FreeList* list, const bool wait) {
+    if (wait) omp_set_lock(&list->lock);
+    else if (!omp_test_lock(&list->lock)) return NULL;
+
+    TreeNode* node = list->head;
+    if (node) list->head = node->left;
+
+    omp_unset_lock(&list->lock);
+    return node;
+}
+
+// Return the node to the free list of the reclaiming thread, and let go of its arena
+static void reclaimNode(void* node) {
+    NodeArena* arena = arenaOf((TreeNode*)node);
+
+    arenaFree((TreeNode*)node);
+    arenaUnref(arena);
+}
+
+// The reference count is only touched atomically, and whoever drops it to zero is the last user of the arena
+static void arenaUnref(NodeArena* arena) {
+    if (__atomic_sub_fetch(&arena->references, 1, __ATOMIC_ACQ_REL) == 0) arenaDestroy(arena);
+}
+
+/*
+ * Free all the slabs of the arena. Every node that was ever handed out still has an initialized lock.
+ * Large arenas are released by all the threads, each one taking slabs from the list.
+ */
+static void arenaDestroy(NodeArena* arena) {
+    size_t count = 0;
+    for (Slab* slab = arena->slabs; slab; slab = slab->next) count++;
+
+    if (count > 0) {
+        Slab** slabs = (Slab**)malloc(count * sizeof(Slab*));
+        count = 0;
+        for (Slab* slab = arena->slabs; slab; slab = slab->next) slabs[count++] = slab;
+
+        #pragma omp parallel for schedule(dynamic, 16) if(count >= ARENA_PARALLEL_RELEASE)
+        for (size_t i = 0; i < count; ++i) {
+            if (LATCH_NEEDS_DESTROY) {
+                for (size_t j = 0; j < slabs[i]->used; ++j) latchDestroy(&slabs[i]->nodes[j].lock);
+            }
+            free(slabs[i]);
+        }
+        free(slabs);
+    }
+
+    for (int i = 0; i < ARENA_FREE_LISTS; ++i) omp_destroy_lock(&arena->free_lists[i].lock);
+    omp_destroy_lock(&arena->lock);
+    free(arena);
+}
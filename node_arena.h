@@ -0,0 +1,46 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include "binary_tree.h"
+
+/*
+ * Every tree owns an arena that hands out its nodes.
+ * Nodes live in large aligned slabs, so the arena of a node is found by masking its address, and the nodes of a tree
+ * end up next to each other in memory. Freed nodes go to a free list of the calling thread and are reused by later
+ * allocations; their memory is returned to the system only when the whole arena is released.
+ */
+typedef struct NodeArena NodeArena;
+
+// This function creates a new empty arena
+NodeArena* arenaCreate(void);
+
+/*
+ * This function returns a node from the arena. Its latch is initialized and unlocked, its version is even, and the
+ * rest of its fields must be set by the caller. It never returns NULL: it aborts if there is no memory for a new slab.
+ */
+TreeNode* arenaAlloc(NodeArena* arena);
+
+// This function returns a node to the arena it came from. The node must be unlocked.
+void arenaFree(TreeNode* node);
+
+/*
+ * This function returns an unreachable node to its arena once no lock-free reader can still see it (see epoch.h).
+ * Until then the node keeps the arena alive, even if the arena is released.
+ */
+void arenaRetire(TreeNode* node);
+
+// This function returns the arena a node came from
+NodeArena* arenaOf(const TreeNode* node);
+
+/*
+ * This function releases every node of the arena at once, together with the arena itself, in parallel when it is
+ * large. If some of its nodes were retired and not yet reclaimed, the last of them to be reclaimed does it instead.
+ * It reclaims them through epochCollect on its way out, so that happens right away unless a reader is inside an epoch.
+ */
+void arenaRelease(NodeArena* arena);
+
+#endif //NODE_ARENA_H
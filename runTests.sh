@@ -4,6 +4,9 @@ OUTPUT_FILE="test_results.txt"
 
 make clean && make || exit 1
 
+# The counters of tree_stats.h only count in their own build
+make test-stats || exit 1
+
 echo "Running 100 iterations. Please wait..."
 
 (
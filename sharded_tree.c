@@ -0,0 +1,385 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "sharded_tree.h"
+#include "latch.h"
+#include "epoch.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Shards are aligned to cache lines, so threads that work on different shards never share a line
+#define SHARD_ALIGN 64
+
+// A thread counts one in this many of its operations, for all of them at once, so most operations don't write it
+#define SHARD_SAMPLE_PERIOD 32
+
+/*
+ * A shard holds the values in [lo, hi). The bounds only change under its exclusive latch.
+ * 'size' never counts more values than the shard holds: inserts add to it after they insert, and deletes take from
+ * it before they delete. 'operations' counts the sampled operations since the last rebalance.
+ */
+typedef struct __attribute__((aligned(SHARD_ALIGN))) Shard {
+    RwLatch lock;
+    TreeNode* root;
+    long long lo;
+    long long hi;
+    size_t size;
+    size_t operations;
+} Shard;
+
+// The latch of the tree lets only one rebalance run at a time
+struct ShardedTree {
+    ShardMode mode;
+    size_t count;
+    Latch lock;
+    Shard* shards;
+};
+
+// The context of shardedRangeScan, which forwards the values of every shard to the caller's callback
+typedef struct ShardScan {
+    ScanCallback callback;
+    void* context;
+    bool isStopped;
+} ShardScan;
+
+// This function returns the shard a value should be in, by the bounds we see right now
+static size_t route(const ShardedTree* tree, int data);
+
+// This function latches the shard of a value in the given mode, retrying if a rebalance moved the value away
+static Shard* latchShard(ShardedTree* tree, int data, bool exclusive);
+
+// This function takes one value off the size of a shard if at least one more stays, so a delete cannot empty it
+static bool reserveDelete(Shard* shard);
+
+// This function counts an operation on a shard for shardedRebalance
+static void countOperation(const ShardedTree* tree, Shard* shard);
+
+// This function moves about half of the values of a latched shard to a latched neighbour, returns false if it can't
+static bool moveValues(Shard* hot, Shard* neighbour, bool isRight);
+
+// This function passes a value to the caller's callback, and remembers if it asked to stop
+static bool forwardValue(int data, void* context);
+
+// The operations of the calling thread since it last counted a sample
+static unsigned int operationTicks;
+#pragma omp threadprivate(operationTicks)
+
+// Create a tree of empty shards. Range shards split the int range in equal parts.
+ShardedTree* shardedCreate(size_t shards, const ShardMode mode) {
+    if (shards == 0) shards = 1;
+
+    ShardedTree* tree = (ShardedTree*)malloc(sizeof(ShardedTree));
+    tree->mode = mode;
+    tree->count = shards;
+    latchInit(&tree->lock);
+
+    void* memory = NULL;
+    if (posix_memalign(&memory, SHARD_ALIGN, shards * sizeof(Shard)) != 0) {
+        free(tree);
+        return NULL;
+    }
+    tree->shards = (Shard*)memory;
+
+    const unsigned long long span = 1ULL << 32;
+    for (size_t i = 0; i < shards; ++i) {
+        Shard* shard = &tree->shards[i];
+        rwLatchInit(&shard->lock);
+        shard->root = NULL;
+        shard->size = 0;
+        shard->operations = 0;
+        shard->lo = mode == SHARD_BY_RANGE ? INT_MIN + (long long)(i * span / shards) : INT_MIN;
+        shard->hi = mode == SHARD_BY_RANGE ? INT_MIN + (long long)((i + 1) * span / shards) : (long long)INT_MAX + 1;
+    }
+
+    return tree;
+}
+
+/*
+ * This function inserts a value to its shard.
+ * The root of a shard only changes under its exclusive latch, so while we hold it shared a shard that has a root keeps
+ * it. Only an empty shard needs the exclusive latch, to get its first node.
+ */
+void shardedInsert(ShardedTree* tree, const int data) {
+    Shard* shard = latchShard(tree, data, false);
+
+    if (shard->root != NULL) {
+        insertNode(shard->root, data);
+        __atomic_add_fetch(&shard->size, 1, __ATOMIC_RELEASE);
+        rwLatchReleaseShared(&shard->lock);
+    }
+    else {
+        rwLatchReleaseShared(&shard->lock);
+        shard = latchShard(tree, data, true);
+
+        shard->root = insertNode(shard->root, data);
+        shard->size++;
+        rwLatchRelease(&shard->lock);
+    }
+
+    countOperation(tree, shard);
+}
+
+/*
+ * This function deletes one copy of a value from its shard.
+ * deleteNode frees the root only when it deletes the last value, so as long as the reserved size keeps one value in
+ * the shard, the delete can run with the shared latch. Otherwise it may empty the shard and needs the exclusive one.
+ */
+bool shardedDelete(ShardedTree* tree, const int data) {
+    Shard* shard = latchShard(tree, data, false);
+    bool isDeleted = false;
+
+    if (reserveDelete(shard)) {
+        deleteNodeChecked(shard->root, data, &isDeleted);
+        if (!isDeleted) __atomic_add_fetch(&shard->size, 1, __ATOMIC_RELEASE);
+        rwLatchReleaseShared(&shard->lock);
+    }
+    else {
+        rwLatchReleaseShared(&shard->lock);
+        shard = latchShard(tree, data, true);
+
+        shard->root = deleteNodeChecked(shard->root, data, &isDeleted);
+        if (isDeleted) shard->size--;
+        rwLatchRelease(&shard->lock);
+    }
+
+    countOperation(tree, shard);
+    return isDeleted;
+}
+
+// Search the shard of the value
+bool shardedSearch(ShardedTree* tree, const int data) {
+    Shard* shard = latchShard(tree, data, false);
+    const bool isFound = searchNode(shard->root, data);
+    rwLatchReleaseShared(&shard->lock);
+
+    countOperation(tree, shard);
+    return isFound;
+}
+
+/*
+ * With range shards the minimum is in the first shard that is not empty. With hash shards we have to look at all of
+ * them. findMin returns an unlatched node, so we read it inside an epoch.
+ */
+bool shardedFindMin(ShardedTree* tree, int* min) {
+    bool isFound = false;
+
+    for (size_t i = 0; i < tree->count; ++i) {
+        Shard* shard = &tree->shards[i];
+
+        rwLatchAcquireShared(&shard->lock);
+        epochEnter();
+        const TreeNode* node = findMin(shard->root);
+        if (node && (!isFound || node->data < *min)) {
+            *min = node->data;
+            isFound = true;
+        }
+        epochExit();
+        rwLatchReleaseShared(&shard->lock);
+
+        if (isFound && tree->mode == SHARD_BY_RANGE) break;
+    }
+
+    return isFound;
+}
+
+// Count the values of every shard
+size_t shardedCount(ShardedTree* tree) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < tree->count; ++i) {
+        Shard* shard = &tree->shards[i];
+
+        rwLatchAcquireShared(&shard->lock);
+        count += treeCount(shard->root);
+        rwLatchReleaseShared(&shard->lock);
+    }
+
+    return count;
+}
+
+// Scan the shards one after the other, skipping range shards that can't hold values in [lo, hi]
+size_t shardedRangeScan(ShardedTree* tree, const int lo, const int hi, const ScanCallback callback, void* context) {
+    ShardScan scan = { callback, context, false };
+    size_t count = 0;
+
+    for (size_t i = 0; i < tree->count && !scan.isStopped; ++i) {
+        Shard* shard = &tree->shards[i];
+
+        rwLatchAcquireShared(&shard->lock);
+        if (shard->lo <= hi && shard->hi > lo) count += rangeScan(shard->root, lo, hi, forwardValue, &scan);
+        rwLatchReleaseShared(&shard->lock);
+    }
+
+    return count;
+}
+
+/*
+ * This function moves values away from the busiest shard.
+ * The operation counters start over on every call, so a shard is hot if most of the recent operations went to it. It
+ * gives half of its values to the neighbour that got fewer operations, which takes the matching part of its range.
+ * Both shards are latched exclusively while the values move, lower index first.
+ */
+bool shardedRebalance(ShardedTree* tree) {
+    if (tree->mode != SHARD_BY_RANGE || tree->count < 2) return false;
+    if (!latchTryAcquire(&tree->lock)) return false;
+
+    size_t* operations = (size_t*)malloc(tree->count * sizeof(size_t));
+    size_t hot = 0, hottest = 0, total = 0;
+    for (size_t i = 0; i < tree->count; ++i) {
+        operations[i] = __atomic_exchange_n(&tree->shards[i].operations, 0, __ATOMIC_RELAXED);
+        total += operations[i];
+        if (operations[i] > hottest) {
+            hot = i;
+            hottest = operations[i];
+        }
+    }
+
+    bool isMoved = false;
+    if (hottest > 0 && hottest * tree->count >= 2 * total) {
+        size_t neighbour = hot + 1;
+        if (hot == tree->count - 1 || (hot > 0 && operations[hot - 1] < operations[hot + 1])) neighbour = hot - 1;
+
+        Shard* first = &tree->shards[hot < neighbour ? hot : neighbour];
+        Shard* second = &tree->shards[hot < neighbour ? neighbour : hot];
+        rwLatchAcquire(&first->lock);
+        rwLatchAcquire(&second->lock);
+
+        isMoved = moveValues(&tree->shards[hot], &tree->shards[neighbour], neighbour > hot);
+
+        rwLatchRelease(&second->lock);
+        rwLatchRelease(&first->lock);
+    }
+
+    free(operations);
+    latchRelease(&tree->lock);
+    return isMoved;
+}
+
+// Free every shard. Their roots may be NULL, which freeTree ignores.
+void shardedFree(ShardedTree* tree) {
+    if (tree == NULL) return;
+
+    for (size_t i = 0; i < tree->count; ++i) freeTree(tree->shards[i].root);
+
+    latchDestroy(&tree->lock);
+    free(tree->shards);
+    free(tree);
+}
+
+// Hash shards use the top bits of a multiplicative hash, range shards the last shard that starts at or before the value
+static size_t route(const ShardedTree* tree, const int data) {
+    if (tree->mode == SHARD_BY_HASH) {
+        const uint32_t hash = (uint32_t)data * 2654435769u;
+        return (size_t)(((uint64_t)hash * tree->count) >> 32);
+    }
+
+    size_t low = 0, high = tree->count - 1;
+    while (low < high) {
+        const size_t middle = low + (high - low + 1) / 2;
+        if (__atomic_load_n(&tree->shards[middle].lo, __ATOMIC_RELAXED) <= data) low = middle;
+        else high = middle - 1;
+    }
+
+    return low;
+}
+
+// The bounds we routed by may be stale, so we check them again once the shard is latched
+static Shard* latchShard(ShardedTree* tree, const int data, const bool exclusive) {
+    while (true) {
+        Shard* shard = &tree->shards[route(tree, data)];
+
+        if (exclusive) rwLatchAcquire(&shard->lock);
+        else rwLatchAcquireShared(&shard->lock);
+
+        if (shard->lo <= data && data < shard->hi) return shard;
+
+        if (exclusive) rwLatchRelease(&shard->lock);
+        else rwLatchReleaseShared(&shard->lock);
+    }
+}
+
+// Reserve the value a delete may remove, as long as another one stays
+static bool reserveDelete(Shard* shard) {
+    size_t size = __atomic_load_n(&shard->size, __ATOMIC_ACQUIRE);
+
+    while (size > 1) {
+        if (__atomic_compare_exchange_n(&shard->size, &size, size - 1, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Only range trees rebalance, and only when they have somewhere to move values to. The shard of every sampled
+// operation gets the whole period, so the counters still add up to about the number of operations.
+static void countOperation(const ShardedTree* tree, Shard* shard) {
+    if (tree->mode != SHARD_BY_RANGE || tree->count < 2) return;
+    if (++operationTicks % SHARD_SAMPLE_PERIOD != 0) return;
+
+    __atomic_add_fetch(&shard->operations, SHARD_SAMPLE_PERIOD, __ATOMIC_RELAXED);
+}
+
+/*
+ * The values of the hot shard are read in order and split near the middle, at the first copy of a value, so all the
+ * copies of a value stay in one shard. The part that moves is merged into the neighbour, and the part that stays is
+ * built again as a balanced tree.
+ */
+static bool moveValues(Shard* hot, Shard* neighbour, const bool isRight) {
+    const size_t n = treeCount(hot->root);
+    if (n < 2) return false;
+
+    int* values = (int*)malloc(n * sizeof(int));
+    TreeIterator iterator;
+    size_t count = 0;
+
+    iteratorInit(&iterator, hot->root);
+    while (iteratorNext(&iterator, &values[count])) count++;
+    iteratorDestroy(&iterator);
+
+    // Every value before the split is smaller than every value after it
+    size_t split = n / 2;
+    while (split > 0 && values[split - 1] == values[n / 2]) split--;
+    if (split == 0) {
+        split = n / 2;
+        while (split < n && values[split] == values[n / 2]) split++;
+    }
+    if (split == n) {
+        free(values);
+        return false;
+    }
+
+    const long long boundary = values[split];
+    const int* kept = isRight ? values : values + split;
+    const int* moved = isRight ? values + split : values;
+    const size_t keptCount = isRight ? split : n - split;
+    const size_t movedCount = n - keptCount;
+
+    freeTree(hot->root);
+    hot->root = insertBatch(NULL, kept, keptCount);
+    hot->size = keptCount;
+
+    neighbour->root = insertBatch(neighbour->root, moved, movedCount);
+    neighbour->size += movedCount;
+
+    if (isRight) {
+        __atomic_store_n(&hot->hi, boundary, __ATOMIC_RELAXED);
+        __atomic_store_n(&neighbour->lo, boundary, __ATOMIC_RELAXED);
+    }
+    else {
+        __atomic_store_n(&hot->lo, boundary, __ATOMIC_RELAXED);
+        __atomic_store_n(&neighbour->hi, boundary, __ATOMIC_RELAXED);
+    }
+
+    free(values);
+    return true;
+}
+
+// Forward a value, and stop the other shards too once the caller stops
+static bool forwardValue(const int data, void* context) {
+    ShardScan* scan = (ShardScan*)context;
+
+    scan->isStopped = !scan->callback(data, scan->context);
+    return !scan->isStopped;
+}
@@ -0,0 +1,74 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef SHARDED_TREE_H
+#define SHARDED_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "binary_tree.h"
+
+/*
+ * A front-end that splits the values between independent binary search trees (shards), so operations on different
+ * shards never touch the same node or latch. It has the same contract as the tree: duplicates are allowed, and every
+ * delete removes one copy of a value.
+ *
+ * SHARD_BY_RANGE gives every shard a range of values, so the shards hold the values in order. The ranges start as
+ * equal parts of the int range and move when shardedRebalance finds that one shard gets much more operations than the
+ * others. SHARD_BY_HASH spreads the values by a hash and never moves them; its scans are not in order.
+ *
+ * All functions are thread safe. Every shard has a reader/writer latch (an RwLatch, so readers share it whatever
+ * TREE_LATCH is) that guards its root pointer: operations hold it in shared mode, and only the insert into an empty
+ * shard, the delete of its last value and a rebalance hold it exclusively. Inside a shard the tree latches its own
+ * nodes as usual.
+ * Functions that visit several shards (findMin, count and scans) latch one shard at a time, so they see every shard at
+ * a different moment.
+ */
+typedef enum ShardMode {
+    SHARD_BY_RANGE,
+    SHARD_BY_HASH
+} ShardMode;
+
+typedef struct ShardedTree ShardedTree;
+
+// This function creates an empty tree of the given number of shards (at least 1)
+ShardedTree* shardedCreate(size_t shards, ShardMode mode);
+
+// This function inserts a value to the tree
+void shardedInsert(ShardedTree* tree, const int data);
+
+// This function deletes one copy of a value from the tree, returns false if the value is not in the tree
+bool shardedDelete(ShardedTree* tree, const int data);
+
+// This function checks whether a value exists in the tree
+bool shardedSearch(ShardedTree* tree, const int data);
+
+// This function finds the minimal value in the tree, returns false if the tree is empty
+bool shardedFindMin(ShardedTree* tree, int* min);
+
+// This function counts the values in the tree, copies included
+size_t shardedCount(ShardedTree* tree);
+
+/*
+ * This function passes the values in [lo, hi] to the callback, copies included, and returns how many it passed.
+ * The shards are scanned one after the other, so the values come in order only with SHARD_BY_RANGE.
+ */
+size_t shardedRangeScan(ShardedTree* tree, int lo, int hi, ScanCallback callback, void* context);
+
+/*
+ * This function moves load away from the shard that got the most operations since the last call, if it got at least
+ * twice its share. Half of its values move to its less busy neighbour, and the range boundary between them moves
+ * with them. Returns true if values were moved. Only SHARD_BY_RANGE trees are rebalanced.
+ * A rebalance rebuilds the hot shard, which takes time in its size and holds both shards exclusively meanwhile, so the
+ * operations never call it: call it from a thread of your own, for example on a timer. Operations are counted on a
+ * sample of them, so call it once the tree got at least a few thousand operations. If another rebalance is running
+ * it returns false at once.
+ */
+bool shardedRebalance(ShardedTree* tree);
+
+// This function frees the tree. No other thread may use it anymore.
+void shardedFree(ShardedTree* tree);
+
+#endif //SHARDED_TREE_H
@@ -0,0 +1,179 @@
+#include <omp.h>
+#include <limits.h>
+
+#include "../external/cunit.h"
+#include "../lock_free_tree.h"
+
+CUNIT_TEST(lock_free_insert_and_search)
+{
+    LockFreeTree* tree = lockFreeCreate();
+    int values[] = { 10, 5, 15, 3, 7, 12, 18, -4 };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        lockFreeInsert(tree, values[i]);
+    }
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        CUNIT_ASSERT_TRUE(lockFreeSearch(tree, values[i]));
+    }
+    CUNIT_ASSERT_FALSE(lockFreeSearch(tree, 1));
+    CUNIT_ASSERT_FALSE(lockFreeSearch(tree, 11));
+    CUNIT_ASSERT_FALSE(lockFreeSearch(tree, 20));
+
+    int min = 0;
+    CUNIT_ASSERT_TRUE(lockFreeFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, -4);
+
+    lockFreeFree(tree);
+}
+
+CUNIT_TEST(lock_free_duplicates_and_extremes)
+{
+    LockFreeTree* tree = lockFreeCreate();
+    int min = 0;
+    CUNIT_ASSERT_FALSE(lockFreeFindMin(tree, &min));
+
+    lockFreeInsert(tree, 10);
+    lockFreeInsert(tree, 10);
+    lockFreeInsert(tree, INT_MAX);
+    lockFreeInsert(tree, INT_MIN);
+
+    CUNIT_ASSERT_TRUE(lockFreeDelete(tree, 10));
+    CUNIT_ASSERT_TRUE(lockFreeSearch(tree, 10));
+    CUNIT_ASSERT_TRUE(lockFreeDelete(tree, 10));
+    CUNIT_ASSERT_FALSE(lockFreeSearch(tree, 10));
+    CUNIT_ASSERT_FALSE(lockFreeDelete(tree, 10));
+
+    CUNIT_ASSERT_TRUE(lockFreeSearch(tree, INT_MAX));
+    CUNIT_ASSERT_TRUE(lockFreeFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, INT_MIN);
+
+    CUNIT_ASSERT_TRUE(lockFreeDelete(tree, INT_MIN));
+    CUNIT_ASSERT_TRUE(lockFreeDelete(tree, INT_MAX));
+    CUNIT_ASSERT_FALSE(lockFreeFindMin(tree, &min));
+
+    lockFreeFree(tree);
+}
+
+CUNIT_TEST(lock_free_thread_safe_insertion)
+{
+    LockFreeTree* tree = lockFreeCreate();
+#pragma omp parallel for schedule(static, 6)
+    for (int i = 0; i < 10000; ++i)
+    {
+        lockFreeInsert(tree, i);
+    }
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        CUNIT_ASSERT_TRUE(lockFreeSearch(tree, i));
+    }
+
+    lockFreeFree(tree);
+}
+
+CUNIT_TEST(lock_free_thread_safe_deletion)
+{
+    LockFreeTree* tree = lockFreeCreate();
+    for (int i = 0; i < 10000; ++i)
+    {
+        lockFreeInsert(tree, (i * 7919) % 10000);
+    }
+
+    // Neighbouring leaves are deleted at the same time, so deletes keep helping each other
+    int failures = 0;
+#pragma omp parallel for schedule(static, 1) reduction(+ : failures)
+    for (int i = 1; i < 10000; ++i)
+    {
+        if (i % 3 != 0)
+        {
+            failures += !lockFreeDelete(tree, i);
+        }
+    }
+
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    for (int i = 0; i < 10000; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(lockFreeSearch(tree, i), i % 3 == 0);
+    }
+
+    lockFreeFree(tree);
+}
+
+CUNIT_TEST(lock_free_thread_safe_mixed)
+{
+    LockFreeTree* tree = lockFreeCreate();
+    for (int i = 0; i < 10000; i += 3)
+    {
+        lockFreeInsert(tree, i);
+    }
+
+    int N = 10000;
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            #pragma omp taskloop nogroup
+            for (int i = 1; i < N; i++)
+            {
+                if (i % 3 != 0)
+                {
+                    lockFreeInsert(tree, i);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int j = 1; j < N; j++)
+            {
+                if (j % 3 == 0)
+                {
+                    lockFreeDelete(tree, j);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int k = 1; k < N; k++)
+            {
+                int min;
+                lockFreeSearch(tree, k);
+                lockFreeFindMin(tree, &min);
+            }
+        }
+    }
+
+    for (int i = 1; i < N; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(lockFreeSearch(tree, i), i % 3 != 0);
+    }
+    int min = -1;
+    CUNIT_ASSERT_TRUE(lockFreeFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, 0);
+
+    lockFreeFree(tree);
+}
+
+CUNIT_TEST(lock_free_copies_under_contention)
+{
+    LockFreeTree* tree = lockFreeCreate();
+
+    // Every thread adds and removes copies of the same few values, the counts must add up in the end
+#pragma omp parallel for
+    for (int i = 0; i < 8000; ++i)
+    {
+        lockFreeInsert(tree, i % 4);
+        lockFreeInsert(tree, i % 4);
+        lockFreeDelete(tree, i % 4);
+    }
+
+    for (int value = 0; value < 4; ++value)
+    {
+        for (int copy = 0; copy < 2000; ++copy)
+        {
+            CUNIT_ASSERT_TRUE(lockFreeDelete(tree, value));
+        }
+        CUNIT_ASSERT_FALSE(lockFreeDelete(tree, value));
+    }
+
+    lockFreeFree(tree);
+}
@@ -222,4 +222,52 @@ CUNIT_TEST(thread_safe_traversal)
             }
         }
     }
-}
\ No newline at end of file
+}
+
+CUNIT_TEST(thread_safe_search_during_writes)
+{
+    // Even values stay in the tree for the whole test, odd values are inserted and deleted concurrently
+    TreeNode* tree = createNode(500);
+    for (int i = 0; i < 1000; i += 2)
+    {
+        if (i != 500)
+        {
+            insertNode(tree, i);
+        }
+    }
+
+    int N = 1000;
+    int found_every_stable_value = 1;
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            #pragma omp taskloop nogroup
+            for (int round = 0; round < 4; round++)
+            {
+                for (int i = 1; i < N; i += 2)
+                {
+                    insertNode(tree, i);
+                }
+                for (int i = 1; i < N; i += 2)
+                {
+                    deleteNode(tree, i);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int k = 0; k < 4 * N; k++)
+            {
+                if (!searchNode(tree, (k * 2) % N))
+                {
+                    #pragma omp atomic write
+                    found_every_stable_value = 0;
+                }
+            }
+        }
+    }
+
+    CUNIT_ASSERT_TRUE(found_every_stable_value);
+    CUNIT_ASSERT_TRUE(is_valid_tree(tree));
+    freeTree(tree);
+}
@@ -0,0 +1,154 @@
+#include <omp.h>
+#include <stdlib.h>
+
+#include "../external/cunit.h"
+#include "../combining_tree.h"
+
+// Counts the requests that the combiner applied
+static void count_done(TreeRequest* request, void* context)
+{
+    (void)request;
+    __atomic_fetch_add((int*)context, 1, __ATOMIC_RELAXED);
+}
+
+CUNIT_TEST(combine_apply_writes)
+{
+    CombiningTree* tree = combiningCreate(NULL);
+    int min = 0;
+    CUNIT_ASSERT_FALSE(combiningFindMin(tree, &min));
+    CUNIT_ASSERT_FALSE(combiningDelete(tree, 5));
+
+    for (int i = 0; i < 100; ++i)
+    {
+        combiningInsert(tree, i);
+    }
+    for (int i = 0; i < 100; i += 2)
+    {
+        CUNIT_ASSERT_TRUE(combiningDelete(tree, i));
+    }
+    CUNIT_ASSERT_FALSE(combiningDelete(tree, 0));
+
+    for (int i = 0; i < 100; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(combiningSearch(tree, i), i % 2);
+    }
+    CUNIT_ASSERT_TRUE(combiningFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, 1);
+
+    // Emptying the tree and filling it again replaces the root
+    for (int i = 1; i < 100; i += 2)
+    {
+        CUNIT_ASSERT_TRUE(combiningDelete(tree, i));
+    }
+    CUNIT_ASSERT_FALSE(combiningFindMin(tree, &min));
+    combiningInsert(tree, 7);
+    CUNIT_ASSERT_TRUE(combiningSearch(tree, 7));
+
+    combiningFree(tree);
+}
+
+CUNIT_TEST(combine_keep_request_order)
+{
+    CombiningTree* tree = combiningCreate(createNode(3));
+    TreeRequest requests[8];
+    int done = 0;
+
+    // Applied one by one or together, the results follow the order of submission
+    requestInit(&requests[0], TREE_DELETE, 5, count_done, &done);
+    requestInit(&requests[1], TREE_INSERT, 5, count_done, &done);
+    requestInit(&requests[2], TREE_INSERT, 5, count_done, &done);
+    requestInit(&requests[3], TREE_DELETE, 5, count_done, &done);
+    requestInit(&requests[4], TREE_DELETE, 3, count_done, &done);
+    requestInit(&requests[5], TREE_DELETE, 3, count_done, &done);
+    requestInit(&requests[6], TREE_INSERT, 1, count_done, &done);
+    requestInit(&requests[7], TREE_DELETE, 1, count_done, &done);
+    for (int i = 0; i < 8; ++i)
+    {
+        combiningSubmit(tree, &requests[i]);
+    }
+    for (int i = 0; i < 8; ++i)
+    {
+        combiningWait(tree, &requests[i]);
+        CUNIT_ASSERT_TRUE(requestDone(&requests[i]));
+    }
+
+    CUNIT_ASSERT_INT_EQ(done, 8);
+    CUNIT_ASSERT_FALSE(requests[0].result);
+    CUNIT_ASSERT_TRUE(requests[3].result);
+    CUNIT_ASSERT_TRUE(requests[4].result);
+    CUNIT_ASSERT_FALSE(requests[5].result);
+    CUNIT_ASSERT_TRUE(requests[7].result);
+
+    CUNIT_ASSERT_TRUE(combiningSearch(tree, 5));
+    CUNIT_ASSERT_FALSE(combiningSearch(tree, 3));
+    CUNIT_ASSERT_FALSE(combiningSearch(tree, 1));
+    CUNIT_ASSERT_TRUE(combiningDelete(tree, 5));
+    CUNIT_ASSERT_FALSE(combiningDelete(tree, 5));
+
+    combiningFree(tree);
+}
+
+CUNIT_TEST(combine_concurrent_writers)
+{
+    CombiningTree* tree = combiningCreate(createNode(-1));
+    int failures = 0;
+
+    // Every thread inserts its values twice and deletes them once, on a few hot values and many cold ones
+#pragma omp parallel for reduction(+:failures)
+    for (int i = 0; i < 8000; ++i)
+    {
+        int value = i % 4 == 0 ? i % 16 : i;
+        combiningInsert(tree, value);
+        combiningInsert(tree, value);
+        failures += !combiningDelete(tree, value);
+        failures += !combiningSearch(tree, value);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    // One copy of every value is left
+    for (int i = 0; i < 8000; ++i)
+    {
+        int value = i % 4 == 0 ? i % 16 : i;
+        failures += !combiningDelete(tree, value);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    for (int i = 0; i < 8000; ++i)
+    {
+        failures += combiningSearch(tree, i);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    int min = 0;
+    CUNIT_ASSERT_TRUE(combiningFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, -1);
+    combiningFree(tree);
+}
+
+CUNIT_TEST(combine_async_submits)
+{
+    CombiningTree* tree = combiningCreate(NULL);
+    TreeRequest* requests = (TreeRequest*)malloc(sizeof(TreeRequest) * 10000);
+    int done = 0;
+
+#pragma omp parallel for
+    for (int i = 0; i < 10000; ++i)
+    {
+        requestInit(&requests[i], TREE_INSERT, i, count_done, &done);
+        combiningSubmit(tree, &requests[i]);
+    }
+    for (int i = 0; i < 10000; ++i)
+    {
+        combiningWait(tree, &requests[i]);
+    }
+    CUNIT_ASSERT_INT_EQ(done, 10000);
+
+    int failures = 0;
+    for (int i = 0; i < 10000; ++i)
+    {
+        failures += !combiningSearch(tree, i);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    free(requests);
+    combiningFree(tree);
+}
@@ -0,0 +1,146 @@
+#include <omp.h>
+#include <limits.h>
+
+#include "../external/cunit.h"
+#include "../compact_tree.h"
+#include "../epoch.h"
+
+CUNIT_TEST(compact_insert_delete_and_search)
+{
+    CompactTree* tree = compactCreate();
+    int values[] = { 50, 30, 70, 20, 40, 60, 80, 35, 45, -1 };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        compactInsert(tree, values[i]);
+    }
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        CUNIT_ASSERT_TRUE(compactSearch(tree, values[i]));
+    }
+    CUNIT_ASSERT_FALSE(compactSearch(tree, 55));
+
+    // A leaf, a node with one child, a node with two children and the root
+    CUNIT_ASSERT_TRUE(compactDelete(tree, 80));
+    CUNIT_ASSERT_TRUE(compactDelete(tree, 20));
+    CUNIT_ASSERT_TRUE(compactDelete(tree, 30));
+    CUNIT_ASSERT_TRUE(compactDelete(tree, 50));
+    CUNIT_ASSERT_FALSE(compactDelete(tree, 50));
+
+    int remaining[] = { 70, 40, 60, 35, 45, -1 };
+    for (size_t i = 0; i < sizeof(remaining) / sizeof(remaining[0]); ++i)
+    {
+        CUNIT_ASSERT_TRUE(compactSearch(tree, remaining[i]));
+    }
+    CUNIT_ASSERT_FALSE(compactSearch(tree, 30));
+
+    int min = 0;
+    CUNIT_ASSERT_TRUE(compactFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, -1);
+
+    compactFree(tree);
+}
+
+CUNIT_TEST(compact_duplicates_and_extremes)
+{
+    CompactTree* tree = compactCreate();
+    int min = 0;
+    CUNIT_ASSERT_FALSE(compactFindMin(tree, &min));
+    CUNIT_ASSERT_FALSE(compactDelete(tree, 0));
+
+    compactInsert(tree, 10);
+    compactInsert(tree, 10);
+    compactInsert(tree, INT_MAX);
+    compactInsert(tree, INT_MIN);
+
+    CUNIT_ASSERT_TRUE(compactDelete(tree, 10));
+    CUNIT_ASSERT_TRUE(compactSearch(tree, 10));
+    CUNIT_ASSERT_TRUE(compactDelete(tree, 10));
+    CUNIT_ASSERT_FALSE(compactSearch(tree, 10));
+
+    CUNIT_ASSERT_TRUE(compactFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, INT_MIN);
+    CUNIT_ASSERT_TRUE(compactDelete(tree, INT_MIN));
+    CUNIT_ASSERT_TRUE(compactDelete(tree, INT_MAX));
+    CUNIT_ASSERT_FALSE(compactFindMin(tree, &min));
+
+    compactFree(tree);
+}
+
+CUNIT_TEST(compact_grow_and_reuse_chunks)
+{
+    CompactTree* tree = compactCreate();
+
+    // The first chunk is small, so an empty tree takes a few KiB
+    CUNIT_ASSERT_TRUE(compactMemory(tree) <= 16 * 1024);
+
+    // More nodes than a chunk holds, in an order that keeps the tree shallow
+    const int count = 200000;
+    for (int i = 0; i < count; ++i)
+    {
+        compactInsert(tree, (int)((long long)i * 7919 % count));
+    }
+    const size_t grown = compactMemory(tree);
+    CUNIT_ASSERT_TRUE(grown >= (size_t)count * 16);
+    CUNIT_ASSERT_TRUE(grown <= (size_t)count * 32);
+
+    for (int i = 0; i < count; ++i)
+    {
+        CUNIT_ASSERT_TRUE(compactDelete(tree, i));
+    }
+    epochSynchronize();
+
+    // The removed nodes come back from the free list instead of new chunks
+    for (int i = 0; i < count; ++i)
+    {
+        compactInsert(tree, (int)((long long)i * 7919 % count));
+    }
+    CUNIT_ASSERT_INT_EQ(compactMemory(tree), grown);
+
+    compactFree(tree);
+}
+
+CUNIT_TEST(compact_thread_safe_mixed)
+{
+    CompactTree* tree = compactCreate();
+    for (int i = 0; i < 10000; i += 2)
+    {
+        compactInsert(tree, i * 7919 % 10000);
+    }
+
+    // Even values stay in the tree while odd values are added and removed around them
+    int failures = 0;
+#pragma omp parallel for reduction(+:failures)
+    for (int i = 0; i < 20000; ++i)
+    {
+        const int value = (i % 10000) * 7919 % 10000;
+        if (value % 2 == 0)
+        {
+            failures += !compactSearch(tree, value);
+        }
+        else if (i < 10000)
+        {
+            compactInsert(tree, value);
+        }
+        else
+        {
+            int min = 0;
+            failures += !compactFindMin(tree, &min) || min != 0;
+        }
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+#pragma omp parallel for reduction(+:failures)
+    for (int i = 1; i < 10000; i += 2)
+    {
+        failures += !compactDelete(tree, i);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        CUNIT_ASSERT_TRUE(compactSearch(tree, i) == (i % 2 == 0));
+    }
+
+    compactFree(tree);
+}
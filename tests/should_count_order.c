@@ -0,0 +1,157 @@
+#include <omp.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+#include "test_helpers.h"
+
+static int compare_ints(const void* a, const void* b)
+{
+    const int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Checks rank, select and count against the sorted values the tree should hold. Returns the number of wrong answers.
+static int order_failures(const TreeNode* root, int* values, size_t n)
+{
+    qsort(values, n, sizeof(int), compare_ints);
+
+    int failures = subtree_size(root) != (long)n;
+    for (size_t k = 0; k < n; ++k)
+    {
+        int value = 0;
+        failures += !treeSelect(root, k, &value) || value != values[k];
+
+        // The rank of a value is the position of its first copy
+        failures += k > 0 && values[k - 1] == values[k] ? 0 : treeRank(root, values[k]) != k;
+    }
+
+    int value = 0;
+    failures += treeSelect(root, n, &value);
+    failures += treeCountRange(root, INT_MIN, INT_MAX) != n;
+    return failures;
+}
+
+CUNIT_TEST(order_rank_select_and_count)
+{
+    TreeNode* tree = createNode(50);
+    int values[] = { 50, 30, 70, 20, 40, 60, 80, 30, 30, 75, -10 };
+    for (size_t i = 1; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        insertNode(tree, values[i]);
+    }
+
+    CUNIT_ASSERT_INT_EQ(order_failures(tree, values, sizeof(values) / sizeof(values[0])), 0);
+    CUNIT_ASSERT_INT_EQ(treeRank(tree, 30), 2);
+    CUNIT_ASSERT_INT_EQ(treeRank(tree, 31), 5);
+    CUNIT_ASSERT_INT_EQ(treeRank(tree, INT_MIN), 0);
+    CUNIT_ASSERT_INT_EQ(treeRank(tree, INT_MAX), 11);
+
+    CUNIT_ASSERT_INT_EQ(treeCountRange(tree, 30, 30), 3);
+    CUNIT_ASSERT_INT_EQ(treeCountRange(tree, 25, 65), 6);
+    CUNIT_ASSERT_INT_EQ(treeCountRange(tree, 71, 79), 1);
+    CUNIT_ASSERT_INT_EQ(treeCountRange(tree, 81, 100), 0);
+    CUNIT_ASSERT_INT_EQ(treeCountRange(tree, 40, 30), 0);
+
+    // A leaf, a node with two children, a missing value and a copy
+    deleteNode(tree, 75);
+    deleteNode(tree, 30);
+    deleteNode(tree, 31);
+    deleteNode(tree, 50);
+    int remaining[] = { 30, 30, 70, 20, 40, 60, 80, -10 };
+    CUNIT_ASSERT_INT_EQ(order_failures(tree, remaining, sizeof(remaining) / sizeof(remaining[0])), 0);
+
+    freeTree(tree);
+    CUNIT_ASSERT_INT_EQ(treeRank(NULL, 0), 0);
+    CUNIT_ASSERT_INT_EQ(treeCountRange(NULL, 0, 1), 0);
+}
+
+CUNIT_TEST(order_balanced_and_batch)
+{
+    int values[3000];
+    TreeNode* tree = createNode(0);
+    values[0] = 0;
+    for (int i = 1; i < 2000; ++i)
+    {
+        insertBalanced(tree, i);
+        values[i] = i;
+    }
+    for (int i = 0; i < 2000; i += 3)
+    {
+        deleteBalanced(tree, i);
+        deleteBalanced(tree, -i - 1);
+    }
+
+    size_t n = 0;
+    for (int i = 0; i < 2000; ++i)
+    {
+        if (i % 3 != 0)
+        {
+            values[n++] = i;
+        }
+    }
+    CUNIT_ASSERT_INT_EQ(order_failures(tree, values, n), 0);
+    freeTree(tree);
+
+    // A batch builds one tree and merges into another, copies included
+    int batch[1000];
+    for (int i = 0; i < 1000; ++i)
+    {
+        batch[i] = i * 7 % 500;
+    }
+    tree = insertBatch(NULL, batch, 500);
+    tree = insertBatch(tree, batch + 500, 500);
+    CUNIT_ASSERT_INT_EQ(order_failures(tree, batch, 1000), 0);
+    CUNIT_ASSERT_INT_EQ(treeCountRange(tree, 10, 19), 20);
+    freeTree(tree);
+}
+
+CUNIT_TEST(order_thread_safe_updates)
+{
+    TreeNode* tree = createNode(-1);
+    TreeNode* balanced = createNode(-1);
+
+    // Inserts, then deletes of present and missing values
+#pragma omp parallel for
+    for (int i = 0; i < 20000; ++i)
+    {
+        insertNode(tree, i * 7919 % 20000);
+        insertBalanced(balanced, i * 7919 % 20000);
+    }
+
+    // Two deletes run for every odd value, so one of them finds nothing, often after the value was checked
+    int failures = 0;
+#pragma omp parallel for schedule(static, 1) reduction(+:failures)
+    for (int i = 0; i < 40000; ++i)
+    {
+        const int value = i / 2 * 7919 % 20000;
+        if (value % 2 == 1)
+        {
+            deleteNode(tree, value);
+            deleteBalanced(balanced, value);
+        }
+        else
+        {
+            deleteNode(tree, value + 20000);
+            deleteBalanced(balanced, value + 20000);
+        }
+
+        int selected = 0;
+        failures += treeRank(tree, INT_MAX) > 20001 || !treeSelect(balanced, 0, &selected) || selected != -1;
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    int values[10001];
+    values[0] = -1;
+    for (int i = 0; i < 10000; ++i)
+    {
+        values[i + 1] = 2 * i;
+    }
+    CUNIT_ASSERT_INT_EQ(order_failures(tree, values, 10001), 0);
+    CUNIT_ASSERT_INT_EQ(order_failures(balanced, values, 10001), 0);
+    CUNIT_ASSERT_INT_EQ(treeCountRange(tree, 100, 199), 50);
+
+    freeTree(tree);
+    freeTree(balanced);
+}
@@ -0,0 +1,69 @@
+#include <omp.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+#include "../tree_stats.h"
+
+CUNIT_TEST(stats_count_operations)
+{
+    TreeStats before, after;
+    treeStats(&before);
+
+    TreeNode* tree = createNode(50);
+    for (int i = 0; i < 100; ++i)
+    {
+        insertNode(tree, i);
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        searchNode(tree, i);
+    }
+    deleteNode(tree, 99);
+    findMin(tree);
+
+    treeStats(&after);
+    freeTree(tree);
+
+#if TREE_STATS
+    // The values go in order, so the tree is a long path and some operations walk all of it
+    CUNIT_ASSERT_INT_EQ(after.operations - before.operations, 202);
+    CUNIT_ASSERT_INT_EQ(after.allocations - before.allocations, 101);
+    CUNIT_ASSERT_TRUE(after.maxPathLength >= 50);
+    CUNIT_ASSERT_TRUE(after.nodesVisited - before.nodesVisited >= 100 * 25);
+    CUNIT_ASSERT_TRUE(after.latchAcquires - before.latchAcquires >= 100);
+
+    unsigned long long bucketed = 0;
+    for (int i = 0; i < TREE_STATS_PATH_BUCKETS; ++i)
+    {
+        bucketed += after.pathLengths[i] - before.pathLengths[i];
+    }
+    CUNIT_ASSERT_INT_EQ(bucketed, 202);
+#else
+    CUNIT_ASSERT_INT_EQ(after.operations, 0);
+    CUNIT_ASSERT_INT_EQ(after.latchAcquires, 0);
+    CUNIT_ASSERT_INT_EQ(after.maxPathLength, 0);
+#endif
+}
+
+CUNIT_TEST(stats_add_up_threads)
+{
+    TreeStats before, after;
+    treeStats(&before);
+
+    TreeNode* tree = createNode(0);
+#pragma omp parallel for
+    for (int i = 1; i < 10000; ++i)
+    {
+        insertNode(tree, i * 7919 % 10000);
+    }
+
+    treeStats(&after);
+    freeTree(tree);
+
+#if TREE_STATS
+    CUNIT_ASSERT_INT_EQ(after.operations - before.operations, 9999);
+    CUNIT_ASSERT_TRUE(after.contendedAcquires - before.contendedAcquires <= after.latchAcquires - before.latchAcquires);
+#else
+    CUNIT_ASSERT_INT_EQ(after.operations, 0);
+#endif
+}
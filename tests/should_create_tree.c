@@ -2,6 +2,7 @@
 #include "../external/cunit.h"
 
 #include "../binary_tree.h"
+#include "../epoch.h"
 
 CUNIT_TEST(create_tree)
 {
@@ -325,4 +326,38 @@ CUNIT_TEST(deletion_large)
             CUNIT_ASSERT_TRUE(searchNode(tree, i));
         }
     }
-}
\ No newline at end of file
+}
+
+CUNIT_TEST(deleted_node_is_reused)
+{
+    TreeNode* tree = createNode(10);
+    insertNode(tree, 5);
+    TreeNode* node_5 = tree->left;
+
+    deleteNode(tree, 5);
+    CUNIT_ASSERT_PTR_NULL(tree->left);
+
+    // Once no reader can still see it, the node of the deleted value is recycled by the next insert
+    epochSynchronize();
+    insertNode(tree, 7);
+    CUNIT_ASSERT_PTR_EQ(tree->left, node_5);
+    CUNIT_ASSERT_INT_EQ(tree->left->data, 7);
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(free_large_tree)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 10000; ++i)
+    {
+        insertBalanced(tree, i);
+    }
+    for (int i = 0; i < 10000; i += 2)
+    {
+        deleteBalanced(tree, i);
+    }
+
+    CUNIT_ASSERT_TRUE(searchNode(tree, 9999));
+    freeTree(tree);
+}
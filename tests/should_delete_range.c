@@ -0,0 +1,229 @@
+#include <omp.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+#include "test_helpers.h"
+
+CUNIT_TEST(range_delete_values)
+{
+    // The values 0 to 999 in a scattered order, a second copy of every tenth one and a third copy of 500
+    TreeNode* tree = createNode(500);
+    for (int i = 0; i < 1000; ++i)
+    {
+        insertNode(tree, i * 7919 % 1000);
+    }
+    for (int i = 0; i < 1000; i += 10)
+    {
+        insertNode(tree, i);
+    }
+
+    size_t deleted = 0;
+    CUNIT_ASSERT_TRUE(deleteRange(tree, 200, 499, &deleted) == tree);
+    CUNIT_ASSERT_INT_EQ(deleted, 330);
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 771);
+
+    int failures = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        failures += searchNode(tree, i) != (i < 200 || i > 499);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    CUNIT_ASSERT_INT_EQ(treeCountRange(tree, 0, 199), 220);
+    CUNIT_ASSERT_INT_EQ(treeRank(tree, 700), 441);
+
+    // Ranges with no values in them
+    deleteRange(tree, 300, 400, &deleted);
+    CUNIT_ASSERT_INT_EQ(deleted, 0);
+    deleteRange(tree, 600, 550, &deleted);
+    CUNIT_ASSERT_INT_EQ(deleted, 0);
+    deleteRange(tree, INT_MIN, -1, NULL);
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 771);
+
+    // The root value is in this range, so the root takes over another node
+    deleteRange(tree, 450, 599, &deleted);
+    CUNIT_ASSERT_INT_EQ(deleted, 111);
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 660);
+    CUNIT_ASSERT_TRUE(tree->data < 450 || tree->data > 599);
+    CUNIT_ASSERT_FALSE(searchNode(tree, 500));
+    CUNIT_ASSERT_TRUE(searchNode(tree, 600));
+
+    // The tree still takes inserts and deletes, and becomes empty with the last range
+    insertNode(tree, 550);
+    tree = deleteNode(tree, 0);
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 660);
+    CUNIT_ASSERT_TRUE(searchNode(tree, 550));
+    CUNIT_ASSERT_TRUE(deleteRange(tree, INT_MIN, INT_MAX, &deleted) == NULL);
+    CUNIT_ASSERT_INT_EQ(deleted, 660);
+    CUNIT_ASSERT_TRUE(deleteRange(NULL, 0, 1, &deleted) == NULL);
+}
+
+CUNIT_TEST(range_delete_batch)
+{
+    TreeNode* tree = createNode(50);
+    for (int i = 0; i < 100; ++i)
+    {
+        insertNode(tree, i);
+    }
+
+    // 50 is in the tree twice, 200 is not in it at all
+    int keys[] = { 10, 50, 50, 50, 200, 99, 0, 10 };
+    size_t deleted = 0;
+    tree = deleteBatch(tree, keys, sizeof(keys) / sizeof(keys[0]), &deleted);
+    CUNIT_ASSERT_INT_EQ(deleted, 5);
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 96);
+    CUNIT_ASSERT_FALSE(searchNode(tree, 10));
+    CUNIT_ASSERT_FALSE(searchNode(tree, 50));
+    CUNIT_ASSERT_TRUE(searchNode(tree, 51));
+
+    int all[100];
+    for (int i = 0; i < 100; ++i)
+    {
+        all[i] = i;
+    }
+    CUNIT_ASSERT_TRUE(deleteBatch(tree, all, 100, &deleted) == NULL);
+    CUNIT_ASSERT_INT_EQ(deleted, 96);
+}
+
+CUNIT_TEST(range_delete_batch_checked)
+{
+    // Sequential values make a path, so the sweep goes 20000 levels down. 7 is in the tree three times.
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 20000; ++i)
+    {
+        insertNode(tree, i);
+    }
+    insertNode(tree, 7);
+    insertNode(tree, 7);
+
+    // The first three 7 get the copies, in the order of the keys
+    int keys[] = { 7, 19999, -5, 7, 0, 7, 12345, 7, 20000, 0 };
+    bool expected[] = { true, true, false, true, true, true, true, false, false, false };
+    bool isDeleted[10];
+    tree = deleteBatchChecked(tree, keys, 10, isDeleted);
+    CUNIT_ASSERT_MEM_EQ(isDeleted, expected, sizeof(expected));
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 19996);
+    CUNIT_ASSERT_FALSE(searchNode(tree, 7));
+    CUNIT_ASSERT_FALSE(searchNode(tree, 0));
+    CUNIT_ASSERT_TRUE(searchNode(tree, 8));
+
+    // Every other value, far down the path
+    int* odd = (int*)malloc(10000 * sizeof(int));
+    for (int i = 0; i < 10000; ++i)
+    {
+        odd[i] = 2 * i + 1;
+    }
+    size_t deleted = 0;
+    tree = deleteBatch(tree, odd, 10000, &deleted);
+    CUNIT_ASSERT_INT_EQ(deleted, 9997);
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 9999);
+    CUNIT_ASSERT_INT_EQ(treeRank(tree, 1000), 499);
+
+    free(odd);
+    freeTree(tree);
+}
+
+CUNIT_TEST(range_delete_batch_thread_safe)
+{
+    // Every thread deletes batches of its own even values, while the values from 20000 are inserted and deleted
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 20000; ++i)
+    {
+        insertNode(tree, i * 7919 % 20000);
+    }
+
+    int failures = 0;
+    size_t total = 0;
+#pragma omp parallel for schedule(static, 1) reduction(+:failures, total)
+    for (int i = 0; i < 200; ++i)
+    {
+        int keys[50];
+        for (int j = 0; j < 50; ++j)
+        {
+            keys[j] = (i * 50 + j) * 7 % 10000 * 2;
+        }
+        size_t deleted = 0;
+        deleteBatch(tree, keys, 50, &deleted);
+        total += deleted;
+
+        const int value = 20000 + i;
+        insertNode(tree, value);
+        failures += !searchNode(tree, value);
+        deleteNode(tree, value);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    CUNIT_ASSERT_INT_EQ(total, 10000);
+
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 10000);
+    for (int i = 0; i < 20000; ++i)
+    {
+        failures += searchNode(tree, i) != (i % 2 == 1);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    freeTree(tree);
+}
+
+CUNIT_TEST(range_delete_large_subtrees)
+{
+    // A balanced tree of 0 .. 2^17 - 1, so the range detaches subtrees that are retired by many tasks
+    const int n = 1 << 17;
+    int* values = (int*)malloc(n * sizeof(int));
+    for (int i = 0; i < n; ++i)
+    {
+        values[i] = i;
+    }
+    TreeNode* tree = insertBatch(NULL, values, n);
+
+    size_t deleted = 0;
+    CUNIT_ASSERT_TRUE(deleteRange(tree, 1000, n - 1001, &deleted) == tree);
+    CUNIT_ASSERT_INT_EQ(deleted, n - 2000);
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 2000);
+    CUNIT_ASSERT_INT_EQ(treeCountRange(tree, 0, n), 2000);
+    CUNIT_ASSERT_INT_EQ(treeRank(tree, n - 1000), 1000);
+
+    free(values);
+    freeTree(tree);
+}
+
+CUNIT_TEST(range_delete_thread_safe)
+{
+    // The values in [200k, 200k + 99] are removed by ranges, the others are inserted and deleted around them
+    TreeNode* tree = createNode(10000);
+    for (int i = 1; i < 20000; ++i)
+    {
+        insertNode(tree, i * 7919 % 20000);
+    }
+
+    int failures = 0;
+#pragma omp parallel for schedule(static, 1) reduction(+:failures)
+    for (int i = 0; i < 20000; ++i)
+    {
+        const int base = i / 200 * 200;
+        if (i == base)
+        {
+            deleteRange(tree, base, base + 99, NULL);
+        }
+        else if (i % 2 == 0)
+        {
+            // A value of the range that is being cut off, often missing already
+            deleteNode(tree, base + i * 37 % 100);
+        }
+        else
+        {
+            const int value = base + 100 + i * 37 % 100;
+            insertNode(tree, value);
+            deleteNode(tree, value);
+            failures += !searchNode(tree, value);
+        }
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    CUNIT_ASSERT_INT_EQ(subtree_size(tree), 10000);
+    for (int i = 0; i < 20000; ++i)
+    {
+        failures += searchNode(tree, i) != (i % 200 >= 100);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    freeTree(tree);
+}
@@ -0,0 +1,78 @@
+#include <omp.h>
+#include <limits.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+#include "../frozen_tree.h"
+
+CUNIT_TEST(freeze_search_values)
+{
+    // Sequential values make the tree a path, the frozen tree is balanced anyway
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 1000; ++i)
+    {
+        insertNode(tree, i * 2);
+    }
+    insertNode(tree, 500);
+    insertNode(tree, INT_MIN);
+    insertNode(tree, INT_MAX);
+
+    FrozenTree* frozen = treeFreeze(tree);
+    freeTree(tree);
+    CUNIT_ASSERT_TRUE(frozen != NULL);
+    CUNIT_ASSERT_INT_EQ(frozenCount(frozen), 1003);
+    CUNIT_ASSERT_TRUE(frozenMemory(frozen) < 1003 * sizeof(TreeNode) / 7);
+
+    int failures = 0;
+#pragma omp parallel for reduction(+:failures)
+    for (int i = -10; i < 2010; ++i)
+    {
+        failures += frozenSearch(frozen, i) != (i >= 0 && i < 2000 && i % 2 == 0);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    CUNIT_ASSERT_TRUE(frozenSearch(frozen, INT_MIN));
+    CUNIT_ASSERT_TRUE(frozenSearch(frozen, INT_MAX));
+    CUNIT_ASSERT_FALSE(frozenSearch(frozen, INT_MAX - 1));
+
+    int min = 0;
+    CUNIT_ASSERT_TRUE(frozenFindMin(frozen, &min));
+    CUNIT_ASSERT_INT_EQ(min, INT_MIN);
+
+    // The thawed tree keeps both copies of 500
+    TreeNode* thawed = frozenThaw(frozen);
+    frozenFree(frozen);
+    CUNIT_ASSERT_INT_EQ(treeCount(thawed), 1003);
+    bool is_deleted = false;
+    thawed = deleteNodeChecked(thawed, 500, &is_deleted);
+    CUNIT_ASSERT_TRUE(is_deleted);
+    CUNIT_ASSERT_TRUE(searchNode(thawed, 500));
+    freeTree(thawed);
+}
+
+CUNIT_TEST(freeze_every_size)
+{
+    // Every shape of the last level, and the empty tree
+    int failures = 0;
+    for (int n = 0; n < 70; ++n)
+    {
+        TreeNode* tree = NULL;
+        for (int i = 0; i < n; ++i)
+        {
+            tree = insertBalanced(tree, i * 3);
+        }
+
+        FrozenTree* frozen = treeFreeze(tree);
+        for (int i = -1; i < 3 * n + 1; ++i)
+        {
+            failures += frozenSearch(frozen, i) != (i >= 0 && i < 3 * n && i % 3 == 0);
+        }
+
+        int min = -1;
+        failures += frozenFindMin(frozen, &min) != (n > 0);
+        failures += n > 0 && min != 0;
+
+        frozenFree(frozen);
+        freeTree(tree);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+}
@@ -0,0 +1,158 @@
+#include <omp.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+
+// Checks the search order of the whole subtree: values <= a node on its left, greater values on its right
+static int is_search_tree(TreeNode* root, long long min, long long max)
+{
+    if (root == NULL)
+    {
+        return true;
+    }
+    return root->data > min && root->data <= max &&
+           is_search_tree(root->left, min, root->data) && is_search_tree(root->right, root->data, max);
+}
+
+static int height(TreeNode* root)
+{
+    if (root == NULL)
+    {
+        return 0;
+    }
+    int left = height(root->left), right = height(root->right);
+    return 1 + (left > right ? left : right);
+}
+
+CUNIT_TEST(batch_into_empty_tree_is_balanced)
+{
+    int keys[1000];
+    for (int i = 0; i < 1000; ++i)
+    {
+        keys[i] = (i * 7) % 1000;
+    }
+
+    TreeNode* tree = insertBatch(NULL, keys, 1000);
+    CUNIT_ASSERT_PTR_NOT_NULL(tree);
+    CUNIT_ASSERT_TRUE(is_search_tree(tree, LLONG_MIN, LLONG_MAX));
+    CUNIT_ASSERT_INT_EQ(height(tree), 10);
+    CUNIT_ASSERT_INT_EQ(tree->height, 10);
+    for (int i = 0; i < 1000; ++i)
+    {
+        CUNIT_ASSERT_TRUE(searchNode(tree, i));
+    }
+    CUNIT_ASSERT_FALSE(searchNode(tree, 1000));
+
+    // The balanced functions keep working on the bulk-loaded tree
+    insertBalanced(tree, 1000);
+    deleteBalanced(tree, 500);
+    CUNIT_ASSERT_TRUE(searchNode(tree, 1000));
+    CUNIT_ASSERT_FALSE(searchNode(tree, 500));
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(batch_into_existing_tree)
+{
+    TreeNode* tree = createNode(50);
+    for (int i = 0; i < 100; i += 10)
+    {
+        insertNode(tree, i);
+    }
+
+    int keys[100];
+    for (int i = 0; i < 100; ++i)
+    {
+        keys[i] = 99 - i;
+    }
+    CUNIT_ASSERT_PTR_EQ(insertBatch(tree, keys, 100), tree);
+
+    CUNIT_ASSERT_TRUE(is_search_tree(tree, LLONG_MIN, LLONG_MAX));
+    for (int i = 0; i < 100; ++i)
+    {
+        CUNIT_ASSERT_TRUE(searchNode(tree, i));
+    }
+
+    // Every value inserted twice (or three times for 50) is deleted that many times
+    for (int i = 0; i < 100; ++i)
+    {
+        deleteNode(tree, i);
+        CUNIT_ASSERT_INT_EQ(searchNode(tree, i), i % 10 == 0);
+    }
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(batch_with_duplicates)
+{
+    int keys[] = { 5, 5, 5, 1, 9, 5, 9, 5, 5, 5, 5, 5, 5 };
+    size_t n = sizeof(keys) / sizeof(keys[0]);
+
+    TreeNode* tree = insertBatch(NULL, keys, n);
+    CUNIT_ASSERT_TRUE(is_search_tree(tree, LLONG_MIN, LLONG_MAX));
+
+    for (int copies = 0; copies < 10; ++copies)
+    {
+        CUNIT_ASSERT_TRUE(searchNode(tree, 5));
+        tree = deleteNode(tree, 5);
+    }
+    CUNIT_ASSERT_FALSE(searchNode(tree, 5));
+    CUNIT_ASSERT_TRUE(searchNode(tree, 1));
+    CUNIT_ASSERT_TRUE(searchNode(tree, 9));
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(large_batch_is_built_in_parallel)
+{
+    size_t n = 200000;
+    int* keys = (int*)malloc(n * sizeof(int));
+    for (size_t i = 0; i < n; ++i)
+    {
+        keys[i] = (int)((i * 7919) % n);
+    }
+
+    TreeNode* tree = insertBatch(NULL, keys, n / 2);
+    tree = insertBatch(tree, keys + n / 2, n - n / 2);
+
+    CUNIT_ASSERT_TRUE(is_search_tree(tree, LLONG_MIN, LLONG_MAX));
+    for (size_t i = 0; i < n; ++i)
+    {
+        CUNIT_ASSERT_TRUE(searchNode(tree, (int)i));
+    }
+
+    free(keys);
+    freeTree(tree);
+}
+
+CUNIT_TEST(thread_safe_batches)
+{
+    TreeNode* tree = createNode(5000);
+
+#pragma omp parallel for schedule(static, 1)
+    for (int batch = 0; batch < 10; ++batch)
+    {
+        int keys[1000];
+        for (int i = 0; i < 1000; ++i)
+        {
+            keys[i] = i * 10 + batch;
+        }
+        insertBatch(tree, keys, 1000);
+        insertNode(tree, -batch - 1);
+        deleteNode(tree, batch);
+    }
+
+    CUNIT_ASSERT_TRUE(is_search_tree(tree, LLONG_MIN, LLONG_MAX));
+    for (int i = 0; i < 10000; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(searchNode(tree, i), i >= 10);
+    }
+    for (int i = 1; i <= 10; ++i)
+    {
+        CUNIT_ASSERT_TRUE(searchNode(tree, -i));
+    }
+
+    freeTree(tree);
+}
@@ -0,0 +1,150 @@
+#include <omp.h>
+#include <stdlib.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+#include "../epoch.h"
+
+// Counts how many times the reclaim function ran
+static int reclaimed = 0;
+
+static void count_reclaim(void* object)
+{
+    __atomic_add_fetch(&reclaimed, 1, __ATOMIC_RELAXED);
+    free(object);
+}
+
+CUNIT_TEST(retired_objects_wait_for_readers)
+{
+    reclaimed = 0;
+
+    epochEnter();
+    for (int i = 0; i < 1000; ++i)
+    {
+        epochRetire(malloc(16), count_reclaim);
+    }
+
+    // We are still inside the epoch the objects were retired in, so none of them can go
+    CUNIT_ASSERT_INT_EQ(reclaimed, 0);
+    epochExit();
+
+    epochSynchronize();
+    CUNIT_ASSERT_INT_EQ(reclaimed, 1000);
+}
+
+CUNIT_TEST(other_threads_limbo_is_collected)
+{
+    reclaimed = 0;
+
+    // Worker threads retire a few objects each, fewer than a batch, and never retire again
+#pragma omp parallel num_threads(4)
+    {
+        if (omp_get_thread_num() != 0)
+        {
+            for (int i = 0; i < 10; ++i)
+            {
+                epochRetire(malloc(16), count_reclaim);
+            }
+        }
+    }
+
+    // No reader is inside an epoch, so the main thread reclaims them without waiting
+    epochCollect();
+    CUNIT_ASSERT_INT_EQ(reclaimed, 30);
+}
+
+CUNIT_TEST(found_min_stays_readable_inside_epoch)
+{
+    TreeNode* tree = createNode(50);
+    for (int i = 0; i < 100; ++i)
+    {
+        insertNode(tree, i);
+    }
+
+    epochEnter();
+    TreeNode* min = findMin(tree);
+    CUNIT_ASSERT_INT_EQ(min->data, 0);
+
+    // Another thread deletes the min and churns through many nodes, but cannot reuse the one we hold
+    int reused = 0;
+#pragma omp parallel num_threads(2) reduction(+ : reused)
+    {
+        if (omp_get_thread_num() == 1)
+        {
+            deleteNode(tree, 0);
+            for (int round = 0; round < 10; ++round)
+            {
+                for (int i = 1000; i < 1100; ++i)
+                {
+                    insertNode(tree, i);
+                    reused += min->data == i;
+                }
+                for (int i = 1000; i < 1100; ++i)
+                {
+                    deleteNode(tree, i);
+                }
+            }
+        }
+    }
+
+    CUNIT_ASSERT_INT_EQ(reused, 0);
+    CUNIT_ASSERT_INT_EQ(min->data, 0);
+    CUNIT_ASSERT_FALSE(searchNode(tree, 0));
+    epochExit();
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(tree_freed_with_retired_nodes)
+{
+    // The arena outlives the tree until its retired nodes are reclaimed
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 1000; ++i)
+    {
+        insertBalanced(tree, i);
+    }
+    for (int i = 0; i < 1000; i += 2)
+    {
+        deleteBalanced(tree, i);
+    }
+    freeTree(tree);
+
+    tree = createNode(1);
+    deleteNode(tree, 1);
+    epochSynchronize();
+}
+
+CUNIT_TEST(concurrent_readers_and_deletes)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 4000; ++i)
+    {
+        insertBalanced(tree, i);
+    }
+
+    // Odd values are never deleted, so every reader must keep finding them
+    int failures = 0;
+#pragma omp parallel for reduction(+ : failures)
+    for (int round = 0; round < 32; ++round)
+    {
+        if (round % 4 == 0)
+        {
+            for (int i = 2; i < 4000; i += 2)
+            {
+                deleteBalanced(tree, i);
+                insertBalanced(tree, i);
+            }
+        }
+        else
+        {
+            for (int i = 1; i < 4000; i += 2)
+            {
+                failures += !searchNode(tree, i);
+            }
+        }
+    }
+
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    freeTree(tree);
+    epochSynchronize();
+}
@@ -0,0 +1,119 @@
+#include <omp.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+
+static long long add(long long a, long long b)
+{
+    return a + b;
+}
+
+static long long minimum(long long a, long long b)
+{
+    return a < b ? a : b;
+}
+
+static long long maximum(long long a, long long b)
+{
+    return a > b ? a : b;
+}
+
+// Not commutative: appends the decimal digits of b to a, so the result shows the order of the values
+static long long concat(long long a, long long b)
+{
+    for (long long digits = b; digits > 0; digits /= 10)
+    {
+        a *= 10;
+    }
+    return a + b;
+}
+
+CUNIT_TEST(reduce_small_trees)
+{
+    CUNIT_ASSERT_INT_EQ(treeReduce(NULL, add, 0), 0);
+    CUNIT_ASSERT_INT_EQ(treeCount(NULL), 0);
+
+    TreeNode* tree = createNode(5);
+    CUNIT_ASSERT_INT_EQ(treeReduce(tree, add, 0), 5);
+    CUNIT_ASSERT_INT_EQ(treeCount(tree), 1);
+
+    insertNode(tree, 3);
+    insertNode(tree, 8);
+    insertNode(tree, 1);
+    insertNode(tree, 4);
+    insertNode(tree, 9);
+    insertNode(tree, 3);
+    CUNIT_ASSERT_INT_EQ(treeReduce(tree, concat, 0), 1334589);
+    CUNIT_ASSERT_INT_EQ(treeReduce(tree, minimum, LLONG_MAX), 1);
+    CUNIT_ASSERT_INT_EQ(treeReduce(tree, maximum, LLONG_MIN), 9);
+    CUNIT_ASSERT_INT_EQ(treeCount(tree), 7);
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(reduce_large_tree)
+{
+    int n = 500000;
+    int* keys = (int*)malloc(n * sizeof(int));
+    for (int i = 0; i < n; ++i)
+    {
+        keys[i] = (int)(((long long)i * 7919) % n) - 1000;
+    }
+
+    TreeNode* tree = insertBatch(NULL, keys, n);
+    CUNIT_ASSERT_INT_EQ(treeCount(tree), n);
+    CUNIT_ASSERT_TRUE(treeReduce(tree, add, 0) == (long long)n * (n - 1) / 2 - 1000LL * n);
+    CUNIT_ASSERT_INT_EQ(treeReduce(tree, minimum, LLONG_MAX), -1000);
+    CUNIT_ASSERT_INT_EQ(treeReduce(tree, maximum, LLONG_MIN), n - 1001);
+
+    // Called from inside a parallel region, the reductions share its threads
+    long long sums[4];
+#pragma omp parallel for
+    for (int i = 0; i < 4; ++i)
+    {
+        sums[i] = treeReduce(tree, add, 0);
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        CUNIT_ASSERT_TRUE(sums[i] == treeReduce(tree, add, 0));
+    }
+
+    free(keys);
+    freeTree(tree);
+}
+
+CUNIT_TEST(reduce_during_writes)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 2000; i += 2)
+    {
+        insertBalanced(tree, i);
+    }
+
+    // Every write inserts a value and deletes it again, so a reduction sees it either way or not at all
+    int failures = 0;
+#pragma omp parallel for reduction(+ : failures)
+    for (int round = 0; round < 16; ++round)
+    {
+        if (round % 2 == 0)
+        {
+            for (int i = 2; i < 2000; i += 2)
+            {
+                insertBalanced(tree, i);
+                deleteBalanced(tree, i);
+            }
+        }
+        else
+        {
+            long long count = (long long)treeCount(tree);
+            failures += count < 1001 || count > 1009;
+            failures += treeReduce(tree, minimum, LLONG_MAX) != 0;
+        }
+    }
+
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    CUNIT_ASSERT_INT_EQ(treeCount(tree), 1001);
+    freeTree(tree);
+}
@@ -0,0 +1,116 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <omp.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+#include "../tree_file.h"
+
+// A fresh path in the temporary directory, removed by the test that uses it
+static void temporary_path(char* path)
+{
+    snprintf(path, 64, "/tmp/should_save_tree_XXXXXX");
+    const int fd = mkstemp(path);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+CUNIT_TEST(file_save_and_load)
+{
+    char path[64];
+    temporary_path(path);
+
+    // Sequential values make the tree a path, the loaded file is balanced anyway
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 1000; ++i)
+    {
+        insertNode(tree, i * 2);
+    }
+    insertNode(tree, 500);
+    insertNode(tree, INT_MIN);
+    CUNIT_ASSERT_TRUE(treeSave(tree, path));
+    freeTree(tree);
+
+    MappedTree* mapped = treeLoad(path);
+    CUNIT_ASSERT_TRUE(mapped != NULL);
+    CUNIT_ASSERT_INT_EQ(mappedCount(mapped), 1002);
+
+    int failures = 0;
+#pragma omp parallel for reduction(+:failures)
+    for (int i = 0; i < 2000; ++i)
+    {
+        failures += mappedSearch(mapped, i) != (i % 2 == 0);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    CUNIT_ASSERT_TRUE(mappedSearch(mapped, INT_MIN));
+    CUNIT_ASSERT_FALSE(mappedSearch(mapped, INT_MAX));
+    CUNIT_ASSERT_FALSE(mappedSearch(mapped, -1));
+
+    int min = 0;
+    CUNIT_ASSERT_TRUE(mappedFindMin(mapped, &min));
+    CUNIT_ASSERT_INT_EQ(min, INT_MIN);
+
+    // The restored tree keeps both copies of 500
+    TreeNode* restored = mappedRestore(mapped);
+    mappedClose(mapped);
+    CUNIT_ASSERT_INT_EQ(treeCount(restored), 1002);
+    CUNIT_ASSERT_INT_EQ(restored->height, 10);
+    restored = deleteNode(restored, 500);
+    CUNIT_ASSERT_TRUE(searchNode(restored, 500));
+    CUNIT_ASSERT_TRUE(searchNode(restored, 1998));
+    freeTree(restored);
+
+    remove(path);
+}
+
+CUNIT_TEST(file_save_empty_tree)
+{
+    char path[64];
+    temporary_path(path);
+
+    CUNIT_ASSERT_TRUE(treeSave(NULL, path));
+    MappedTree* mapped = treeLoad(path);
+    CUNIT_ASSERT_TRUE(mapped != NULL);
+    CUNIT_ASSERT_INT_EQ(mappedCount(mapped), 0);
+    CUNIT_ASSERT_FALSE(mappedSearch(mapped, 0));
+
+    int min = 0;
+    CUNIT_ASSERT_FALSE(mappedFindMin(mapped, &min));
+    CUNIT_ASSERT_TRUE(mappedRestore(mapped) == NULL);
+    mappedClose(mapped);
+
+    remove(path);
+}
+
+CUNIT_TEST(file_refuse_invalid_files)
+{
+    char path[64];
+    temporary_path(path);
+
+    // An empty file, a file of another kind and a cut file
+    CUNIT_ASSERT_TRUE(treeLoad(path) == NULL);
+
+    FILE* file = fopen(path, "wb");
+    for (int i = 0; i < 100; ++i)
+    {
+        fputc('x', file);
+    }
+    fclose(file);
+    CUNIT_ASSERT_TRUE(treeLoad(path) == NULL);
+
+    TreeNode* tree = createNode(1);
+    insertNode(tree, 2);
+    CUNIT_ASSERT_TRUE(treeSave(tree, path));
+    freeTree(tree);
+    CUNIT_ASSERT_TRUE(truncate(path, 64 + sizeof(int)) == 0);
+    CUNIT_ASSERT_TRUE(treeLoad(path) == NULL);
+
+    remove(path);
+    CUNIT_ASSERT_TRUE(treeLoad(path) == NULL);
+}
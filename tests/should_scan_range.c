@@ -0,0 +1,120 @@
+#include <omp.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+#include "test_helpers.h"
+
+CUNIT_TEST(iterator_visits_in_order)
+{
+    TreeNode* tree = createNode(50);
+    for (int i = 0; i < 100; ++i)
+    {
+        insertNode(tree, (i * 37) % 100);
+    }
+
+    TreeIterator iterator;
+    int data, expected = 0;
+    iteratorInit(&iterator, tree);
+    while (iteratorNext(&iterator, &data))
+    {
+        // 50 is in the tree twice
+        CUNIT_ASSERT_INT_EQ(data, expected);
+        if (data != 50 || expected == 51)
+        {
+            expected++;
+        }
+        else
+        {
+            expected = 51;
+            CUNIT_ASSERT_TRUE(iteratorNext(&iterator, &data));
+            CUNIT_ASSERT_INT_EQ(data, 50);
+        }
+    }
+    CUNIT_ASSERT_INT_EQ(expected, 100);
+    CUNIT_ASSERT_FALSE(iteratorNext(&iterator, &data));
+    iteratorDestroy(&iterator);
+
+    iteratorInit(&iterator, NULL);
+    CUNIT_ASSERT_FALSE(iteratorNext(&iterator, &data));
+    iteratorDestroy(&iterator);
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(range_scan_bounds)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 1000; ++i)
+    {
+        insertBalanced(tree, i * 2);
+    }
+
+    int values[1000];
+    Buffer buffer = { values, 0, 1000 };
+    CUNIT_ASSERT_INT_EQ(rangeScan(tree, 101, 200, collect, &buffer), 50);
+    for (int i = 0; i < 50; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(buffer.values[i], 102 + i * 2);
+    }
+
+    // Empty ranges, and a range past the end
+    buffer.count = 0;
+    CUNIT_ASSERT_INT_EQ(rangeScan(tree, 11, 11, collect, &buffer), 0);
+    CUNIT_ASSERT_INT_EQ(rangeScan(tree, 20, 10, collect, &buffer), 0);
+    CUNIT_ASSERT_INT_EQ(rangeScan(tree, 1990, 5000, collect, &buffer), 5);
+
+    // The callback stops the scan early, and every latch is released
+    buffer.count = 0;
+    buffer.capacity = 10;
+    CUNIT_ASSERT_INT_EQ(rangeScan(tree, 0, 1998, collect, &buffer), 10);
+    CUNIT_ASSERT_INT_EQ(buffer.values[9], 18);
+    insertBalanced(tree, 7);
+    CUNIT_ASSERT_TRUE(searchNode(tree, 7));
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(range_scan_during_writes)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 1000; i += 2)
+    {
+        insertBalanced(tree, i);
+    }
+
+    // Odd values stay in the tree the whole time, so every scan sees all of them in order
+    int failures = 0;
+#pragma omp parallel for reduction(+ : failures)
+    for (int round = 0; round < 32; ++round)
+    {
+        if (round % 2 == 0)
+        {
+            for (int i = 2; i < 1000; i += 2)
+            {
+                insertBalanced(tree, i);
+                deleteBalanced(tree, i - 2);
+            }
+        }
+        else
+        {
+            int values[1000];
+            Buffer buffer = { values, 0, 1000 };
+            rangeScan(tree, 100, 899, collect, &buffer);
+
+            int odd = 101;
+            for (size_t i = 0; i < buffer.count; ++i)
+            {
+                failures += i > 0 && buffer.values[i] < buffer.values[i - 1];
+                if (buffer.values[i] % 2 == 1)
+                {
+                    failures += buffer.values[i] != odd;
+                    odd += 2;
+                }
+            }
+            failures += odd != 901;
+        }
+    }
+
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    freeTree(tree);
+}
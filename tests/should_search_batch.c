@@ -0,0 +1,93 @@
+#include <omp.h>
+#include <stdlib.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+
+CUNIT_TEST(batch_search_matches_search)
+{
+    TreeNode* tree = createNode(500);
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (i % 3 != 0)
+        {
+            insertNode(tree, (i * 37) % 1000);
+        }
+    }
+
+    // More keys than one group of lookups, with values on both sides of the tree
+    int keys[1200];
+    bool found[1200];
+    for (int i = 0; i < 1200; ++i)
+    {
+        keys[i] = i - 100;
+    }
+    searchBatch(tree, keys, 1200, found);
+
+    for (int i = 0; i < 1200; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(found[i], searchNode(tree, keys[i]));
+    }
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(batch_search_edge_cases)
+{
+    int keys[] = { 1, 2, 3 };
+    bool found[] = { true, true, true };
+
+    searchBatch(NULL, keys, 3, found);
+    CUNIT_ASSERT_FALSE(found[0] || found[1] || found[2]);
+
+    TreeNode* tree = createNode(2);
+    searchBatch(tree, keys, 0, found);
+    searchBatch(tree, keys, 3, found);
+    CUNIT_ASSERT_FALSE(found[0]);
+    CUNIT_ASSERT_TRUE(found[1]);
+    CUNIT_ASSERT_FALSE(found[2]);
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(batch_search_during_writes)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 2000; i += 2)
+    {
+        insertBalanced(tree, i);
+    }
+
+    int keys[2000];
+    for (int i = 0; i < 2000; ++i)
+    {
+        keys[i] = i;
+    }
+
+    // Odd values stay in the tree the whole time, even ones come and go
+    int failures = 0;
+#pragma omp parallel for reduction(+ : failures)
+    for (int round = 0; round < 64; ++round)
+    {
+        if (round % 2 == 0)
+        {
+            for (int i = 2; i < 2000; i += 2)
+            {
+                insertBalanced(tree, i);
+                deleteBalanced(tree, i);
+            }
+        }
+        else
+        {
+            bool found[2000];
+            searchBatch(tree, keys, 2000, found);
+            for (int i = 1; i < 2000; i += 2)
+            {
+                failures += !found[i];
+            }
+        }
+    }
+
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    freeTree(tree);
+}
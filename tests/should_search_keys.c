@@ -0,0 +1,48 @@
+#include <limits.h>
+
+#include "../external/cunit.h"
+#include "../key_search.h"
+
+CUNIT_TEST(vector_search_matches_scalar)
+{
+    int keys[KEY_SEARCH_WIDTH];
+    for (int i = 0; i < KEY_SEARCH_WIDTH; ++i)
+    {
+        keys[i] = i * 2 - 10;
+    }
+
+    // Every count, with values below, on, between and above the keys
+    for (int count = 0; count <= KEY_SEARCH_WIDTH; ++count)
+    {
+        for (int data = -13; data <= KEY_SEARCH_WIDTH * 2 - 8; ++data)
+        {
+            CUNIT_ASSERT_INT_EQ(keysLowerBound(keys, count, data), keysLowerBoundScalar(keys, count, data));
+            CUNIT_ASSERT_INT_EQ(keysUpperBound(keys, count, data), keysUpperBoundScalar(keys, count, data));
+#if defined(__x86_64__) || defined(__i386__)
+            // The kernels the build did not pick at compile time are still picked at runtime by other builds
+            CUNIT_ASSERT_INT_EQ(keysLowerBoundSse2(keys, count, data), keysLowerBoundScalar(keys, count, data));
+            CUNIT_ASSERT_INT_EQ(keysUpperBoundSse2(keys, count, data), keysUpperBoundScalar(keys, count, data));
+            if (__builtin_cpu_supports("avx2"))
+            {
+                CUNIT_ASSERT_INT_EQ(keysLowerBoundAvx2(keys, count, data), keysLowerBoundScalar(keys, count, data));
+                CUNIT_ASSERT_INT_EQ(keysUpperBoundAvx2(keys, count, data), keysUpperBoundScalar(keys, count, data));
+            }
+#endif
+        }
+    }
+}
+
+CUNIT_TEST(vector_search_extreme_values)
+{
+    int keys[KEY_SEARCH_WIDTH];
+    for (int i = 0; i < KEY_SEARCH_WIDTH; ++i)
+    {
+        keys[i] = i < KEY_SEARCH_WIDTH / 2 ? INT_MIN : INT_MAX;
+    }
+
+    CUNIT_ASSERT_INT_EQ(keysLowerBound(keys, KEY_SEARCH_WIDTH, INT_MIN), 0);
+    CUNIT_ASSERT_INT_EQ(keysUpperBound(keys, KEY_SEARCH_WIDTH, INT_MIN), KEY_SEARCH_WIDTH / 2);
+    CUNIT_ASSERT_INT_EQ(keysLowerBound(keys, KEY_SEARCH_WIDTH, INT_MAX), KEY_SEARCH_WIDTH / 2);
+    CUNIT_ASSERT_INT_EQ(keysUpperBound(keys, KEY_SEARCH_WIDTH, INT_MAX), KEY_SEARCH_WIDTH);
+    CUNIT_ASSERT_INT_EQ(keysUpperBound(keys, 3, INT_MAX), 3);
+}
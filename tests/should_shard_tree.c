@@ -0,0 +1,191 @@
+#include <omp.h>
+#include <limits.h>
+
+#include "../external/cunit.h"
+#include "../sharded_tree.h"
+#include "test_helpers.h"
+
+static bool stop_after_three(int data, void* context)
+{
+    (void)data;
+    return ++*(int*)context < 3;
+}
+
+CUNIT_TEST(sharded_insert_search_delete)
+{
+    ShardMode modes[] = { SHARD_BY_RANGE, SHARD_BY_HASH };
+    for (int m = 0; m < 2; ++m)
+    {
+        ShardedTree* tree = shardedCreate(4, modes[m]);
+        int values[] = { 10, 5, 15, INT_MIN, 7, INT_MAX, -18, 10 };
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+        {
+            shardedInsert(tree, values[i]);
+        }
+
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+        {
+            CUNIT_ASSERT_TRUE(shardedSearch(tree, values[i]));
+        }
+        CUNIT_ASSERT_FALSE(shardedSearch(tree, 11));
+        CUNIT_ASSERT_INT_EQ(shardedCount(tree), 8);
+
+        int min = 0;
+        CUNIT_ASSERT_TRUE(shardedFindMin(tree, &min));
+        CUNIT_ASSERT_INT_EQ(min, INT_MIN);
+
+        CUNIT_ASSERT_TRUE(shardedDelete(tree, 10));
+        CUNIT_ASSERT_TRUE(shardedSearch(tree, 10));
+        CUNIT_ASSERT_TRUE(shardedDelete(tree, 10));
+        CUNIT_ASSERT_FALSE(shardedDelete(tree, 10));
+        CUNIT_ASSERT_TRUE(shardedDelete(tree, INT_MIN));
+        CUNIT_ASSERT_TRUE(shardedFindMin(tree, &min));
+        CUNIT_ASSERT_INT_EQ(min, -18);
+
+        shardedFree(tree);
+    }
+}
+
+CUNIT_TEST(sharded_range_scan_is_ordered)
+{
+    ShardedTree* tree = shardedCreate(8, SHARD_BY_RANGE);
+    for (int i = 0; i < 1000; ++i)
+    {
+        shardedInsert(tree, (i * 7919) % 1000 - 500);
+    }
+
+    int values[1000];
+    Buffer buffer = { values, 0, 1000 };
+    CUNIT_ASSERT_INT_EQ(shardedRangeScan(tree, -100, 99, collect, &buffer), 200);
+    for (int i = 0; i < 200; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(values[i], i - 100);
+    }
+
+    int seen = 0;
+    CUNIT_ASSERT_INT_EQ(shardedRangeScan(tree, INT_MIN, INT_MAX, stop_after_three, &seen), 3);
+
+    shardedFree(tree);
+}
+
+CUNIT_TEST(sharded_rebalance_moves_hot_range)
+{
+    ShardedTree* tree = shardedCreate(4, SHARD_BY_RANGE);
+
+    // All the values land in one shard at first
+    for (int i = 0; i < 1000; ++i)
+    {
+        shardedInsert(tree, i);
+    }
+    CUNIT_ASSERT_TRUE(shardedRebalance(tree));
+
+    // The counters started over, so an idle tree is not rebalanced
+    CUNIT_ASSERT_FALSE(shardedRebalance(tree));
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        CUNIT_ASSERT_TRUE(shardedSearch(tree, i));
+    }
+    CUNIT_ASSERT_TRUE(shardedRebalance(tree));
+
+    int values[1000];
+    Buffer buffer = { values, 0, 1000 };
+    CUNIT_ASSERT_INT_EQ(shardedRangeScan(tree, INT_MIN, INT_MAX, collect, &buffer), 1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(values[i], i);
+    }
+
+    // Copies of a value are never split between shards
+    ShardedTree* copies = shardedCreate(2, SHARD_BY_RANGE);
+    for (int i = 0; i < 10; ++i)
+    {
+        shardedInsert(copies, 7);
+    }
+    CUNIT_ASSERT_FALSE(shardedRebalance(copies));
+    CUNIT_ASSERT_INT_EQ(shardedCount(copies), 10);
+
+    shardedFree(copies);
+    shardedFree(tree);
+}
+
+CUNIT_TEST(sharded_thread_safe_mixed)
+{
+    ShardMode modes[] = { SHARD_BY_RANGE, SHARD_BY_HASH };
+    for (int m = 0; m < 2; ++m)
+    {
+        ShardedTree* tree = shardedCreate(8, modes[m]);
+        for (int i = 0; i < 10000; i += 3)
+        {
+            shardedInsert(tree, i);
+        }
+
+        int N = 10000;
+        #pragma omp parallel
+        {
+            #pragma omp single
+            {
+                #pragma omp taskloop nogroup
+                for (int i = 1; i < N; i++)
+                {
+                    if (i % 3 != 0)
+                    {
+                        shardedInsert(tree, i);
+                    }
+                }
+
+                #pragma omp taskloop nogroup
+                for (int j = 1; j < N; j++)
+                {
+                    if (j % 3 == 0)
+                    {
+                        shardedDelete(tree, j);
+                    }
+                }
+
+                #pragma omp taskloop nogroup
+                for (int k = 1; k < N; k++)
+                {
+                    int min;
+                    shardedSearch(tree, k);
+                    shardedFindMin(tree, &min);
+                    if (k % 100 == 0)
+                    {
+                        shardedRebalance(tree);
+                    }
+                }
+            }
+        }
+
+        for (int i = 1; i < N; ++i)
+        {
+            CUNIT_ASSERT_INT_EQ(shardedSearch(tree, i), i % 3 != 0);
+        }
+        int min = -1;
+        CUNIT_ASSERT_TRUE(shardedFindMin(tree, &min));
+        CUNIT_ASSERT_INT_EQ(min, 0);
+
+        shardedFree(tree);
+    }
+}
+
+CUNIT_TEST(sharded_empties_and_refills_shards)
+{
+    ShardedTree* tree = shardedCreate(4, SHARD_BY_HASH);
+
+    // Every value goes in and out many times, so shards keep losing and getting their root
+    int failures = 0;
+#pragma omp parallel for reduction(+ : failures)
+    for (int i = 0; i < 20000; ++i)
+    {
+        shardedInsert(tree, i % 16);
+        failures += !shardedDelete(tree, i % 16);
+    }
+
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    CUNIT_ASSERT_INT_EQ(shardedCount(tree), 0);
+    int min = 0;
+    CUNIT_ASSERT_FALSE(shardedFindMin(tree, &min));
+
+    shardedFree(tree);
+}
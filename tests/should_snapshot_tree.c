@@ -0,0 +1,147 @@
+#include <omp.h>
+
+#include "../external/cunit.h"
+#include "../versioned_tree.h"
+#include "../epoch.h"
+
+typedef struct ScanCheck
+{
+    int expected;
+    int failures;
+} ScanCheck;
+
+// The values of the scans below are 0, 1, 2, ... with no gaps
+static bool check_next(int data, void* context)
+{
+    ScanCheck* check = (ScanCheck*)context;
+    check->failures += data != check->expected;
+    check->expected++;
+    return true;
+}
+
+CUNIT_TEST(snapshot_keep_old_version)
+{
+    VersionedTree* tree = versionedCreate();
+    for (int i = 0; i < 100; ++i)
+    {
+        versionedInsert(tree, i);
+    }
+
+    TreeSnapshot* snapshot = treeSnapshot(tree);
+    for (int i = 0; i < 100; i += 2)
+    {
+        CUNIT_ASSERT_TRUE(versionedDelete(tree, i));
+    }
+    versionedInsert(tree, -5);
+    CUNIT_ASSERT_FALSE(versionedDelete(tree, 0));
+
+    // The snapshot still sees every value, the tree sees the changes
+    ScanCheck check = { 0, 0 };
+    CUNIT_ASSERT_INT_EQ(snapshotScan(snapshot, 0, 99, check_next, &check), 100);
+    CUNIT_ASSERT_INT_EQ(check.failures, 0);
+    CUNIT_ASSERT_TRUE(snapshotSearch(snapshot, 50));
+    CUNIT_ASSERT_FALSE(snapshotSearch(snapshot, -5));
+    CUNIT_ASSERT_FALSE(versionedSearch(tree, 50));
+    CUNIT_ASSERT_TRUE(versionedSearch(tree, 51));
+
+    int min = 0;
+    CUNIT_ASSERT_TRUE(snapshotFindMin(snapshot, &min));
+    CUNIT_ASSERT_INT_EQ(min, 0);
+
+    TreeSnapshot* newer = treeSnapshot(tree);
+    CUNIT_ASSERT_TRUE(snapshotFindMin(newer, &min));
+    CUNIT_ASSERT_INT_EQ(min, -5);
+
+    // The snapshots outlive the tree
+    versionedFree(tree);
+    CUNIT_ASSERT_TRUE(snapshotSearch(snapshot, 98));
+    CUNIT_ASSERT_TRUE(snapshotSearch(newer, 99));
+    snapshotRelease(snapshot);
+    snapshotRelease(newer);
+    epochSynchronize();
+}
+
+CUNIT_TEST(snapshot_duplicates_and_ranges)
+{
+    VersionedTree* tree = versionedCreate();
+    TreeSnapshot* empty = treeSnapshot(tree);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        versionedInsert(tree, 7);
+        versionedInsert(tree, i);
+    }
+    CUNIT_ASSERT_TRUE(versionedDelete(tree, 7));
+
+    TreeSnapshot* snapshot = treeSnapshot(tree);
+    ScanCheck check = { 7, 0 };
+    CUNIT_ASSERT_INT_EQ(snapshotScan(snapshot, 3, 100, check_next, &check), 2);
+    CUNIT_ASSERT_INT_EQ(snapshotScan(snapshot, 1, 2, check_next, &check), 2);
+    CUNIT_ASSERT_INT_EQ(snapshotScan(snapshot, 3, 6, check_next, &check), 0);
+
+    int min = 0;
+    CUNIT_ASSERT_FALSE(snapshotFindMin(empty, &min));
+    CUNIT_ASSERT_INT_EQ(snapshotScan(empty, 0, 10, check_next, &check), 0);
+
+    snapshotRelease(empty);
+    snapshotRelease(snapshot);
+    versionedFree(tree);
+}
+
+CUNIT_TEST(snapshot_consistent_under_writes)
+{
+    VersionedTree* tree = versionedCreate();
+    int failures = 0;
+
+    // One thread inserts the values in order, so any consistent version holds exactly 0 .. k - 1 for some k
+#pragma omp parallel reduction(+:failures)
+    {
+        if (omp_get_thread_num() == 0)
+        {
+            for (int i = 0; i < 20000; ++i)
+            {
+                versionedInsert(tree, i);
+            }
+        }
+        else
+        {
+            for (int round = 0; round < 200; ++round)
+            {
+                TreeSnapshot* snapshot = treeSnapshot(tree);
+                ScanCheck check = { 0, 0 };
+                const size_t count = snapshotScan(snapshot, 0, 20000, check_next, &check);
+                failures += check.failures;
+                failures += count > 0 && !snapshotSearch(snapshot, (int)count - 1);
+                failures += snapshotSearch(snapshot, (int)count);
+                failures += count > 0 && !versionedSearch(tree, (int)count - 1);
+                snapshotRelease(snapshot);
+            }
+        }
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    // Concurrent writers and deletes
+#pragma omp parallel for reduction(+:failures)
+    for (int i = 0; i < 20000; ++i)
+    {
+        if (i % 2)
+        {
+            failures += !versionedDelete(tree, i);
+        }
+        else
+        {
+            versionedInsert(tree, i);
+        }
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    // Even values now have two copies, and odd values none
+    for (int i = 0; i < 20000; ++i)
+    {
+        CUNIT_ASSERT_TRUE(versionedSearch(tree, i) == (i % 2 == 0));
+        CUNIT_ASSERT_TRUE(versionedDelete(tree, i) == (i % 2 == 0));
+        CUNIT_ASSERT_TRUE(versionedSearch(tree, i) == (i % 2 == 0));
+    }
+
+    versionedFree(tree);
+}
@@ -0,0 +1,268 @@
+#include <omp.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include "../external/cunit.h"
+#include "../versioned_tree.h"
+#include "../epoch.h"
+#include "test_helpers.h"
+
+static bool skip(int data, void* context)
+{
+    (void)data;
+    (void)context;
+    return true;
+}
+
+static size_t count_tree(VersionedTree* tree)
+{
+    TreeSnapshot* snapshot = treeSnapshot(tree);
+    const size_t count = snapshotScan(snapshot, INT_MIN, INT_MAX, skip, NULL);
+    snapshotRelease(snapshot);
+    return count;
+}
+
+// Returns the number of values of the tree that differ from the expected sorted array, or -1 if the counts differ
+static long compare_tree(VersionedTree* tree, const int* expected, size_t n)
+{
+    // One more slot than expected, so that a tree with more values fills it and fails the count
+    Buffer buffer = { (int*)malloc((n + 1) * sizeof(int)), 0, n + 1 };
+    TreeSnapshot* snapshot = treeSnapshot(tree);
+    const size_t count = snapshotScan(snapshot, INT_MIN, INT_MAX, collect, &buffer);
+    snapshotRelease(snapshot);
+
+    long failures = -1;
+    if (count == n)
+    {
+        failures = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            failures += buffer.values[i] != expected[i];
+        }
+    }
+    free(buffer.values);
+    return failures;
+}
+
+CUNIT_TEST(split_join_keep_values)
+{
+    // 0 .. 999 with a second copy of every even value and a third copy of 500
+    VersionedTree* tree = versionedCreate();
+    int expected[1501];
+    size_t n = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        versionedInsert(tree, i * 7919 % 1000);
+        if (i % 2 == 0)
+        {
+            versionedInsert(tree, i);
+        }
+    }
+    versionedInsert(tree, 500);
+    for (int i = 0; i < 1000; ++i)
+    {
+        expected[n++] = i;
+        if (i % 2 == 0)
+        {
+            expected[n++] = i;
+        }
+        if (i == 500)
+        {
+            expected[n++] = i;
+        }
+    }
+
+    // Every copy of the key goes up
+    VersionedTree* lo = NULL, *hi = NULL;
+    versionedSplit(tree, 500, &lo, &hi);
+    CUNIT_ASSERT_INT_EQ(compare_tree(lo, expected, 750), 0);
+    CUNIT_ASSERT_INT_EQ(compare_tree(hi, expected + 750, 751), 0);
+    CUNIT_ASSERT_FALSE(versionedSearch(lo, 500));
+    CUNIT_ASSERT_TRUE(versionedSearch(hi, 500));
+
+    // The tree itself does not change
+    CUNIT_ASSERT_INT_EQ(compare_tree(tree, expected, n), 0);
+
+    VersionedTree* joined = versionedJoin(lo, hi);
+    CUNIT_ASSERT_TRUE(joined != NULL);
+    CUNIT_ASSERT_INT_EQ(compare_tree(joined, expected, n), 0);
+    CUNIT_ASSERT_TRUE(versionedJoin(hi, lo) == NULL);
+
+    // Splits at the ends and joins with empty trees
+    VersionedTree* empty = NULL, *all = NULL;
+    versionedSplit(joined, -1, &empty, &all);
+    CUNIT_ASSERT_INT_EQ(compare_tree(empty, expected, 0), 0);
+    CUNIT_ASSERT_INT_EQ(compare_tree(all, expected, n), 0);
+    VersionedTree* same = versionedJoin(empty, all);
+    CUNIT_ASSERT_INT_EQ(compare_tree(same, expected, n), 0);
+    versionedInsert(same, 1000);
+    CUNIT_ASSERT_FALSE(versionedSearch(all, 1000));
+
+    versionedFree(tree);
+    versionedFree(lo);
+    versionedFree(hi);
+    versionedFree(joined);
+    versionedFree(empty);
+    versionedFree(all);
+    versionedFree(same);
+    epochSynchronize();
+}
+
+CUNIT_TEST(split_join_uneven_heights)
+{
+    // Joining a single value to a large tree goes down the side of the large tree
+    VersionedTree* big = versionedCreate();
+    VersionedTree* small = versionedCreate();
+    static int expected[20001];
+    for (int i = 0; i < 20000; ++i)
+    {
+        versionedInsert(big, i);
+        expected[i] = i;
+    }
+    versionedInsert(small, 20000);
+    expected[20000] = 20000;
+
+    VersionedTree* joined = versionedJoin(big, small);
+    CUNIT_ASSERT_INT_EQ(compare_tree(joined, expected, 20001), 0);
+    versionedFree(joined);
+
+    versionedDelete(small, 20000);
+    versionedInsert(small, -1);
+    joined = versionedJoin(small, big);
+    CUNIT_ASSERT_INT_EQ(count_tree(joined), 20001);
+    CUNIT_ASSERT_TRUE(versionedSearch(joined, -1));
+    CUNIT_ASSERT_TRUE(versionedSearch(joined, 19999));
+
+    versionedFree(joined);
+    versionedFree(big);
+    versionedFree(small);
+    epochSynchronize();
+}
+
+CUNIT_TEST(set_operations_count_copies)
+{
+    // a holds 0 .. 39999 and a second copy of every multiple of 3, b holds the even values and 40000 .. 40999
+    VersionedTree* a = versionedCreate();
+    VersionedTree* b = versionedCreate();
+    for (int i = 0; i < 40000; ++i)
+    {
+        versionedInsert(a, i);
+        if (i % 3 == 0)
+        {
+            versionedInsert(a, i);
+        }
+        if (i % 2 == 0)
+        {
+            versionedInsert(b, i);
+        }
+    }
+    for (int i = 40000; i < 41000; ++i)
+    {
+        versionedInsert(b, i);
+    }
+
+    int* expected = (int*)malloc(100000 * sizeof(int));
+    size_t n = 0;
+    for (int i = 0; i < 41000; ++i)
+    {
+        const int copies = (i < 40000) + (i < 40000 && i % 3 == 0) + (i % 2 == 0 || i >= 40000);
+        for (int j = 0; j < copies; ++j)
+        {
+            expected[n++] = i;
+        }
+    }
+    VersionedTree* both = versionedUnion(a, b);
+    CUNIT_ASSERT_INT_EQ(compare_tree(both, expected, n), 0);
+
+    n = 0;
+    for (int i = 0; i < 40000; i += 2)
+    {
+        expected[n++] = i;
+    }
+    VersionedTree* common = versionedIntersection(a, b);
+    CUNIT_ASSERT_INT_EQ(compare_tree(common, expected, n), 0);
+
+    n = 0;
+    for (int i = 0; i < 40000; ++i)
+    {
+        const int copies = 1 + (i % 3 == 0) - (i % 2 == 0);
+        for (int j = 0; j < copies; ++j)
+        {
+            expected[n++] = i;
+        }
+    }
+    VersionedTree* rest = versionedDifference(a, b);
+    CUNIT_ASSERT_INT_EQ(compare_tree(rest, expected, n), 0);
+
+    // With an empty tree
+    VersionedTree* empty = versionedCreate();
+    VersionedTree* none = versionedIntersection(a, empty);
+    CUNIT_ASSERT_INT_EQ(compare_tree(none, expected, 0), 0);
+    VersionedTree* nothing = versionedDifference(empty, b);
+    CUNIT_ASSERT_INT_EQ(compare_tree(nothing, expected, 0), 0);
+
+    free(expected);
+    versionedFree(a);
+    versionedFree(b);
+    versionedFree(both);
+    versionedFree(common);
+    versionedFree(rest);
+    versionedFree(empty);
+    versionedFree(none);
+    versionedFree(nothing);
+    epochSynchronize();
+}
+
+CUNIT_TEST(set_operations_under_writes)
+{
+    VersionedTree* a = versionedCreate();
+    VersionedTree* b = versionedCreate();
+    for (int i = 0; i < 20000; ++i)
+    {
+        versionedInsert(a, i);
+        versionedInsert(b, i + 10000);
+    }
+
+    // A writer inserts into a in order while others combine it. Every result is taken from one version of a, so the
+    // intersection holds 10000 .. k - 1 and the difference holds k .. 29999 for some k.
+    int failures = 0;
+#pragma omp parallel reduction(+:failures)
+    {
+        if (omp_get_thread_num() == 0)
+        {
+            for (int i = 20000; i < 30000; ++i)
+            {
+                versionedInsert(a, i);
+            }
+        }
+        else
+        {
+            for (int round = 0; round < 5; ++round)
+            {
+                VersionedTree* common = versionedIntersection(a, b);
+                VersionedTree* rest = versionedDifference(b, a);
+                const size_t count = count_tree(common);
+                failures += count < 10000 || !versionedSearch(common, 10000 + (int)count - 1);
+                failures += versionedSearch(common, 9999) || versionedSearch(common, 10000 + (int)count);
+
+                const size_t others = count_tree(rest);
+                failures += others > 0 && !versionedSearch(rest, 30000 - (int)others);
+                failures += versionedSearch(rest, 30000 - (int)others - 1);
+                versionedFree(common);
+                versionedFree(rest);
+            }
+        }
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    VersionedTree* rest = versionedDifference(b, a);
+    int min = 0;
+    TreeSnapshot* snapshot = treeSnapshot(rest);
+    CUNIT_ASSERT_FALSE(snapshotFindMin(snapshot, &min));
+    snapshotRelease(snapshot);
+
+    versionedFree(rest);
+    versionedFree(a);
+    versionedFree(b);
+    epochSynchronize();
+}
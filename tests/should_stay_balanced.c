@@ -0,0 +1,169 @@
+#include <omp.h>
+#include <limits.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+
+// Checks the search order, the stored heights and the AVL property. Returns the height, or -1 if the tree is invalid.
+static int avl_height(TreeNode* root, long long min, long long max)
+{
+    if (root == NULL)
+    {
+        return 0;
+    }
+    if (root->data < min || root->data > max)
+    {
+        return -1;
+    }
+
+    int left = avl_height(root->left, min, root->data);
+    int right = avl_height(root->right, root->data, max);
+    if (left < 0 || right < 0 || left - right > 1 || right - left > 1)
+    {
+        return -1;
+    }
+
+    int height = 1 + (left > right ? left : right);
+    return root->height == height ? height : -1;
+}
+
+static int is_valid_avl(TreeNode* root)
+{
+    return avl_height(root, INT_MIN, INT_MAX) >= 0;
+}
+
+CUNIT_TEST(balanced_sequential_insertion)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 1000; ++i)
+    {
+        CUNIT_ASSERT_PTR_EQ(insertBalanced(tree, i), tree);
+    }
+
+    CUNIT_ASSERT_TRUE(is_valid_avl(tree));
+    // An AVL tree with 1000 nodes is at most 1.44 * log2(1000) high
+    CUNIT_ASSERT_INT_LEQ(tree->height, 14);
+    for (int i = 0; i < 1000; ++i)
+    {
+        CUNIT_ASSERT_TRUE(searchNode(tree, i));
+    }
+    CUNIT_ASSERT_INT_EQ(findMin(tree)->data, 0);
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(balanced_deletion)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 1000; ++i)
+    {
+        insertBalanced(tree, i);
+    }
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            tree = deleteBalanced(tree, i);
+        }
+    }
+
+    CUNIT_ASSERT_TRUE(is_valid_avl(tree));
+    for (int i = 0; i < 1000; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(searchNode(tree, i), i % 3 != 0);
+    }
+
+    // Deleting a missing value leaves the tree untouched
+    CUNIT_ASSERT_PTR_EQ(deleteBalanced(tree, 3), tree);
+    CUNIT_ASSERT_TRUE(is_valid_avl(tree));
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(balanced_delete_until_empty)
+{
+    TreeNode* tree = createNode(50);
+    for (int i = 0; i < 100; ++i)
+    {
+        if (i != 50)
+        {
+            insertBalanced(tree, i);
+        }
+    }
+    for (int i = 99; i >= 0; --i)
+    {
+        tree = deleteBalanced(tree, i);
+        CUNIT_ASSERT_TRUE(is_valid_avl(tree));
+    }
+
+    CUNIT_ASSERT_PTR_NULL(tree);
+}
+
+CUNIT_TEST(balanced_thread_safe_insertion)
+{
+    TreeNode* tree = createNode(0);
+#pragma omp parallel for schedule(static, 6)
+    for (int i = 1; i < 1000; ++i)
+    {
+        insertBalanced(tree, i);
+    }
+
+    CUNIT_ASSERT_TRUE(is_valid_avl(tree));
+    for (int i = 0; i < 1000; ++i)
+    {
+        CUNIT_ASSERT_TRUE(searchNode(tree, i));
+    }
+
+    freeTree(tree);
+}
+
+CUNIT_TEST(balanced_thread_safe_mixed)
+{
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < 1000; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            insertBalanced(tree, i);
+        }
+    }
+
+    int N = 1000;
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            #pragma omp taskloop nogroup
+            for (int i = 1; i < N; i++)
+            {
+                if (i % 3 != 0)
+                {
+                    insertBalanced(tree, i);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int j = 1; j < N; j++)
+            {
+                if (j % 3 == 0)
+                {
+                    deleteBalanced(tree, j);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int k = 1; k < N; k++)
+            {
+                searchNode(tree, k);
+            }
+        }
+    }
+
+    CUNIT_ASSERT_TRUE(is_valid_avl(tree));
+    for (int i = 1; i < N; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(searchNode(tree, i), i % 3 != 0);
+    }
+
+    freeTree(tree);
+}
@@ -0,0 +1,178 @@
+#include <omp.h>
+#include <string.h>
+
+#include "../external/cunit.h"
+
+#define TREE_NAME IntMap
+#define TREE_KEY int
+#define TREE_VALUE long long
+#include "../generic_tree.h"
+
+#define TREE_NAME NameMap
+#define TREE_KEY const char*
+#define TREE_VALUE int
+#define TREE_COMPARE(a, b) strcmp(a, b)
+#include "../generic_tree.h"
+
+// Points on a line, ordered by x and then by y
+typedef struct Point
+{
+    int x;
+    int y;
+} Point;
+
+static inline int compare_points(Point a, Point b)
+{
+    return a.x != b.x ? (a.x > b.x) - (a.x < b.x) : (a.y > b.y) - (a.y < b.y);
+}
+
+#define TREE_NAME PointMap
+#define TREE_KEY Point
+#define TREE_VALUE double
+#define TREE_COMPARE(a, b) compare_points(a, b)
+#include "../generic_tree.h"
+
+CUNIT_TEST(generic_int_keys_with_values)
+{
+    IntMapNode* tree = NULL;
+    int keys[] = { 10, 5, 15, 3, 7, 12, 18 };
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i)
+    {
+        tree = IntMapInsert(tree, keys[i], keys[i] * 100LL);
+    }
+
+    long long value = 0;
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i)
+    {
+        CUNIT_ASSERT_TRUE(IntMapSearch(tree, keys[i], &value));
+        CUNIT_ASSERT_INT_EQ(value, keys[i] * 100LL);
+    }
+    CUNIT_ASSERT_FALSE(IntMapSearch(tree, 11, &value));
+
+    int min = 0;
+    CUNIT_ASSERT_TRUE(IntMapFindMin(tree, &min, &value));
+    CUNIT_ASSERT_INT_EQ(min, 3);
+    CUNIT_ASSERT_INT_EQ(value, 300);
+
+    // Deleting the root, which has two children, keeps everything else
+    tree = IntMapDelete(tree, 10);
+    CUNIT_ASSERT_FALSE(IntMapSearch(tree, 10, NULL));
+    CUNIT_ASSERT_TRUE(IntMapSearch(tree, 12, &value));
+    CUNIT_ASSERT_INT_EQ(value, 1200);
+
+    for (size_t i = 1; i < sizeof(keys) / sizeof(keys[0]); ++i)
+    {
+        tree = IntMapDelete(tree, keys[i]);
+    }
+    CUNIT_ASSERT_TRUE(tree == NULL);
+    CUNIT_ASSERT_FALSE(IntMapFindMin(tree, &min, &value));
+}
+
+CUNIT_TEST(generic_duplicate_keys)
+{
+    IntMapNode* tree = IntMapCreate(4, 1);
+    tree = IntMapInsert(tree, 4, 2);
+
+    long long value = 0;
+    tree = IntMapDelete(tree, 4);
+    CUNIT_ASSERT_TRUE(IntMapSearch(tree, 4, &value));
+    tree = IntMapDelete(tree, 4);
+    CUNIT_ASSERT_FALSE(IntMapSearch(tree, 4, &value));
+    CUNIT_ASSERT_TRUE(tree == NULL);
+}
+
+CUNIT_TEST(generic_custom_comparators)
+{
+    NameMapNode* names = NULL;
+    const char* words[] = { "pear", "apple", "fig", "kiwi", "banana" };
+    for (int i = 0; i < 5; ++i)
+    {
+        names = NameMapInsert(names, words[i], i);
+    }
+
+    char key[8] = "fig";
+    int index = -1;
+    CUNIT_ASSERT_TRUE(NameMapSearch(names, key, &index));
+    CUNIT_ASSERT_INT_EQ(index, 2);
+    CUNIT_ASSERT_FALSE(NameMapSearch(names, "grape", &index));
+
+    const char* first = NULL;
+    CUNIT_ASSERT_TRUE(NameMapFindMin(names, &first, NULL));
+    CUNIT_ASSERT_TRUE(strcmp(first, "apple") == 0);
+    NameMapFree(names);
+
+    PointMapNode* points = NULL;
+    for (int x = 0; x < 10; ++x)
+    {
+        for (int y = 0; y < 10; ++y)
+        {
+            points = PointMapInsert(points, (Point){ (x * 7) % 10, y }, x + y / 10.0);
+        }
+    }
+
+    double distance = 0;
+    CUNIT_ASSERT_TRUE(PointMapSearch(points, (Point){ 1, 9 }, &distance));
+    CUNIT_ASSERT_TRUE(distance == 3.9);
+    CUNIT_ASSERT_FALSE(PointMapSearch(points, (Point){ 1, 10 }, &distance));
+
+    Point min;
+    CUNIT_ASSERT_TRUE(PointMapFindMin(points, &min, NULL));
+    CUNIT_ASSERT_INT_EQ(min.x, 0);
+    CUNIT_ASSERT_INT_EQ(min.y, 0);
+    PointMapFree(points);
+}
+
+CUNIT_TEST(generic_thread_safe_mixed)
+{
+    IntMapNode* tree = IntMapCreate(0, 0);
+    for (int i = 3; i < 10000; i += 3)
+    {
+        IntMapInsert(tree, i, -i);
+    }
+
+    int N = 10000;
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            #pragma omp taskloop nogroup
+            for (int i = 1; i < N; i++)
+            {
+                if (i % 3 != 0)
+                {
+                    IntMapInsert(tree, i, -i);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int j = 1; j < N; j++)
+            {
+                if (j % 3 == 0)
+                {
+                    IntMapDelete(tree, j);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int k = 1; k < N; k++)
+            {
+                long long value;
+                int min;
+                IntMapSearch(tree, k, &value);
+                IntMapFindMin(tree, &min, &value);
+            }
+        }
+    }
+
+    for (int i = 1; i < N; ++i)
+    {
+        long long value = 0;
+        CUNIT_ASSERT_INT_EQ(IntMapSearch(tree, i, &value), i % 3 != 0);
+        if (i % 3 != 0)
+        {
+            CUNIT_ASSERT_INT_EQ(value, -i);
+        }
+    }
+
+    IntMapFree(tree);
+}
@@ -0,0 +1,218 @@
+#include <omp.h>
+
+#include "../external/cunit.h"
+#include "../btree.h"
+
+CUNIT_TEST(btree_insert_and_search)
+{
+    BTree* tree = btreeCreate();
+    int values[] = { 10, 5, 15, 3, 7, 12, 18 };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        btreeInsert(tree, values[i]);
+    }
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        CUNIT_ASSERT_TRUE(btreeSearch(tree, values[i]));
+    }
+    CUNIT_ASSERT_FALSE(btreeSearch(tree, 1));
+    CUNIT_ASSERT_FALSE(btreeSearch(tree, 11));
+    CUNIT_ASSERT_FALSE(btreeSearch(tree, 20));
+
+    int min = 0;
+    CUNIT_ASSERT_TRUE(btreeFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, 3);
+
+    btreeFree(tree);
+}
+
+CUNIT_TEST(btree_duplicates)
+{
+    BTree* tree = btreeCreate();
+    btreeInsert(tree, 10);
+    btreeInsert(tree, 10);
+
+    CUNIT_ASSERT_TRUE(btreeDelete(tree, 10));
+    CUNIT_ASSERT_TRUE(btreeSearch(tree, 10));
+    CUNIT_ASSERT_TRUE(btreeDelete(tree, 10));
+    CUNIT_ASSERT_FALSE(btreeSearch(tree, 10));
+    CUNIT_ASSERT_FALSE(btreeDelete(tree, 10));
+
+    int min = 0;
+    CUNIT_ASSERT_FALSE(btreeFindMin(tree, &min));
+
+    btreeFree(tree);
+}
+
+CUNIT_TEST(btree_large)
+{
+    BTree* tree = btreeCreate();
+    for (int i = 0; i < 100000; ++i)
+    {
+        btreeInsert(tree, (i * 7919) % 100000);
+    }
+    for (int i = 0; i < 100000; i += 3)
+    {
+        CUNIT_ASSERT_TRUE(btreeDelete(tree, i));
+    }
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(btreeSearch(tree, i), i % 3 != 0);
+    }
+
+    // The first leaves are empty now, findMin has to skip them
+    for (int i = 1; i < 1000; ++i)
+    {
+        btreeDelete(tree, i);
+    }
+    int min = 0;
+    CUNIT_ASSERT_TRUE(btreeFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, 1000);
+
+    btreeFree(tree);
+}
+
+CUNIT_TEST(btree_merge_empty_leaves)
+{
+    // Emptying the tree merges its leaves, and the tree takes values again afterwards
+    BTree* tree = btreeCreate();
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 20000; ++i)
+        {
+            btreeInsert(tree, (i * 7919) % 20000);
+        }
+        for (int i = 0; i < 20000; ++i)
+        {
+            CUNIT_ASSERT_TRUE(btreeDelete(tree, round == 1 ? 19999 - i : (i * 31) % 20000));
+        }
+
+        int min = 0;
+        CUNIT_ASSERT_FALSE(btreeFindMin(tree, &min));
+        CUNIT_ASSERT_FALSE(btreeSearch(tree, 0));
+    }
+
+    // Deleting every other range of values leaves the others
+    for (int i = 0; i < 20000; ++i)
+    {
+        btreeInsert(tree, i);
+    }
+    for (int i = 0; i < 20000; ++i)
+    {
+        if (i / 100 % 2 == 0)
+        {
+            btreeDelete(tree, i);
+        }
+    }
+    for (int i = 0; i < 20000; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(btreeSearch(tree, i), i / 100 % 2 == 1);
+    }
+    int min = 0;
+    CUNIT_ASSERT_TRUE(btreeFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, 100);
+
+    btreeFree(tree);
+}
+
+CUNIT_TEST(btree_thread_safe_merges)
+{
+    // Every thread fills and empties ranges of its own, so leaves are merged while others split
+    BTree* tree = btreeCreate();
+    int failures = 0;
+#pragma omp parallel for schedule(static, 1) reduction(+:failures)
+    for (int block = 0; block < 64; ++block)
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            btreeInsert(tree, block * 1000 + i);
+        }
+        for (int i = 0; i < 500; ++i)
+        {
+            failures += !btreeSearch(tree, block * 1000 + i);
+            if (block % 2 == 0 || i % 2 == 0)
+            {
+                failures += !btreeDelete(tree, block * 1000 + i);
+            }
+        }
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    for (int i = 0; i < 64000; ++i)
+    {
+        failures += btreeSearch(tree, i) != (i / 1000 % 2 == 1 && i % 1000 < 500 && i % 2 == 1);
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+    btreeFree(tree);
+}
+
+CUNIT_TEST(btree_thread_safe_insertion)
+{
+    BTree* tree = btreeCreate();
+#pragma omp parallel for schedule(static, 6)
+    for (int i = 0; i < 10000; ++i)
+    {
+        btreeInsert(tree, i);
+    }
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        CUNIT_ASSERT_TRUE(btreeSearch(tree, i));
+    }
+
+    btreeFree(tree);
+}
+
+CUNIT_TEST(btree_thread_safe_mixed)
+{
+    BTree* tree = btreeCreate();
+    for (int i = 0; i < 10000; i += 3)
+    {
+        btreeInsert(tree, i);
+    }
+
+    int N = 10000;
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            #pragma omp taskloop nogroup
+            for (int i = 1; i < N; i++)
+            {
+                if (i % 3 != 0)
+                {
+                    btreeInsert(tree, i);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int j = 1; j < N; j++)
+            {
+                if (j % 3 == 0)
+                {
+                    btreeDelete(tree, j);
+                }
+            }
+
+            #pragma omp taskloop nogroup
+            for (int k = 1; k < N; k++)
+            {
+                int min;
+                btreeSearch(tree, k);
+                btreeFindMin(tree, &min);
+            }
+        }
+    }
+
+    for (int i = 1; i < N; ++i)
+    {
+        CUNIT_ASSERT_INT_EQ(btreeSearch(tree, i), i % 3 != 0);
+    }
+    int min = -1;
+    CUNIT_ASSERT_TRUE(btreeFindMin(tree, &min));
+    CUNIT_ASSERT_INT_EQ(min, 0);
+
+    btreeFree(tree);
+}
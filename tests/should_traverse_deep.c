@@ -0,0 +1,119 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../external/cunit.h"
+#include "../binary_tree.h"
+
+// Runs a traversal with the standard output sent to a fresh file, and reads the printed values back into out.
+// Returns the number of values that were printed.
+static size_t capture_traversal(void (*traversal)(TreeNode*), TreeNode* root, int* out, size_t capacity)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/should_traverse_deep_XXXXXX");
+    const int fd = mkstemp(path);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    fflush(stdout);
+    const int saved = dup(STDOUT_FILENO);
+    if (freopen(path, "w", stdout) == NULL)
+    {
+        return 0;
+    }
+    traversal(root);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    FILE* file = fopen(path, "r");
+    size_t count = 0;
+    int data;
+    while (file && fscanf(file, "%d", &data) == 1)
+    {
+        if (count < capacity)
+        {
+            out[count] = data;
+        }
+        count++;
+    }
+    if (file)
+    {
+        fclose(file);
+    }
+    remove(path);
+    return count;
+}
+
+CUNIT_TEST(traversal_orders)
+{
+    //        10
+    //      5    15
+    //     3 7  12 18
+    TreeNode* tree = createNode(10);
+    const int values[] = { 5, 15, 3, 7, 12, 18 };
+    for (size_t i = 0; i < 6; ++i)
+    {
+        insertNode(tree, values[i]);
+    }
+
+    const int preorder[] = { 10, 5, 3, 7, 15, 12, 18 };
+    const int postorder[] = { 3, 7, 5, 12, 18, 15, 10 };
+    int out[8];
+
+    CUNIT_ASSERT_INT_EQ(capture_traversal(preorderTraversal, tree, out, 8), 7);
+    CUNIT_ASSERT_MEM_EQ(out, preorder, sizeof(preorder));
+    CUNIT_ASSERT_INT_EQ(capture_traversal(postorderTraversal, tree, out, 8), 7);
+    CUNIT_ASSERT_MEM_EQ(out, postorder, sizeof(postorder));
+
+    // A single node and an empty tree
+    TreeNode* single = createNode(4);
+    CUNIT_ASSERT_INT_EQ(capture_traversal(postorderTraversal, single, out, 8), 1);
+    CUNIT_ASSERT_INT_EQ(out[0], 4);
+    CUNIT_ASSERT_INT_EQ(capture_traversal(preorderTraversal, NULL, out, 8), 0);
+
+    freeTree(tree);
+    freeTree(single);
+}
+
+CUNIT_TEST(traversal_of_degenerate_tree)
+{
+    // Sequential values make the tree a path, one level per value
+    const int n = 20000;
+    TreeNode* tree = createNode(0);
+    for (int i = 1; i < n; ++i)
+    {
+        insertNode(tree, i);
+    }
+
+    int* out = (int*)malloc(n * sizeof(int));
+    int failures = 0;
+
+    // From a worker thread, whose stack is smaller than the one of the main thread
+#pragma omp parallel num_threads(2) reduction(+:failures)
+    {
+        if (omp_get_thread_num() == 1)
+        {
+            failures += capture_traversal(preorderTraversal, tree, out, n) != (size_t)n;
+            for (int i = 0; i < n; ++i)
+            {
+                failures += out[i] != i;
+            }
+
+            failures += capture_traversal(postorderTraversal, tree, out, n) != (size_t)n;
+            for (int i = 0; i < n; ++i)
+            {
+                failures += out[i] != n - 1 - i;
+            }
+        }
+    }
+    CUNIT_ASSERT_INT_EQ(failures, 0);
+
+    free(out);
+    freeTree(tree);
+}
@@ -0,0 +1,41 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../binary_tree.h"
+
+// Collects scanned values into an array, stopping once it is full
+typedef struct Buffer
+{
+    int* values;
+    size_t count;
+    size_t capacity;
+} Buffer;
+
+static inline bool collect(int data, void* context)
+{
+    Buffer* buffer = (Buffer*)context;
+    buffer->values[buffer->count++] = data;
+    return buffer->count < buffer->capacity;
+}
+
+// Checks that every node holds the size of its subtree. Returns the size, or -1 if a node is wrong.
+static inline long subtree_size(const TreeNode* root)
+{
+    if (root == NULL)
+    {
+        return 0;
+    }
+
+    long left = subtree_size(root->left);
+    long right = subtree_size(root->right);
+    if (left < 0 || right < 0 || root->size != (unsigned int)(left + 1 + right))
+    {
+        return -1;
+    }
+    return left + 1 + right;
+}
+
+#endif //TEST_HELPERS_H
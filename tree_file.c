@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "tree_file.h"
+#include "eytzinger.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILE_MAGIC "BSTFILE"
+#define FILE_VERSION 2
+#define FILE_BYTE_ORDER 0x01020304u
+
+/*
+ * The header takes a whole cache line, so the values start on a cache line boundary of the mapped pages. They start
+ * with an unused slot for position 0, so that positions 16i to 16i + 15 share one cache line.
+ */
+typedef struct FileHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint64_t count;
+    char reserved[40];
+} FileHeader;
+
+struct MappedTree {
+    void* map;
+    size_t length;
+    const int* values; // In Eytzinger order, position i of the implicit tree is values[i], values[0] is not used
+    size_t count;
+};
+
+// Read the values in order, save them in the file format, and replace the file with a rename when all is written
+bool treeSave(TreeNode* root, const char* path) {
+    size_t count = 0;
+    int* sorted = eytzingerCollect(root, &count);
+
+    int* values = (int*)malloc((count + 1) * sizeof(int));
+    values[0] = 0;
+    eytzingerFromSorted(sorted, values, count);
+    free(sorted);
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.byteOrder = FILE_BYTE_ORDER;
+    header.version = FILE_VERSION;
+    header.count = count;
+
+    const size_t length = strlen(path);
+    char* temporary = (char*)malloc(length + sizeof(".tmp"));
+    memcpy(temporary, path, length);
+    memcpy(temporary + length, ".tmp", sizeof(".tmp"));
+
+    bool isSaved = false;
+    FILE* file = fopen(temporary, "wb");
+    if (file != NULL) {
+        isSaved = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(values, sizeof(int), count + 1, file) == count + 1 &&
+                  fflush(file) == 0 && fsync(fileno(file)) == 0;
+        isSaved = fclose(file) == 0 && isSaved;
+        isSaved = isSaved && rename(temporary, path) == 0;
+        if (!isSaved) remove(temporary);
+    }
+
+    free(temporary);
+    free(values);
+    return isSaved;
+}
+
+// The file is checked before anything is read from it, so a short or foreign file is refused instead of read past
+MappedTree* treeLoad(const char* path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(FileHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    const size_t length = (size_t)status.st_size;
+    void* map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    const FileHeader* header = (const FileHeader*)map;
+    if (memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header->byteOrder != FILE_BYTE_ORDER ||
+        header->version != FILE_VERSION || header->count >= (length - sizeof(FileHeader)) / sizeof(int) ||
+        length != sizeof(FileHeader) + (header->count + 1) * sizeof(int)) {
+        munmap(map, length);
+        return NULL;
+    }
+
+    MappedTree* tree = (MappedTree*)malloc(sizeof(MappedTree));
+    tree->map = map;
+    tree->length = length;
+    tree->values = (const int*)((const char*)map + sizeof(FileHeader));
+    tree->count = (size_t)header->count;
+
+    return tree;
+}
+
+bool mappedSearch(const MappedTree* tree, const int data) {
+    return eytzingerSearch(tree->values, tree->count, data);
+}
+
+bool mappedFindMin(const MappedTree* tree, int* min) {
+    return eytzingerFindMin(tree->values, tree->count, min);
+}
+
+size_t mappedCount(const MappedTree* tree) {
+    return tree->count;
+}
+
+TreeNode* mappedRestore(const MappedTree* tree) {
+    return eytzingerRestore(tree->values, tree->count);
+}
+
+void mappedClose(MappedTree* tree) {
+    if (tree == NULL) return;
+
+    munmap(tree->map, tree->length);
+    free(tree);
+}
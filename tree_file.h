@@ -0,0 +1,50 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef TREE_FILE_H
+#define TREE_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "binary_tree.h"
+
+/*
+ * Saving a tree to a file and loading it back without inserting the values again.
+ * The file holds a header and then the values as an implicit balanced tree in Eytzinger order: the children of the
+ * value at position i (counting from 1) are at 2i and 2i + 1. An unused slot for position 0 keeps the 16 positions
+ * 4 levels below any position in one cache line. There are no pointers in it, so it is read where it is, through
+ * mmap, and searches walk the mapped pages with no allocation at all. Loading takes the time of mapping the file, and
+ * pages are read from disk only when a search first touches them.
+ *
+ * The file is written in the byte order of the machine, and treeLoad refuses a file of the other byte order.
+ */
+typedef struct MappedTree MappedTree;
+
+/*
+ * This function writes the values of the tree to the file at path, copies included, and returns false if the file
+ * could not be written. It reads the tree with an iterator, so writers may keep working on it.
+ * The values go to a temporary file that replaces the old one only when it is complete.
+ */
+bool treeSave(TreeNode* root, const char* path);
+
+// This function maps a file written by treeSave, returns NULL if it can't be opened or is not a valid file
+MappedTree* treeLoad(const char* path);
+
+// This function checks whether a value exists in a mapped tree. Mapped trees never change, so any thread may search.
+bool mappedSearch(const MappedTree* tree, const int data);
+
+// This function finds the minimal value in a mapped tree, returns false if it is empty
+bool mappedFindMin(const MappedTree* tree, int* min);
+
+// This function returns the number of values in a mapped tree
+size_t mappedCount(const MappedTree* tree);
+
+// This function builds a perfectly balanced binary search tree of the values of a mapped tree, to change them again
+TreeNode* mappedRestore(const MappedTree* tree);
+
+// This function unmaps the file
+void mappedClose(MappedTree* tree);
+
+#endif //TREE_FILE_H
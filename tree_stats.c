@@ -0,0 +1,60 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "tree_stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if TREE_STATS
+
+TreeStatsThread* treeStatsSelf = NULL;
+
+// Records are never freed: a thread that exits leaves its counters behind, and they stay in the totals
+static TreeStatsThread* threads = NULL;
+
+// Create a zeroed record on its own cache lines and push it to the list of all the records
+TreeStatsThread* treeStatsRegister(void) {
+    void* memory = NULL;
+    if (posix_memalign(&memory, 64, sizeof(TreeStatsThread)) != 0) abort();
+
+    TreeStatsThread* thread = (TreeStatsThread*)memory;
+    memset(thread, 0, sizeof(TreeStatsThread));
+
+    thread->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&threads, &thread->next, thread, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+
+    treeStatsSelf = thread;
+    return thread;
+}
+
+// Add up the records. Each counter is read on its own, so a snapshot taken under load is not exact across counters.
+void treeStats(TreeStats* stats) {
+    memset(stats, 0, sizeof(TreeStats));
+
+    for (TreeStatsThread* thread = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+        const TreeStats* counters = &thread->counters;
+
+        stats->operations += __atomic_load_n(&counters->operations, __ATOMIC_RELAXED);
+        stats->nodesVisited += __atomic_load_n(&counters->nodesVisited, __ATOMIC_RELAXED);
+        stats->latchAcquires += __atomic_load_n(&counters->latchAcquires, __ATOMIC_RELAXED);
+        stats->contendedAcquires += __atomic_load_n(&counters->contendedAcquires, __ATOMIC_RELAXED);
+        stats->waitNanos += __atomic_load_n(&counters->waitNanos, __ATOMIC_RELAXED);
+        stats->allocations += __atomic_load_n(&counters->allocations, __ATOMIC_RELAXED);
+
+        const unsigned long long maxPathLength = __atomic_load_n(&counters->maxPathLength, __ATOMIC_RELAXED);
+        if (maxPathLength > stats->maxPathLength) stats->maxPathLength = maxPathLength;
+
+        for (int i = 0; i < TREE_STATS_PATH_BUCKETS; ++i) {
+            stats->pathLengths[i] += __atomic_load_n(&counters->pathLengths[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+#else
+
+// Nothing is counted
+void treeStats(TreeStats* stats) {
+    memset(stats, 0, sizeof(TreeStats));
+}
+
+#endif
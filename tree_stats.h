@@ -0,0 +1,129 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef TREE_STATS_H
+#define TREE_STATS_H
+
+#include <stdbool.h>
+#include <omp.h>
+
+#include "latch.h"
+
+/*
+ * Counters of the binary search tree, compiled in with -DTREE_STATS=1. They are off by default, and then every hook
+ * below is empty and treeStats reports zeros.
+ * Every thread counts in a record of its own, which sits on cache lines that no other thread writes, and treeStats
+ * adds the records up. The counters only grow, so the activity of a period is the difference of two snapshots.
+ *
+ * Operations are insertNode, deleteNode, insertBalanced, deleteBalanced, searchNode and findMin. Their path length is
+ * the number of nodes they visited, retries included. Latches are counted on every node latch the tree takes.
+ */
+#ifndef TREE_STATS
+#define TREE_STATS 0
+#endif
+
+// Path lengths are counted in buckets of powers of two: bucket i holds the lengths in [2^i, 2^(i + 1)), and bucket 0
+// also holds the operations that visited no node
+#define TREE_STATS_PATH_BUCKETS 32
+
+typedef struct TreeStats {
+    unsigned long long operations;
+    unsigned long long nodesVisited;
+    unsigned long long latchAcquires;
+    unsigned long long contendedAcquires; // Acquires that found the latch taken and had to wait
+    unsigned long long waitNanos;         // Time spent waiting in contended acquires
+    unsigned long long allocations;       // Nodes taken from the arena
+    unsigned long long maxPathLength;
+    unsigned long long pathLengths[TREE_STATS_PATH_BUCKETS];
+} TreeStats;
+
+// This function adds up the counters of every thread. The other threads may keep counting while it reads.
+void treeStats(TreeStats* stats);
+
+#if TREE_STATS
+
+// The record of a thread. Only its thread writes it, with atomic stores so that treeStats may read it at any time.
+typedef struct __attribute__((aligned(64))) TreeStatsThread {
+    TreeStats counters;
+    unsigned long long pathLength; // The nodes visited by the current operation, read only by the thread
+    struct TreeStatsThread* next;
+} TreeStatsThread;
+
+extern TreeStatsThread* treeStatsSelf;
+#pragma omp threadprivate(treeStatsSelf)
+
+// This function creates the record of the calling thread
+TreeStatsThread* treeStatsRegister(void);
+
+static inline TreeStatsThread* statsThread(void) {
+    return treeStatsSelf ? treeStatsSelf : treeStatsRegister();
+}
+
+// The record has a single writer, so a load and a store are enough
+static inline void statsAdd(unsigned long long* counter, const unsigned long long n) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static inline void statsBeginOperation(void) {
+    statsThread()->pathLength = 0;
+}
+
+static inline void statsVisit(void) {
+    statsThread()->pathLength++;
+}
+
+static inline void statsEndOperation(void) {
+    TreeStatsThread* thread = statsThread();
+    const unsigned long long length = thread->pathLength;
+
+    int bucket = 0;
+    while (bucket < TREE_STATS_PATH_BUCKETS - 1 && length >> (bucket + 1) != 0) bucket++;
+
+    statsAdd(&thread->counters.operations, 1);
+    statsAdd(&thread->counters.nodesVisited, length);
+    statsAdd(&thread->counters.pathLengths[bucket], 1);
+    if (length > thread->counters.maxPathLength) {
+        __atomic_store_n(&thread->counters.maxPathLength, length, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void statsAllocation(void) {
+    statsAdd(&statsThread()->counters.allocations, 1);
+}
+
+// A latch that can't be taken right away is contended, and we time the wait for it
+static inline void latchAcquireCounted(Latch* latch) {
+    TreeStatsThread* thread = statsThread();
+    statsAdd(&thread->counters.latchAcquires, 1);
+    if (latchTryAcquire(latch)) return;
+
+    const double start = omp_get_wtime();
+    latchAcquire(latch);
+    statsAdd(&thread->counters.contendedAcquires, 1);
+    statsAdd(&thread->counters.waitNanos, (unsigned long long)((omp_get_wtime() - start) * 1e9));
+}
+
+static inline void latchAcquireSharedCounted(Latch* latch) {
+    TreeStatsThread* thread = statsThread();
+    statsAdd(&thread->counters.latchAcquires, 1);
+    if (latchTryAcquireShared(latch)) return;
+
+    const double start = omp_get_wtime();
+    latchAcquireShared(latch);
+    statsAdd(&thread->counters.contendedAcquires, 1);
+    statsAdd(&thread->counters.waitNanos, (unsigned long long)((omp_get_wtime() - start) * 1e9));
+}
+
+#else
+
+static inline void statsBeginOperation(void) {}
+static inline void statsVisit(void) {}
+static inline void statsEndOperation(void) {}
+static inline void statsAllocation(void) {}
+static inline void latchAcquireCounted(Latch* latch) { latchAcquire(latch); }
+static inline void latchAcquireSharedCounted(Latch* latch) { latchAcquireShared(latch); }
+
+#endif
+
+#endif //TREE_STATS_H
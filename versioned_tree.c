@@ -0,0 +1,529 @@
+#include "versioned_tree.h"
+#include "epoch.h"
+#include "latch.h"
+
+#include <omp.h>
+#include <stdlib.h>
+
+// An AVL tree of 2^32 nodes is less than 48 nodes high, so scans keep their path in a fixed stack
+#define MAX_HEIGHT 64
+
+// Set operations work on the two halves in tasks of their own while the second tree is higher than this
+#define SET_TASK_HEIGHT 12
+
+typedef struct VersionedNode {
+    int data;
+    int height;
+    unsigned long references; // One for every parent, snapshot or tree that points to the node
+    const struct VersionedNode* left;
+    const struct VersionedNode* right;
+} VersionedNode;
+
+struct VersionedTree {
+    const VersionedNode* root;
+    Latch writer;
+};
+
+struct TreeSnapshot {
+    const VersionedNode* root;
+};
+
+typedef enum SetOperation {
+    SET_UNION,
+    SET_INTERSECTION,
+    SET_DIFFERENCE
+} SetOperation;
+
+/*
+ * Every function below that returns a node returns a new reference to it, and every node passed as a child is a
+ * reference that the new node takes over. Nodes passed to be read or copied are only borrowed.
+ */
+static const VersionedNode* newNode(int data, const VersionedNode* left, const VersionedNode* right);
+static const VersionedNode* retain(const VersionedNode* node);
+static void release(const VersionedNode* node);
+
+// This function builds a node of the given value and children, with a single or double rotation if they are unbalanced
+static const VersionedNode* balance(int data, const VersionedNode* left, const VersionedNode* right);
+
+// These functions return a copy of the subtree with the value inserted, or with one copy of it removed. The value
+// must be in the subtree for removeValue, and removeMin writes the value it removed to min.
+static const VersionedNode* insertValue(const VersionedNode* node, int data);
+static const VersionedNode* removeValue(const VersionedNode* node, int data);
+static const VersionedNode* removeMin(const VersionedNode* node, int* min);
+
+static bool containsValue(const VersionedNode* node, int data);
+
+// This function returns the number of copies of a value in the subtree
+static size_t countValue(const VersionedNode* node, int data);
+
+// This function returns a reference to the newest root of a tree, see treeSnapshot
+static const VersionedNode* pinRoot(VersionedTree* tree);
+
+// This function creates a tree that takes over a reference to a root
+static VersionedTree* treeOf(const VersionedNode* root);
+
+/*
+ * These functions build a subtree of two subtrees, whose heights may differ by any amount, with the given value (or
+ * the given number of copies of it, or nothing) between them. No value of left may be greater than data, and no value
+ * of right may be smaller.
+ */
+static const VersionedNode* join(const VersionedNode* left, int data, const VersionedNode* right);
+static const VersionedNode* joinCopies(const VersionedNode* left, int data, size_t copies, const VersionedNode* right);
+static const VersionedNode* joinTwo(const VersionedNode* left, const VersionedNode* right);
+
+// This function splits a subtree into the values smaller than data and the ones greater, and returns the number of
+// copies of data that were in it
+static size_t splitValue(const VersionedNode* node, int data, const VersionedNode** lo, const VersionedNode** hi);
+
+// This function applies a set operation to two subtrees
+static const VersionedNode* combine(const VersionedNode* a, const VersionedNode* b, SetOperation operation);
+static VersionedTree* combineTrees(VersionedTree* a, VersionedTree* b, SetOperation operation);
+
+static inline int nodeHeight(const VersionedNode* node) {
+    return node ? node->height : 0;
+}
+
+// Create an empty tree
+VersionedTree* versionedCreate(void) {
+    VersionedTree* tree = (VersionedTree*)malloc(sizeof(VersionedTree));
+    tree->root = NULL;
+    latchInit(&tree->writer);
+
+    return tree;
+}
+
+// Copy the path to the new value, publish the new version and drop the reference of the tree to the old one
+void versionedInsert(VersionedTree* tree, const int data) {
+    latchAcquire(&tree->writer);
+    const VersionedNode* old = tree->root;
+    __atomic_store_n(&tree->root, insertValue(old, data), __ATOMIC_RELEASE);
+    latchRelease(&tree->writer);
+
+    release(old);
+}
+
+// The value is looked up first, so a missing value does not copy anything
+bool versionedDelete(VersionedTree* tree, const int data) {
+    latchAcquire(&tree->writer);
+    const VersionedNode* old = tree->root;
+    if (!containsValue(old, data)) {
+        latchRelease(&tree->writer);
+        return false;
+    }
+
+    __atomic_store_n(&tree->root, removeValue(old, data), __ATOMIC_RELEASE);
+    latchRelease(&tree->writer);
+
+    release(old);
+    return true;
+}
+
+// The epoch keeps the version we walk from being reclaimed under us, without touching its reference counts
+bool versionedSearch(const VersionedTree* tree, const int data) {
+    epochEnter();
+    const bool isFound = containsValue(__atomic_load_n(&tree->root, __ATOMIC_ACQUIRE), data);
+    epochExit();
+
+    return isFound;
+}
+
+void versionedFree(VersionedTree* tree) {
+    if (tree == NULL) return;
+
+    release(tree->root);
+    latchDestroy(&tree->writer);
+    free(tree);
+}
+
+// The copies of the key go to the upper tree, as its smallest values
+void versionedSplit(VersionedTree* tree, const int key, VersionedTree** lo, VersionedTree** hi) {
+    const VersionedNode* root = pinRoot(tree);
+    const VersionedNode* below, *above;
+    const size_t copies = splitValue(root, key, &below, &above);
+    release(root);
+
+    *lo = treeOf(below);
+    *hi = treeOf(joinCopies(NULL, key, copies, above));
+}
+
+// The largest value of lo is its rightmost node, and the smallest value of hi is its leftmost one
+VersionedTree* versionedJoin(VersionedTree* lo, VersionedTree* hi) {
+    const VersionedNode* left = pinRoot(lo), *right = pinRoot(hi);
+
+    if (left && right) {
+        const VersionedNode* max = left, *min = right;
+        while (max->right) max = max->right;
+        while (min->left) min = min->left;
+
+        if (max->data > min->data) {
+            release(left);
+            release(right);
+            return NULL;
+        }
+    }
+
+    return treeOf(joinTwo(left, right));
+}
+
+VersionedTree* versionedUnion(VersionedTree* a, VersionedTree* b) {
+    return combineTrees(a, b, SET_UNION);
+}
+
+VersionedTree* versionedIntersection(VersionedTree* a, VersionedTree* b) {
+    return combineTrees(a, b, SET_INTERSECTION);
+}
+
+VersionedTree* versionedDifference(VersionedTree* a, VersionedTree* b) {
+    return combineTrees(a, b, SET_DIFFERENCE);
+}
+
+TreeSnapshot* treeSnapshot(VersionedTree* tree) {
+    TreeSnapshot* snapshot = (TreeSnapshot*)malloc(sizeof(TreeSnapshot));
+    snapshot->root = pinRoot(tree);
+
+    return snapshot;
+}
+
+bool snapshotSearch(const TreeSnapshot* snapshot, const int data) {
+    return containsValue(snapshot->root, data);
+}
+
+bool snapshotFindMin(const TreeSnapshot* snapshot, int* min) {
+    const VersionedNode* node = snapshot->root;
+    if (node == NULL) return false;
+
+    while (node->left) node = node->left;
+    *min = node->data;
+
+    return true;
+}
+
+/*
+ * An in-order walk with an explicit stack, starting at the first value that is not smaller than lo.
+ * Copies of a value may be on both sides of a node, so we go left at every node that is not smaller than lo.
+ */
+size_t snapshotScan(const TreeSnapshot* snapshot, const int lo, const int hi, ScanCallback callback, void* context) {
+    const VersionedNode* stack[MAX_HEIGHT];
+    size_t depth = 0, count = 0;
+
+    const VersionedNode* node = snapshot->root;
+    while (node) {
+        if (node->data >= lo) {
+            stack[depth++] = node;
+            node = node->left;
+        }
+        else {
+            node = node->right;
+        }
+    }
+
+    while (depth > 0) {
+        node = stack[--depth];
+        if (node->data > hi) break;
+
+        count++;
+        if (!callback(node->data, context)) break;
+
+        for (node = node->right; node; node = node->left) stack[depth++] = node;
+    }
+
+    return count;
+}
+
+void snapshotRelease(TreeSnapshot* snapshot) {
+    if (snapshot == NULL) return;
+
+    release(snapshot->root);
+    free(snapshot);
+}
+
+static const VersionedNode* newNode(const int data, const VersionedNode* left, const VersionedNode* right) {
+    VersionedNode* node = (VersionedNode*)malloc(sizeof(VersionedNode));
+    node->data = data;
+    node->left = left;
+    node->right = right;
+    node->references = 1;
+
+    const int leftHeight = nodeHeight(left), rightHeight = nodeHeight(right);
+    node->height = 1 + (leftHeight > rightHeight ? leftHeight : rightHeight);
+
+    return node;
+}
+
+static const VersionedNode* retain(const VersionedNode* node) {
+    if (node) __atomic_add_fetch(&((VersionedNode*)node)->references, 1, __ATOMIC_RELAXED);
+    return node;
+}
+
+/*
+ * Drop a reference. A node that lost its last one drops the references to its children, and is freed once no
+ * versionedSearch or treeSnapshot can still be reading it. The right children are dropped in a loop and only the left
+ * ones recursively, so the recursion is not deeper than the tree.
+ */
+static void release(const VersionedNode* node) {
+    while (node && __atomic_sub_fetch(&((VersionedNode*)node)->references, 1, __ATOMIC_ACQ_REL) == 0) {
+        const VersionedNode* right = node->right;
+        release(node->left);
+        epochRetire((void*)node, free);
+        node = right;
+    }
+}
+
+/*
+ * The rotations build new nodes for the rotated ones, sharing their untouched subtrees. The child that was rotated
+ * is dropped, since the new nodes took its children and its value.
+ */
+static const VersionedNode* balance(const int data, const VersionedNode* left, const VersionedNode* right) {
+    const int factor = nodeHeight(left) - nodeHeight(right);
+
+    if (factor > 1) {
+        const VersionedNode* result;
+        if (nodeHeight(left->left) >= nodeHeight(left->right)) {
+            result = newNode(left->data, retain(left->left), newNode(data, retain(left->right), right));
+        }
+        else {
+            const VersionedNode* middle = left->right;
+            result = newNode(middle->data, newNode(left->data, retain(left->left), retain(middle->left)),
+                             newNode(data, retain(middle->right), right));
+        }
+        release(left);
+        return result;
+    }
+
+    if (factor < -1) {
+        const VersionedNode* result;
+        if (nodeHeight(right->right) >= nodeHeight(right->left)) {
+            result = newNode(right->data, newNode(data, left, retain(right->left)), retain(right->right));
+        }
+        else {
+            const VersionedNode* middle = right->left;
+            result = newNode(middle->data, newNode(data, left, retain(middle->left)),
+                             newNode(right->data, retain(middle->right), retain(right->right)));
+        }
+        release(right);
+        return result;
+    }
+
+    return newNode(data, left, right);
+}
+
+// Copies of a value go left, like insertNode
+static const VersionedNode* insertValue(const VersionedNode* node, const int data) {
+    if (node == NULL) return newNode(data, NULL, NULL);
+
+    if (data <= node->data) return balance(node->data, insertValue(node->left, data), retain(node->right));
+    return balance(node->data, retain(node->left), insertValue(node->right, data));
+}
+
+// A node with two children takes the value of its successor, which is removed from the right subtree instead
+static const VersionedNode* removeValue(const VersionedNode* node, const int data) {
+    if (data < node->data) return balance(node->data, removeValue(node->left, data), retain(node->right));
+    if (data > node->data) return balance(node->data, retain(node->left), removeValue(node->right, data));
+
+    if (node->left == NULL) return retain(node->right);
+    if (node->right == NULL) return retain(node->left);
+
+    int successor;
+    const VersionedNode* right = removeMin(node->right, &successor);
+    return balance(successor, retain(node->left), right);
+}
+
+static const VersionedNode* removeMin(const VersionedNode* node, int* min) {
+    if (node->left == NULL) {
+        *min = node->data;
+        return retain(node->right);
+    }
+
+    return balance(node->data, removeMin(node->left, min), retain(node->right));
+}
+
+// Every node is between its left and right subtrees, so copies of a value are always found on the way down
+static bool containsValue(const VersionedNode* node, const int data) {
+    while (node) {
+        if (node->data == data) return true;
+        node = data < node->data ? node->left : node->right;
+    }
+
+    return false;
+}
+
+static size_t countValue(const VersionedNode* node, const int data) {
+    if (node == NULL) return 0;
+
+    if (data < node->data) return countValue(node->left, data);
+    if (data > node->data) return countValue(node->right, data);
+    return 1 + countValue(node->left, data) + countValue(node->right, data);
+}
+
+/*
+ * Pin the newest root. A writer may have dropped the last reference to the root we read, and then it is only kept
+ * by our epoch: we must not bring it back, so we take a reference only while the count is not zero, and otherwise
+ * read the root again (the writer published the new one before dropping the old one).
+ */
+static const VersionedNode* pinRoot(VersionedTree* tree) {
+    const VersionedNode* pinned = NULL;
+
+    epochEnter();
+    while (true) {
+        VersionedNode* root = (VersionedNode*)__atomic_load_n(&tree->root, __ATOMIC_ACQUIRE);
+        if (root == NULL) break;
+
+        unsigned long references = __atomic_load_n(&root->references, __ATOMIC_RELAXED);
+        while (references != 0 && !__atomic_compare_exchange_n(&root->references, &references, references + 1, true,
+                                                                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {}
+        if (references != 0) {
+            pinned = root;
+            break;
+        }
+    }
+    epochExit();
+
+    return pinned;
+}
+
+static VersionedTree* treeOf(const VersionedNode* root) {
+    VersionedTree* tree = versionedCreate();
+    tree->root = root;
+
+    return tree;
+}
+
+/*
+ * The node goes into the higher subtree, along its side that faces the other subtree, down to the first subtree that
+ * is at most one level higher than the other one. Every copied node on the way back up is rebalanced like after an
+ * insert, which is enough since the subtree below it grew by at most one level.
+ */
+static const VersionedNode* join(const VersionedNode* left, const int data, const VersionedNode* right) {
+    const int leftHeight = nodeHeight(left), rightHeight = nodeHeight(right);
+
+    if (leftHeight > rightHeight + 1) {
+        const VersionedNode* result = balance(left->data, retain(left->left), join(retain(left->right), data, right));
+        release(left);
+        return result;
+    }
+
+    if (rightHeight > leftHeight + 1) {
+        const VersionedNode* result = balance(right->data, join(left, data, retain(right->left)), retain(right->right));
+        release(right);
+        return result;
+    }
+
+    return newNode(data, left, right);
+}
+
+// Copies of a value go left, so the extra copies are inserted after the first one
+static const VersionedNode* joinCopies(const VersionedNode* left, const int data, const size_t copies,
+                                       const VersionedNode* right) {
+    if (copies == 0) return joinTwo(left, right);
+
+    const VersionedNode* node = join(left, data, right);
+    for (size_t i = 1; i < copies; ++i) {
+        const VersionedNode* next = insertValue(node, data);
+        release(node);
+        node = next;
+    }
+
+    return node;
+}
+
+// The smallest value of the right subtree joins the two
+static const VersionedNode* joinTwo(const VersionedNode* left, const VersionedNode* right) {
+    if (left == NULL) return right;
+    if (right == NULL) return left;
+
+    int min;
+    const VersionedNode* rest = removeMin(right, &min);
+    release(right);
+
+    return join(left, min, rest);
+}
+
+/*
+ * Walk down to the value and join the parts we pass on the way back up: a node greater than the value goes to the
+ * upper part with its right subtree, and a smaller one to the lower part with its left subtree. Copies of the value
+ * may be on both sides of a node that holds it, and those sides hold nothing else on the wrong side of the value.
+ */
+static size_t splitValue(const VersionedNode* node, const int data, const VersionedNode** lo,
+                         const VersionedNode** hi) {
+    if (node == NULL) {
+        *lo = NULL;
+        *hi = NULL;
+        return 0;
+    }
+
+    const VersionedNode* below, *above;
+    if (data < node->data) {
+        const size_t copies = splitValue(node->left, data, lo, &above);
+        *hi = join(above, node->data, retain(node->right));
+        return copies;
+    }
+
+    if (data > node->data) {
+        const size_t copies = splitValue(node->right, data, &below, hi);
+        *lo = join(retain(node->left), node->data, below);
+        return copies;
+    }
+
+    const size_t leftCopies = splitValue(node->left, data, lo, &above);
+    const size_t rightCopies = splitValue(node->right, data, &below, hi);
+    release(above);
+    release(below);
+
+    return 1 + leftCopies + rightCopies;
+}
+
+/*
+ * Split a by the value at the root of b, apply the operation to the lower half of a and the left subtree of b and to
+ * the upper halves, and join the two results with as many copies of the value as the operation keeps. The halves
+ * are independent, so a high b gives the lower ones to a new task. The copies of the value in the subtrees of b meet
+ * no copies in the halves of a, so we count all of them at the root.
+ */
+static const VersionedNode* combine(const VersionedNode* a, const VersionedNode* b, const SetOperation operation) {
+    if (a == NULL) return operation == SET_UNION ? retain(b) : NULL;
+    if (b == NULL) return operation == SET_INTERSECTION ? NULL : retain(a);
+
+    const VersionedNode* lo, *hi;
+    const size_t copies = splitValue(a, b->data, &lo, &hi);
+
+    const VersionedNode* left = NULL, *right = NULL;
+
+    #pragma omp task shared(left) if(nodeHeight(b) > SET_TASK_HEIGHT)
+    left = combine(lo, b->left, operation);
+
+    right = combine(hi, b->right, operation);
+
+    #pragma omp taskwait
+
+    release(lo);
+    release(hi);
+
+    size_t kept = copies + 1;
+    if (operation != SET_UNION) {
+        const size_t others = countValue(b, b->data);
+        if (operation == SET_INTERSECTION) kept = copies < others ? copies : others;
+        else kept = copies > others ? copies - others : 0;
+    }
+
+    return joinCopies(left, b->data, kept, right);
+}
+
+// Combine the newest versions, in a parallel region of our own unless we are already in one or b is small
+static VersionedTree* combineTrees(VersionedTree* a, VersionedTree* b, const SetOperation operation) {
+    const VersionedNode* x = pinRoot(a), *y = pinRoot(b);
+
+    const VersionedNode* result = NULL;
+    if (nodeHeight(y) <= SET_TASK_HEIGHT || omp_in_parallel()) {
+        result = combine(x, y, operation);
+    }
+    else {
+        #pragma omp parallel
+        {
+            #pragma omp single
+            result = combine(x, y, operation);
+        }
+    }
+
+    release(x);
+    release(y);
+    return treeOf(result);
+}
@@ -0,0 +1,84 @@
+//
+// Created by Nadav Menirav on 26/12/2025.
+//
+
+#ifndef VERSIONED_TREE_H
+#define VERSIONED_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "binary_tree.h"
+
+/*
+ * A persistent (copy-on-write) balanced binary search tree, with the contract of the locked tree: duplicates are
+ * allowed, and every delete removes one copy of a value.
+ * Nodes never change once they are published. A write copies the path from the root down to the node it changes
+ * (rebalancing the copies as an AVL tree) and publishes the new root, so every root ever published stays a complete,
+ * consistent version of the tree. The untouched subtrees are shared between versions.
+ *
+ * treeSnapshot pins the current version. Its readers need no locks at all and never hold back writers, and a version
+ * is reclaimed once neither the tree nor any snapshot refers to it. Nodes count their references, and a node that is
+ * no longer referenced is freed through epoch.h, since versionedSearch walks the newest version without pinning it.
+ *
+ * Writers are serialized by a single latch, as every write replaces the root.
+ */
+typedef struct VersionedTree VersionedTree;
+
+// A pinned version of a tree, valid until snapshotRelease
+typedef struct TreeSnapshot TreeSnapshot;
+
+// This function creates a new empty tree
+VersionedTree* versionedCreate(void);
+
+// This function inserts a value to the tree
+void versionedInsert(VersionedTree* tree, const int data);
+
+// This function deletes one copy of a value from the tree, returns false if the value is not in the tree
+bool versionedDelete(VersionedTree* tree, const int data);
+
+// This function checks whether a value exists in the newest version of the tree
+bool versionedSearch(const VersionedTree* tree, const int data);
+
+// This function frees the tree. Snapshots taken from it stay valid until they are released.
+void versionedFree(VersionedTree* tree);
+
+/*
+ * Splitting and joining. These functions read the newest versions of the trees they get, leave those trees as they
+ * are, and return new trees that share every subtree they did not have to change with them. They copy O(log n) nodes,
+ * so a tree can be cut into parts for workers and the parts of the workers put together again cheaply.
+ */
+
+// This function makes a tree of the values smaller than key and a tree of the values that are not smaller than key
+void versionedSplit(VersionedTree* tree, const int key, VersionedTree** lo, VersionedTree** hi);
+
+// This function makes a tree of the values of both trees, returns NULL unless no value of lo is greater than any
+// value of hi
+VersionedTree* versionedJoin(VersionedTree* lo, VersionedTree* hi);
+
+/*
+ * Set operations, with copies of a value counted like in a multiset: the union keeps every copy of both trees, the
+ * intersection keeps a value as many times as the tree with fewer copies has it, and the difference keeps the copies of
+ * a that b does not have. They split a by the root of b and work on the two halves in parallel OpenMP tasks, joining
+ * the results, so they take O(m log(n / m + 1)) work for trees of m <= n values.
+ */
+VersionedTree* versionedUnion(VersionedTree* a, VersionedTree* b);
+VersionedTree* versionedIntersection(VersionedTree* a, VersionedTree* b);
+VersionedTree* versionedDifference(VersionedTree* a, VersionedTree* b);
+
+// This function pins the newest version of the tree
+TreeSnapshot* treeSnapshot(VersionedTree* tree);
+
+// This function checks whether a value exists in a snapshot
+bool snapshotSearch(const TreeSnapshot* snapshot, const int data);
+
+// This function finds the minimal value in a snapshot, returns false if it is empty
+bool snapshotFindMin(const TreeSnapshot* snapshot, int* min);
+
+// This function passes the values of a snapshot in [lo, hi] to the callback in order, and returns how many it passed
+size_t snapshotScan(const TreeSnapshot* snapshot, int lo, int hi, ScanCallback callback, void* context);
+
+// This function unpins a snapshot, its version is reclaimed if nothing else refers to it
+void snapshotRelease(TreeSnapshot* snapshot);
+
+#endif //VERSIONED_TREE_H